@@ -4,6 +4,7 @@ import (
 	"encoding/json"
 	"io"
 	"log"
+	"net"
 	"net/http"
 	"os"
 	"path/filepath"
@@ -13,6 +14,7 @@ import (
 	"bufio"
 	"exec"
 	"fmt"
+	"strings"
 	"time"
 )
 
@@ -222,8 +224,50 @@ func ctrl_c(cmd *exec.Cmd, timeout time.Duration) (*exec.Cmd, error) {
     return newCmd, nil
 }
 
+// controlSocketPath renvoie le chemin de la socket de contrôle du démon C
+// (même règle que control_socket_start : RAW_JOYSTICK_CONTROL_SOCKET ou défaut)
+func controlSocketPath() string {
+	if p := os.Getenv("RAW_JOYSTICK_CONTROL_SOCKET"); p != "" {
+		return p
+	}
+	return "/run/raw_joystick.sock"
+}
+
+// dialError signale une socket de contrôle injoignable : le démon est absent
+// ou trop ancien, seul cas où il faut le redémarrer.
+type dialError struct {
+	err error
+}
+
+func (e *dialError) Error() string {
+	return fmt.Sprintf("connexion à la socket de contrôle: %v", e.err)
+}
+
+// reloadMapping demande au démon C de recharger le mapping à chaud, sans
+// déconnexion USB ni redémarrage du processus.
+func reloadMapping(path string) error {
+	conn, err := net.DialTimeout("unix", controlSocketPath(), 2*time.Second)
+	if err != nil {
+		return &dialError{err}
+	}
+	defer conn.Close()
+	conn.SetDeadline(time.Now().Add(5 * time.Second))
+	if _, err := fmt.Fprintf(conn, "reload %s\n", path); err != nil {
+		return fmt.Errorf("envoi de la commande reload: %v", err)
+	}
+	reply, err := bufio.NewReader(conn).ReadString('\n')
+	if err != nil {
+		return fmt.Errorf("lecture de la réponse: %v", err)
+	}
+	reply = strings.TrimSpace(reply)
+	if reply != "ok" {
+		return fmt.Errorf("rechargement refusé: %s", reply)
+	}
+	return nil
+}
+
 // postMappingHandler reçoit le JSON de modifications, effectue la fusion avec mapping.json,
-// sauvegarde le résultat, recharge le mapping côté C, puis redémarre ep0_loop.
+// sauvegarde le résultat puis demande au démon C de recharger le mapping à chaud.
 func postMappingHandler(w http.ResponseWriter, r *http.Request) {
 	defer r.Body.Close()
 	data, err := io.ReadAll(r.Body)
@@ -258,20 +302,32 @@ func postMappingHandler(w http.ResponseWriter, r *http.Request) {
 		http.Error(w, "Erreur lors de l'encodage du JSON", http.StatusInternalServerError)
 		return
 	}
-	if newCmd, err := ctrl_c(cmd, timeout); err != nil {
-		fmt.Printf("Erreur lors du ctrl-c: %v\n", err)
-		return
-	} else {
-		cmd = newCmd
-	}
-
 	// Sauvegarde dans le fichier mapping.json
 	if err := os.WriteFile(defaultMappingPath, out, 0644); err != nil {
 		http.Error(w, "Erreur lors de la sauvegarde du mapping", http.StatusInternalServerError)
 		return
 	}
 
-	w.Write([]byte("Mapping sauvegardé, rechargé et ep0_loop redémarré avec succès."))
+	// Rechargement à chaud ; redémarrage du démon seulement si la socket est indisponible.
+	// Un mapping refusé par le démon est signalé tel quel : le redémarrage ne le
+	// chargerait pas mieux.
+	if err := reloadMapping(defaultMappingPath); err != nil {
+		if _, unreachable := err.(*dialError); !unreachable {
+			fmt.Printf("Rechargement à chaud impossible: %v\n", err)
+			http.Error(w, err.Error(), http.StatusInternalServerError)
+			return
+		}
+		fmt.Printf("Rechargement à chaud impossible (%v), redémarrage du démon\n", err)
+		if newCmd, err := ctrl_c(cmd, timeout); err != nil {
+			fmt.Printf("Erreur lors du ctrl-c: %v\n", err)
+			http.Error(w, "Erreur lors du rechargement du mapping", http.StatusInternalServerError)
+			return
+		} else {
+			cmd = newCmd
+		}
+	}
+
+	w.Write([]byte("Mapping sauvegardé et rechargé avec succès."))
 }
 
 
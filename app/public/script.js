@@ -236,6 +236,58 @@ function generateMappingUI() {
     inputDeadZone.id = `deadZone_${selectedDeviceIndex}_${axisIndex}`;
     formGroup.appendChild(inputDeadZone);
 
+    // Champs : Hysteresis et Quantization (unités HID, 0 : désactivé)
+    const labelHysteresis = document.createElement('label');
+    labelHysteresis.textContent = 'Hysteresis:';
+    formGroup.appendChild(labelHysteresis);
+
+    const inputHysteresis = document.createElement('input');
+    inputHysteresis.className = 'form-control';
+    inputHysteresis.type = 'text';
+    inputHysteresis.value = axis.hysteresis || 0;
+    inputHysteresis.id = `hysteresis_${selectedDeviceIndex}_${axisIndex}`;
+    formGroup.appendChild(inputHysteresis);
+
+    const labelQuantization = document.createElement('label');
+    labelQuantization.textContent = 'Quantization:';
+    formGroup.appendChild(labelQuantization);
+
+    const inputQuantization = document.createElement('input');
+    inputQuantization.className = 'form-control';
+    inputQuantization.type = 'text';
+    inputQuantization.value = axis.quantization || 0;
+    inputQuantization.id = `quantization_${selectedDeviceIndex}_${axisIndex}`;
+    formGroup.appendChild(inputQuantization);
+
+    // Champ : courbe de réponse (points x:y en unités HID) et courbes prédéfinies
+    const labelCurve = document.createElement('label');
+    labelCurve.textContent = 'Curve (x:y ...):';
+    formGroup.appendChild(labelCurve);
+
+    const selectCurve = document.createElement('select');
+    selectCurve.className = 'form-control';
+    const presetHint = document.createElement('option');
+    presetHint.value = '';
+    presetHint.textContent = 'Preset...';
+    selectCurve.appendChild(presetHint);
+    Object.keys(CURVE_PRESETS).forEach(name => {
+      const option = document.createElement('option');
+      option.value = name;
+      option.textContent = name;
+      selectCurve.appendChild(option);
+    });
+    formGroup.appendChild(selectCurve);
+
+    const inputCurve = document.createElement('input');
+    inputCurve.className = 'form-control';
+    inputCurve.type = 'text';
+    inputCurve.value = formatCurve(axis.curve);
+    inputCurve.id = `curve_${selectedDeviceIndex}_${axisIndex}`;
+    formGroup.appendChild(inputCurve);
+    selectCurve.addEventListener('change', () => {
+      if (selectCurve.value) inputCurve.value = formatCurve(CURVE_PRESETS[selectCurve.value]());
+    });
+
     // Champ : Invert avec switch Bootstrap (label avant input)
     const divInvert = document.createElement('div');
     divInvert.className = 'form-check form-switch';
@@ -283,6 +335,40 @@ function generateMappingUI() {
   });
 }
 
+// Courbes prédéfinies, échantillonnées en points de contrôle (unités HID) ;
+// le démon relie les points par une spline monotone, extrémités implicites
+function sampleCurve(f) {
+  const points = [];
+  for (let i = -3; i <= 3; i++) {
+    const x = i / 4;
+    points.push([Math.round(x * 32767), Math.round(Math.max(-1, Math.min(1, f(x))) * 32767)]);
+  }
+  return points;
+}
+
+const CURVE_PRESETS = {
+  'Linear': () => [],
+  'Expo 30%': () => sampleCurve(x => 0.7 * x + 0.3 * x * x * x),
+  'Expo 60%': () => sampleCurve(x => 0.4 * x + 0.6 * x * x * x),
+  'S-curve': () => sampleCurve(x => Math.sin(x * Math.PI / 2)),
+  'Saturation 80%': () => [[-26214, -32768], [26214, 32767]],
+};
+
+function formatCurve(curve) {
+  return (curve || []).map(p => `${p[0]}:${p[1]}`).join(' ');
+}
+
+function parseCurve(text) {
+  return text.trim().split(/\s+/).filter(s => s.length > 0).map(s => s.split(':').map(Number));
+}
+
+// Codes des boutons d'un périphérique : présents (available_buttons) ou mappés (buttons)
+function deviceButtonKeys(device) {
+  const keys = new Set(device.buttons ? Object.keys(device.buttons) : []);
+  (device.available_buttons || []).forEach(code => keys.add(String(code)));
+  return Array.from(keys);
+}
+
 function generateButtonsUI() {
   // Cible le conteneur pour les boutons
   const container = document.getElementById('buttonsMappingContainer');
@@ -298,8 +384,9 @@ function generateButtonsUI() {
     return;
   }
 
-  // On suppose que device.buttons est un objet avec des clés (0,1,2,3, etc.)
-  const buttonKeys = device.buttons ? Object.keys(device.buttons).sort((a, b) => Number(a) - Number(b)) : [];
+  // device.available_buttons liste les boutons présents ; device.buttons (objet
+  // indexé par code) ne contient que ceux qui sont mappés
+  const buttonKeys = deviceButtonKeys(device).sort((a, b) => Number(a) - Number(b));
   if (buttonKeys.length === 0) {
     container.innerHTML = '<p>Aucun bouton disponible</p>';
     return;
@@ -307,7 +394,7 @@ function generateButtonsUI() {
 
   let currentRow = null;
   buttonKeys.forEach((btnKey, index) => {
-    const button = device.buttons[btnKey];
+    const button = (device.buttons && device.buttons[btnKey]) || { mapped_button: -1, virtual_joystick: 0 };
 
     // Créer une nouvelle ligne tous les 6 boutons
     if (index % 6 === 0) {
@@ -420,25 +507,38 @@ document.getElementById('save-btn').addEventListener('click', async () => {
     if (device.axes && device.axes.length > 0) {
       device.axes.forEach((axis, axisIndex) => {
         const inputDeadZone = document.getElementById(`deadZone_${deviceIndex}_${axisIndex}`);
+        const inputHysteresis = document.getElementById(`hysteresis_${deviceIndex}_${axisIndex}`);
+        const inputQuantization = document.getElementById(`quantization_${deviceIndex}_${axisIndex}`);
+        const inputCurve = document.getElementById(`curve_${deviceIndex}_${axisIndex}`);
         const inputInvert = document.getElementById(`invert_${deviceIndex}_${axisIndex}`);
         const inputVirtualJoystick = document.getElementById(`virtualJoystick_${deviceIndex}_${axisIndex}`);
         const inputVirtualAxis = document.getElementById(`virtualAxis_${deviceIndex}_${axisIndex}`);
         if (inputDeadZone) axis.dead_zone = Number(inputDeadZone.value);
+        if (inputHysteresis) axis.hysteresis = Number(inputHysteresis.value);
+        if (inputQuantization) axis.quantization = Number(inputQuantization.value);
+        if (inputCurve) {
+          // Courbe vide : linéaire. Le tableau vide est conservé (et non supprimé)
+          // pour que la fusion côté serveur remplace l'ancienne courbe.
+          axis.curve = parseCurve(inputCurve.value);
+        }
         if (inputInvert) axis.invert = inputInvert.checked;
         if (inputVirtualJoystick) axis.virtual_joystick = Number(inputVirtualJoystick.value);
         if (inputVirtualAxis) axis.mapped_axis = Number(inputVirtualAxis.value);
       });
     }
-    // Mise à jour des boutons (en tant qu'objet)
-    if (device.buttons) {
-      Object.keys(device.buttons).forEach(btnKey => {
-        const button = device.buttons[btnKey];
-        const inputMappedButton = document.getElementById(`mappedButton_${deviceIndex}_${btnKey}`);
-        const inputVirtualButton = document.getElementById(`virtualButton_${deviceIndex}_${btnKey}`);
-        if (inputMappedButton) button.mapped_button = Number(inputMappedButton.value);
-        if (inputVirtualButton) button.virtual_joystick = Number(inputVirtualButton.value);
-      });
-    }
+    // Mise à jour des boutons (en tant qu'objet) : un bouton resté non mappé
+    // n'est pas ajouté à device.buttons
+    deviceButtonKeys(device).forEach(btnKey => {
+      const inputMappedButton = document.getElementById(`mappedButton_${deviceIndex}_${btnKey}`);
+      const inputVirtualButton = document.getElementById(`virtualButton_${deviceIndex}_${btnKey}`);
+      if (!inputMappedButton && !inputVirtualButton) return;
+      if (!device.buttons) device.buttons = {};
+      const button = device.buttons[btnKey] || { mapped_button: -1, virtual_joystick: 0 };
+      if (inputMappedButton) button.mapped_button = Number(inputMappedButton.value);
+      if (inputVirtualButton) button.virtual_joystick = Number(inputVirtualButton.value);
+      if (device.buttons[btnKey] || button.mapped_button !== -1 || button.virtual_joystick !== 0)
+        device.buttons[btnKey] = button;
+    });
   });
   
   // Reconstruction de l'objet mapping au format souhaité
@@ -0,0 +1,559 @@
+// Banc de mesure du chemin de traduction evdev -> rapport HID.
+//
+// Crée N joysticks virtuels via uinput, les sonde comme le démon
+// (probe_input_device), construit le mapping compact puis fait tourner le
+// vrai thread HID (process_and_send_hid_reports) vers un puits de comptage.
+// Chaque périphérique est alimenté par un thread générateur cadencé.
+//
+// Rapport de gigue : -S ajoute des threads de charge (calcul et allocations)
+// et -P/-C placent le pipeline en mode temps réel comme le démon ; les
+// histogrammes de latence donnent alors la distribution sous charge. Les
+// allocations faites par les threads HID et d'écriture une fois le régime
+// établi sont comptées (édition de liens avec --wrap=malloc, voir Makefile).
+//
+// Equité : -F N fait écrire au périphérique 0 des rafales de N trames (manette
+// bavarde) ; les compteurs par périphérique et la latence des autres joysticks
+// montrent alors l'effet du budget de lecture (-E).
+//
+// Usage: bench_pipeline [-d devices] [-a axes] [-b boutons] [-r trames/s] [-t secondes] [-k période bouton]
+//                       [-S threads de charge] [-P priorité] [-C CPU[,CPU]] [-B attente active us]
+//                       [-T lecteurs] [-E budget] [-F rafale]
+#include "input_mapping.h"
+#include "runtime_mapping.h"
+#include "usb_descriptors.h"
+#include "usb_hid.h"
+#include "output_sink.h"
+#include "log_ring.h"
+#include "latency_stats.h"
+#include "rt_mode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <linux/uinput.h>
+
+#define BENCH_MAX_DEVICES 32
+#define BENCH_MAX_AXES 16
+#define BENCH_MAX_BUTTONS (16 + 40)
+#define BENCH_MAX_STRESS 64
+#define BENCH_STRESS_BLOCK (256 * 1024)
+#define BENCH_MAX_BURST 256
+
+typedef struct {
+    int devices;
+    int axes;
+    int buttons;
+    int rate;            // Trames (SYN_REPORT) par seconde et par périphérique
+    int seconds;
+    int button_period;   // Une bascule de bouton toutes les k trames (0 = jamais)
+    int stress;          // Threads de charge
+    int burst;           // Trames écrites d'un coup par le périphérique 0 (1 : cadence normale)
+    int jitter;          // Axes au repos : bruit de +/- jitter autour du centre (0 : valeurs aléatoires)
+    int hysteresis;      // Filtre anti-gigue appliqué à tous les axes (unités HID)
+    int quantization;    // Pas de quantification appliqué à tous les axes
+} BenchConfig;
+
+typedef struct {
+    int index;
+    int fd;                     // Descripteur uinput
+    const BenchConfig *cfg;
+    uint64_t frames;
+    uint64_t events;            // Evénements EV_ABS / EV_KEY (hors SYN)
+} BenchGenerator;
+
+// ------------------------------------------------------------------
+// Comptage des allocations (édition de liens avec --wrap)
+// ------------------------------------------------------------------
+static atomic_bool bench_steady = false;
+static _Atomic uint64_t bench_steady_allocs = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static inline void bench_count_alloc(void) {
+    if (atomic_load_explicit(&bench_steady, memory_order_relaxed) && rt_mode_is_pipeline_thread())
+        atomic_fetch_add_explicit(&bench_steady_allocs, 1, memory_order_relaxed);
+}
+
+void *__wrap_malloc(size_t size) {
+    bench_count_alloc();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+    bench_count_alloc();
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    bench_count_alloc();
+    return __real_realloc(ptr, size);
+}
+
+// ------------------------------------------------------------------
+// Puits de comptage
+// ------------------------------------------------------------------
+typedef struct {
+    _Atomic uint64_t reports[MAX_VIRTUAL_JOYSTICKS];
+} CountingSink;
+
+static int counting_enable_endpoint(OutputSink *sink, int joy, struct usb_endpoint_descriptor *desc) {
+    (void)sink;
+    (void)joy;
+    (void)desc;
+    return 0;
+}
+
+static int counting_write_report(OutputSink *sink, int joy, const uint8_t *report, size_t len) {
+    CountingSink *c = sink->priv;
+    (void)report;
+    if (joy >= 0 && joy < MAX_VIRTUAL_JOYSTICKS)
+        atomic_fetch_add_explicit(&c->reports[joy], 1, memory_order_relaxed);
+    return (int)len;
+}
+
+static void counting_destroy(OutputSink *sink) {
+    (void)sink;
+}
+
+static const OutputSinkOps counting_ops = {
+    .name = "bench",
+    .host_paced = 1,            // Pas de cadence locale : débit maximal du pipeline
+    .enable_endpoint = counting_enable_endpoint,
+    .write_report = counting_write_report,
+    .lifecycle = NULL,
+    .destroy = counting_destroy,
+};
+
+// ------------------------------------------------------------------
+// Périphériques uinput
+// ------------------------------------------------------------------
+static int bench_button_code(int index) {
+    if (index < 16)
+        return BTN_JOYSTICK + index;
+    return BTN_TRIGGER_HAPPY1 + (index - 16);
+}
+
+static int bench_create_device(int index, const BenchConfig *cfg, char *event_path, size_t len) {
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        perror("open /dev/uinput");
+        return -1;
+    }
+    ioctl(fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    for (int a = 0; a < cfg->axes; a++) {
+        ioctl(fd, UI_SET_ABSBIT, a);
+        struct uinput_abs_setup abs;
+        memset(&abs, 0, sizeof(abs));
+        abs.code = a;
+        abs.absinfo.minimum = 0;
+        abs.absinfo.maximum = 65535;
+        if (ioctl(fd, UI_ABS_SETUP, &abs) < 0) {
+            perror("UI_ABS_SETUP");
+            close(fd);
+            return -1;
+        }
+    }
+    for (int b = 0; b < cfg->buttons; b++)
+        ioctl(fd, UI_SET_KEYBIT, bench_button_code(b));
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1209;
+    setup.id.product = 0xbe00 + index;
+    setup.id.version = 1;
+    snprintf(setup.name, sizeof(setup.name), "raw_joystick bench %d", index);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        perror("UI_DEV_CREATE");
+        close(fd);
+        return -1;
+    }
+    // Retrouve le noeud /dev/input/eventX créé pour ce périphérique
+    char sysname[64];
+    if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+        perror("UI_GET_SYSNAME");
+        close(fd);
+        return -1;
+    }
+    char pattern[128];
+    snprintf(pattern, sizeof(pattern), "/sys/devices/virtual/input/%s/event*", sysname);
+    glob_t g;
+    for (int tries = 0; tries < 100; tries++) {
+        if (glob(pattern, 0, NULL, &g) == 0) {
+            const char *node = strrchr(g.gl_pathv[0], '/') + 1;
+            snprintf(event_path, len, "/dev/input/%s", node);
+            globfree(&g);
+            // Laisse udev créer le noeud et ajuster ses droits
+            for (int w = 0; w < 100 && access(event_path, R_OK) != 0; w++)
+                usleep(10000);
+            return fd;
+        }
+        usleep(10000);
+    }
+    fprintf(stderr, "Noeud evdev introuvable pour %s\n", sysname);
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    return -1;
+}
+
+static void bench_destroy_device(int fd) {
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+}
+
+// Mapping de référence : périphérique i -> joystick virtuel i % usb_nb_joysticks,
+// axes et boutons dans l'ordre des codes.
+static void bench_assign_mapping(InputDevice *dev, int index, const BenchConfig *cfg) {
+    int joy = index % usb_nb_joysticks;
+    int slot = 0;
+    for (int code = 0; code < ABS_CNT; code++) {
+        if (!dev->has_abs[code])
+            continue;
+        dev->axis_virtual_joystick[code] = joy;
+        dev->axis_virtual_axis[code] = slot++ % usb_joysticks[joy].nb_axes;
+        dev->axis_hysteresis[code] = cfg->hysteresis;
+        dev->axis_quantization[code] = cfg->quantization;
+    }
+    slot = 0;
+    for (int code = 0; code <= KEY_MAX; code++) {
+        if (!dev->has_button[code])
+            continue;
+        dev->button_virtual_joystick[code] = joy;
+        dev->button_mapping[code] = slot++ % usb_joysticks[joy].nb_buttons;
+    }
+}
+
+// ------------------------------------------------------------------
+// Générateurs
+// ------------------------------------------------------------------
+static uint64_t timespec_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static void ns_timespec(uint64_t ns, struct timespec *ts) {
+    ts->tv_sec = ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+static void *bench_generator(void *arg) {
+    BenchGenerator *gen = arg;
+    const BenchConfig *cfg = gen->cfg;
+    uint64_t period = 1000000000ULL / cfg->rate;
+    uint64_t start = latency_now_ns();
+    uint64_t end = start + (uint64_t)cfg->seconds * 1000000000ULL;
+    uint64_t next = start;
+    uint32_t value = gen->index * 7919u;
+    int burst = gen->index == 0 ? cfg->burst : 1;
+    struct input_event frames[BENCH_MAX_BURST * 3];
+    memset(frames, 0, sizeof(frames));
+    while (next < end) {
+        int n = 0, events = 0;
+        for (int f = 0; f < burst; f++) {
+            uint64_t index = gen->frames + f;
+            if (cfg->axes > 0) {
+                value = value * 1103515245u + 12345u;
+                frames[n].type = EV_ABS;
+                frames[n].code = index % cfg->axes;
+                if (cfg->jitter > 0)
+                    frames[n].value = 32768 + (int)((value >> 8) % (2u * cfg->jitter + 1)) - cfg->jitter;
+                else
+                    frames[n].value = (value >> 8) & 0xffff;
+                n++;
+                events++;
+            }
+            if (cfg->buttons > 0 && cfg->button_period > 0 && index % cfg->button_period == 0) {
+                uint64_t toggle = index / cfg->button_period;
+                frames[n].type = EV_KEY;
+                frames[n].code = bench_button_code(toggle % cfg->buttons);
+                frames[n].value = (toggle / cfg->buttons) & 1 ? 0 : 1;
+                n++;
+                events++;
+            }
+            frames[n].type = EV_SYN;
+            frames[n].code = SYN_REPORT;
+            frames[n].value = 0;
+            n++;
+        }
+        if (write(gen->fd, frames, n * sizeof(struct input_event)) < 0) {
+            if (errno != EAGAIN) {
+                perror("write uinput");
+                break;
+            }
+        } else {
+            gen->frames += burst;
+            gen->events += events;
+        }
+        next += period;
+        struct timespec ts;
+        ns_timespec(next, &ts);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    return NULL;
+}
+
+// ------------------------------------------------------------------
+// Charge : calcul et allocations sur tous les CPU jusqu'à l'arrêt
+// ------------------------------------------------------------------
+static atomic_bool stress_stop = false;
+
+static void *bench_stress(void *arg) {
+    (void)arg;
+    uint64_t x = 88172645463325252ULL;
+    while (!atomic_load_explicit(&stress_stop, memory_order_relaxed)) {
+        char *block = malloc(BENCH_STRESS_BLOCK);
+        if (block) {
+            memset(block, (int)x, BENCH_STRESS_BLOCK);
+            free(block);
+        }
+        for (int i = 0; i < 100000; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+    }
+    return (void *)(uintptr_t)x;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-d devices] [-a axes] [-b boutons] [-r trames/s] [-t secondes] [-k période bouton]\n"
+                    "       [-S threads de charge] [-P priorité SCHED_FIFO] [-C CPU[,CPU]] [-B attente active us] [-T lecteurs]\n"
+                    "       [-E budget de lecture] [-F rafale du périphérique 0] [-J gigue au repos]\n"
+                    "       [-H hystérésis] [-Q quantification]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    BenchConfig cfg = { .devices = 2, .axes = 6, .buttons = 16, .rate = 1000, .seconds = 5, .button_period = 10, .burst = 1 };
+    const char *rt_cpus = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:a:b:r:t:k:S:P:C:B:T:E:F:J:H:Q:")) != -1) {
+        switch (opt) {
+            case 'd': cfg.devices = atoi(optarg); break;
+            case 'a': cfg.axes = atoi(optarg); break;
+            case 'b': cfg.buttons = atoi(optarg); break;
+            case 'r': cfg.rate = atoi(optarg); break;
+            case 't': cfg.seconds = atoi(optarg); break;
+            case 'k': cfg.button_period = atoi(optarg); break;
+            case 'S': cfg.stress = atoi(optarg); break;
+            case 'P':
+                if (rt_mode_configure(atoi(optarg)) < 0) {
+                    fprintf(stderr, "Priorité SCHED_FIFO invalide: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'C': rt_cpus = optarg; break;
+            case 'B':
+                if (hid_configure_busy_poll(strtoul(optarg, NULL, 10)) < 0) {
+                    fprintf(stderr, "Fenêtre d'attente active invalide: %s us\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'E': hid_configure_device_budget(strtoul(optarg, NULL, 10)); break;
+            case 'F': cfg.burst = atoi(optarg); break;
+            case 'J': cfg.jitter = atoi(optarg); break;
+            case 'H': cfg.hysteresis = atoi(optarg); break;
+            case 'Q': cfg.quantization = atoi(optarg); break;
+            case 'T':
+                if (hid_configure_readers(atoi(optarg)) < 0) {
+                    fprintf(stderr, "Nombre de lecteurs invalide: %s (%d au plus)\n", optarg, HID_MAX_READERS);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (cfg.devices < 1 || cfg.devices > BENCH_MAX_DEVICES || cfg.axes < 0 || cfg.axes > BENCH_MAX_AXES ||
+        cfg.buttons < 0 || cfg.buttons > BENCH_MAX_BUTTONS || cfg.rate < 1 || cfg.seconds < 1 ||
+        cfg.button_period < 0 || cfg.stress < 0 || cfg.stress > BENCH_MAX_STRESS ||
+        cfg.burst < 1 || cfg.burst > BENCH_MAX_BURST || cfg.jitter < 0 || cfg.jitter > 32767 ||
+        cfg.hysteresis < 0 || cfg.hysteresis > 32767 || cfg.quantization < 0 || cfg.quantization > 32767) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (rt_cpus && (!rt_mode_enabled() || rt_mode_parse_cpus(rt_cpus) < 0)) {
+        fprintf(stderr, "Affinité invalide: %s (CPU[,CPU], avec -P)\n", rt_cpus);
+        return 1;
+    }
+    // Les logs par événement fausseraient la mesure : erreurs seulement, sauf
+    // si RAW_JOYSTICK_LOG_LEVEL est positionné.
+    log_ring_set_level(LOG_LEVEL_ERROR);
+    log_ring_configure_from_env();
+
+    BenchGenerator gens[BENCH_MAX_DEVICES];
+    InputDevice *devices = calloc(cfg.devices, sizeof(InputDevice));
+    if (!devices) {
+        perror("malloc devices");
+        return 1;
+    }
+    int created = 0;
+    for (int i = 0; i < cfg.devices; i++) {
+        char event_path[PATH_MAX];
+        gens[i].index = i;
+        gens[i].cfg = &cfg;
+        gens[i].frames = 0;
+        gens[i].events = 0;
+        gens[i].fd = bench_create_device(i, &cfg, event_path, sizeof(event_path));
+        if (gens[i].fd < 0)
+            break;
+        created++;
+        if (probe_input_device(event_path, &devices[i]) < 0) {
+            bench_destroy_device(gens[i].fd);
+            created--;
+            break;
+        }
+        bench_assign_mapping(&devices[i], i, &cfg);
+    }
+    if (created != cfg.devices) {
+        for (int i = 0; i < created; i++)
+            bench_destroy_device(gens[i].fd);
+        free_input_devices(devices, created);
+        return 1;
+    }
+    RuntimeMapping *rt = runtime_mapping_build(devices, cfg.devices);
+    if (!rt) {
+        for (int i = 0; i < created; i++)
+            bench_destroy_device(gens[i].fd);
+        free_input_devices(devices, created);
+        return 1;
+    }
+
+    CountingSink counting;
+    memset(&counting, 0, sizeof(counting));
+    OutputSink sink = { .ops = &counting_ops, .priv = &counting };
+    rt_mode_lock_memory();
+    log_ring_start();
+    if (hid_thread_start(&sink, rt) != 0)
+        return 1;
+    clockid_t hid_clock;
+    bool have_clock = hid_thread_cpu_clock(&hid_clock) == 0;
+    clockid_t reader_clocks[HID_MAX_READERS];
+    int nb_reader_clocks = hid_reader_cpu_clocks(reader_clocks, HID_MAX_READERS);
+    pthread_t stress[BENCH_MAX_STRESS];
+    for (int i = 0; i < cfg.stress; i++)
+        pthread_create(&stress[i], NULL, bench_stress, NULL);
+    // Laisse les threads HID et d'écriture atteindre leur boucle (tampons
+    // alloués, périphériques enregistrés) avant de compter les allocations
+    usleep(100000);
+    latency_stats_reset();
+    atomic_store(&bench_steady, true);
+
+    struct rusage ru_start, ru_end;
+    getrusage(RUSAGE_SELF, &ru_start);
+    uint64_t t_start = latency_now_ns();
+    pthread_t threads[BENCH_MAX_DEVICES];
+    for (int i = 0; i < cfg.devices; i++)
+        pthread_create(&threads[i], NULL, bench_generator, &gens[i]);
+    for (int i = 0; i < cfg.devices; i++)
+        pthread_join(threads[i], NULL);
+    // Laisse le thread HID vider les dernières trames
+    usleep(100000);
+    uint64_t elapsed = latency_now_ns() - t_start;
+    getrusage(RUSAGE_SELF, &ru_end);
+    atomic_store(&bench_steady, false);
+    atomic_store(&stress_stop, true);
+    for (int i = 0; i < cfg.stress; i++)
+        pthread_join(stress[i], NULL);
+
+    uint64_t hid_cpu = 0;
+    if (have_clock) {
+        struct timespec ts;
+        if (clock_gettime(hid_clock, &ts) == 0)
+            hid_cpu = timespec_ns(&ts);
+    }
+    // Lecteurs : coût total et lecteur le plus chargé (le coeur qui sature le premier)
+    uint64_t readers_cpu = 0, reader_max_cpu = 0;
+    for (int r = 0; r < nb_reader_clocks; r++) {
+        struct timespec ts;
+        if (clock_gettime(reader_clocks[r], &ts) == 0) {
+            readers_cpu += timespec_ns(&ts);
+            if (timespec_ns(&ts) > reader_max_cpu)
+                reader_max_cpu = timespec_ns(&ts);
+        }
+    }
+    HidReaderStats readers;
+    hid_reader_stats(&readers);
+    HidDeviceStats dev_stats[BENCH_MAX_DEVICES];
+    int nb_dev_stats = hid_device_stats(dev_stats, BENCH_MAX_DEVICES);
+    HidBusyPollStats busy;
+    hid_busy_poll_stats(&busy);
+    hid_thread_stop();
+    log_ring_stop();
+
+    uint64_t frames = 0, events = 0, reports = 0;
+    for (int i = 0; i < cfg.devices; i++) {
+        frames += gens[i].frames;
+        events += gens[i].events;
+    }
+    for (int j = 0; j < usb_nb_joysticks; j++)
+        reports += atomic_load_explicit(&counting.reports[j], memory_order_relaxed);
+    double seconds = elapsed / 1e9;
+    uint64_t proc_cpu = (ru_end.ru_utime.tv_sec - ru_start.ru_utime.tv_sec + ru_end.ru_stime.tv_sec - ru_start.ru_stime.tv_sec) * 1000000000ULL
+                      + ((int64_t)ru_end.ru_utime.tv_usec - ru_start.ru_utime.tv_usec + (int64_t)ru_end.ru_stime.tv_usec - ru_start.ru_stime.tv_usec) * 1000;
+
+    printf("bench: %d périphériques, %d axes, %d boutons, %d trames/s chacun, %d s\n",
+           cfg.devices, cfg.axes, cfg.buttons, cfg.rate, cfg.seconds);
+    if (cfg.burst > 1)
+        printf("  rafales       périphérique 0 : %d trames par écriture\n", cfg.burst);
+    printf("  charge        %d threads, mode temps réel %s\n", cfg.stress, rt_mode_enabled() ? "actif" : "inactif");
+    printf("  trames        %llu (%.0f/s)\n", (unsigned long long)frames, frames / seconds);
+    printf("  événements    %llu (%.0f/s)\n", (unsigned long long)events, events / seconds);
+    printf("  rapports      %llu (%.0f/s)\n", (unsigned long long)reports, reports / seconds);
+    if (events > 0) {
+        printf("  CPU thread %s  %.0f ns/événement (%.1f %% d'un coeur)\n", readers.nb_readers ? "agrégation" : "HID",
+               (double)hid_cpu / events, 100.0 * hid_cpu / elapsed);
+        if (readers.nb_readers)
+            printf("  CPU lecteurs    %.0f ns/événement au total, lecteur le plus chargé %.1f %% d'un coeur\n",
+                   (double)readers_cpu / events, 100.0 * reader_max_cpu / elapsed);
+        printf("  CPU processus   %.0f ns/événement (générateurs et charge inclus)\n", (double)proc_cpu / events);
+    }
+    if (readers.nb_readers) {
+        printf("  file          %d lecteurs, %llu deltas (%.1f modifications/delta), pleine %llu fois, %llu en attente au plus\n",
+               readers.nb_readers, (unsigned long long)readers.deltas,
+               readers.deltas ? (double)readers.ops / readers.deltas : 0.0,
+               (unsigned long long)readers.queue_full, (unsigned long long)readers.max_backlog);
+    }
+    if (busy.window_ns > 0) {
+        printf("  attente active  fenêtre %.0f us : %.1f %% du temps, %llu tours, %llu réveils epoll\n",
+               busy.window_ns / 1e3, 100.0 * busy.spin_ns / elapsed,
+               (unsigned long long)busy.spin_polls, (unsigned long long)busy.blocking_waits);
+        printf("  lecture moyenne %.1f us en attente active (%llu trames), %.1f us après réveil (%llu trames)\n",
+               busy.spin_frames ? busy.spin_latency_ns / 1e3 / busy.spin_frames : 0.0,
+               (unsigned long long)busy.spin_frames,
+               busy.blocking_frames ? busy.blocking_latency_ns / 1e3 / busy.blocking_frames : 0.0,
+               (unsigned long long)busy.blocking_frames);
+    }
+    for (int i = 0; i < nb_dev_stats; i++) {
+        const HidDeviceStats *d = &dev_stats[i];
+        printf("  %s: %llu événements en %llu lectures, budget épuisé %llu fois (%llu passes de suite), "
+               "âge de lecture moyen %.1f us, max %.1f us\n", d->name,
+               (unsigned long long)d->events, (unsigned long long)d->reads, (unsigned long long)d->budget_hits,
+               (unsigned long long)d->max_backlog_passes, d->reads ? d->read_age_ns / 1e3 / d->reads : 0.0,
+               d->max_read_age_ns / 1e3);
+        if (d->suppressed_frames || d->hysteresis_events || d->absorbed_events)
+            printf("  %s: %llu rapports évités, %llu valeurs sous l'hystérésis, %llu absorbées\n", d->name,
+                   (unsigned long long)d->suppressed_frames, (unsigned long long)d->hysteresis_events,
+                   (unsigned long long)d->absorbed_events);
+    }
+    printf("  allocations   %llu (threads HID et d'écriture, régime établi)\n",
+           (unsigned long long)atomic_load(&bench_steady_allocs));
+    char buf[LATENCY_MAX_ENDPOINTS * LAT_STAGE_COUNT * 128];
+    latency_stats_format(buf, sizeof(buf));
+    fputs(buf, stdout);
+
+    runtime_mapping_free(rt);
+    for (int i = 0; i < cfg.devices; i++)
+        bench_destroy_device(gens[i].fd);
+    free_input_devices(devices, cfg.devices);
+    return 0;
+}
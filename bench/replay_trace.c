@@ -0,0 +1,339 @@
+// Rejeu d'une trace evdev (raw_joystick -R FICHIER) dans le moteur de
+// traduction (hid_engine_*, le même code que le thread HID).
+//
+// Les formats de rapport et le mapping sont ceux de l'enregistrement. Le
+// rejeu est déterministe : chaque lot enregistré produit les mêmes rapports,
+// écrits au format de capture (SinkCaptureHeader / SinkCaptureRecord, heure
+// relative au début de la trace) et comparables octet par octet à une sortie
+// de référence.
+//
+// Usage: replay_trace [-t] [-o sortie] [-g référence] [-n passes] trace
+//   -t  temps réel (cadence de l'enregistrement) ; défaut : au plus vite
+//   -o  écrit les rapports produits
+//   -g  compare les rapports produits à un fichier écrit par -o
+//   -n  répète le rejeu (mesure de débit ; seule la première passe écrit et compare)
+#include "input_trace.h"
+#include "input_mapping.h"
+#include "mapping_cache.h"
+#include "runtime_mapping.h"
+#include "report_layout.h"
+#include "usb_descriptors.h"
+#include "usb_hid.h"
+#include "output_sink.h"
+#include "latency_stats.h"
+#include "log_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+typedef struct {
+    int realtime;
+    FILE *out;
+    const uint8_t *golden;
+    size_t golden_len;
+} ReplayConfig;
+
+typedef struct {
+    InputDevice *devices;       // Configuration courante, un par uid
+    int nb_devices;
+    int capacity;
+    bool dirty;                 // Mapping à reconstruire avant le prochain lot
+    RuntimeMapping *rt;
+    HidEngine *engine;
+    struct input_event *events; // Lot converti
+    int events_capacity;
+    // Sortie
+    size_t golden_off;
+    uint64_t mismatches;
+    uint64_t first_mismatch;    // Index du premier rapport différent (+1)
+    uint64_t records;
+    uint64_t nb_events;
+    uint64_t reports;
+} ReplayState;
+
+// Formats de rapport de l'enregistrement
+static int configure_reports(const InputTraceHeader *hdr) {
+    VirtualJoystickLayout layouts[MAX_VIRTUAL_JOYSTICKS];
+    ReportLayout reports[MAX_VIRTUAL_JOYSTICKS];
+    for (uint32_t j = 0; j < hdr->nb_joysticks; j++) {
+        const InputTraceReport *tr = &hdr->reports[j];
+        layouts[j].nb_axes = tr->nb_axes;
+        layouts[j].nb_buttons = tr->nb_buttons;
+        layouts[j].compact = tr->compact;
+        layouts[j].axis_bits = tr->axis_bits;
+        if (report_layout_custom(&reports[j], j, tr->report_axis_bits, tr->axis_slots, tr->report_nb_axes,
+                                 tr->button_slots, tr->report_nb_buttons) < 0)
+            return -1;
+    }
+    return usb_configure_joysticks(layouts, reports, hdr->nb_joysticks);
+}
+
+static int replay_device(ReplayState *rs, const InputTraceRecord *rec, const void *payload) {
+    InputDevice dev;
+    if (!input_trace_decode_device(rec, payload, &dev)) {
+        fprintf(stderr, "Enregistrement de périphérique invalide (uid %u)\n", rec->uid);
+        return -1;
+    }
+    int i = 0;
+    while (i < rs->nb_devices && rs->devices[i].uid != rec->uid)
+        i++;
+    if (i == rs->nb_devices) {
+        if (rs->nb_devices == rs->capacity) {
+            int capacity = rs->capacity ? rs->capacity * 2 : 8;
+            InputDevice *devices = realloc(rs->devices, capacity * sizeof(InputDevice));
+            if (!devices) {
+                perror("malloc devices");
+                return -1;
+            }
+            rs->devices = devices;
+            rs->capacity = capacity;
+        }
+        rs->nb_devices++;
+    }
+    rs->devices[i] = dev;
+    rs->dirty = true;
+    return 0;
+}
+
+static int rebuild_mapping(ReplayState *rs) {
+    if (!rs->dirty)
+        return 0;
+    // Le mapping précédent référence encore les périphériques : remplacé avant libération
+    RuntimeMapping *rt = runtime_mapping_build(rs->devices, rs->nb_devices);
+    if (!rt)
+        return -1;
+    hid_engine_set_mapping(rs->engine, rt);
+    runtime_mapping_free(rs->rt);
+    rs->rt = rt;
+    rs->dirty = false;
+    return 0;
+}
+
+static void emit_reports(ReplayState *rs, const ReplayConfig *cfg, uint64_t ts_ns) {
+    uint8_t report[HID_MAX_REPORT_SIZE];
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        int len = hid_engine_take_report(rs->engine, j, report);
+        if (len <= 0)
+            continue;
+        rs->reports++;
+        if (!cfg->out && !cfg->golden)
+            continue;
+        SinkCaptureRecord crec = { .ts_ns = ts_ns, .joy = (uint16_t)j, .length = (uint16_t)len, .event = 0 };
+        if (cfg->out) {
+            fwrite(&crec, sizeof(crec), 1, cfg->out);
+            fwrite(report, len, 1, cfg->out);
+        }
+        if (cfg->golden) {
+            size_t need = sizeof(crec) + len;
+            bool same = cfg->golden_len - rs->golden_off >= need &&
+                        memcmp(cfg->golden + rs->golden_off, &crec, sizeof(crec)) == 0 &&
+                        memcmp(cfg->golden + rs->golden_off + sizeof(crec), report, len) == 0;
+            if (!same) {
+                if (!rs->mismatches)
+                    rs->first_mismatch = rs->reports;
+                rs->mismatches++;
+            }
+            rs->golden_off += need;
+        }
+    }
+}
+
+static int replay_once(const InputTraceHeader *hdr, const char *path, const ReplayConfig *cfg, ReplayState *rs) {
+    InputTraceReader reader;
+    if (input_trace_open(path, &reader) < 0)
+        return -1;
+    const InputTraceRecord *rec, *next;
+    const void *payload, *next_payload;
+    bool have_next = input_trace_next(&reader, &next, &next_payload);
+    uint64_t first_ts = 0, start = latency_now_ns();
+    int rv = 0;
+    while (have_next && rv == 0) {
+        rec = next;
+        payload = next_payload;
+        have_next = input_trace_next(&reader, &next, &next_payload);
+        rs->records++;
+        if (!first_ts)
+            first_ts = rec->ts_ns;
+        if (cfg->realtime) {
+            uint64_t due = start + (rec->ts_ns - first_ts);
+            struct timespec ts = { .tv_sec = due / 1000000000ULL, .tv_nsec = due % 1000000000ULL };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        if (rec->type == INPUT_TRACE_DEVICE) {
+            rv = replay_device(rs, rec, payload);
+            continue;
+        }
+        if (rebuild_mapping(rs) < 0) {
+            rv = -1;
+            break;
+        }
+        if (rec->type == INPUT_TRACE_SEED && rec->length == sizeof(InputTraceState)) {
+            hid_engine_seed(rs->engine, rec->uid, payload);
+        } else if (rec->type == INPUT_TRACE_EVENTS) {
+            int count = rec->length / sizeof(InputTraceEvent);
+            if (count > rs->events_capacity) {
+                struct input_event *events = realloc(rs->events, count * sizeof(struct input_event));
+                if (!events) {
+                    perror("malloc events");
+                    rv = -1;
+                    break;
+                }
+                rs->events = events;
+                rs->events_capacity = count;
+            }
+            const InputTraceEvent *te = payload;
+            for (int i = 0; i < count; i++) {
+                uint64_t ts = rec->ts_ns - (uint64_t)te[i].age_us * 1000;
+                memset(&rs->events[i], 0, sizeof(struct input_event));
+                rs->events[i].input_event_sec = ts / 1000000000ULL;
+                rs->events[i].input_event_usec = (ts % 1000000000ULL) / 1000;
+                rs->events[i].type = te[i].type;
+                rs->events[i].code = te[i].code;
+                rs->events[i].value = te[i].value;
+            }
+            // Un recalage déclenché par ce lot est enregistré juste après lui
+            const InputTraceState *resync = NULL;
+            if (have_next && next->type == INPUT_TRACE_RESYNC && next->uid == rec->uid &&
+                next->length == sizeof(InputTraceState)) {
+                resync = next_payload;
+                have_next = input_trace_next(&reader, &next, &next_payload);
+                rs->records++;
+            }
+            hid_engine_feed(rs->engine, rec->uid, rs->events, count, resync);
+            rs->nb_events += count;
+        } else {
+            continue;
+        }
+        emit_reports(rs, cfg, rec->ts_ns - hdr->start_ns);
+    }
+    input_trace_close(&reader);
+    return rv;
+}
+
+static void replay_reset(ReplayState *rs) {
+    runtime_mapping_free(rs->rt);
+    hid_engine_free(rs->engine);
+    free(rs->devices);
+    free(rs->events);
+    memset(rs, 0, sizeof(*rs));
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t] [-o sortie] [-g référence] [-n passes] trace\n", prog);
+}
+
+int main(int argc, char **argv) {
+    ReplayConfig cfg = { 0 };
+    const char *out_path = NULL, *golden_path = NULL;
+    int passes = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "to:g:n:")) != -1) {
+        switch (opt) {
+            case 't': cfg.realtime = 1; break;
+            case 'o': out_path = optarg; break;
+            case 'g': golden_path = optarg; break;
+            case 'n': passes = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1 || passes < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *path = argv[optind];
+    log_ring_set_level(LOG_LEVEL_ERROR);
+    log_ring_configure_from_env();
+
+    InputTraceReader reader;
+    if (input_trace_open(path, &reader) < 0)
+        return 1;
+    InputTraceHeader hdr = *reader.header;
+    input_trace_close(&reader);
+    if (configure_reports(&hdr) < 0) {
+        fprintf(stderr, "%s: formats de rapport invalides\n", path);
+        return 1;
+    }
+
+    SinkCaptureHeader chdr;
+    memset(&chdr, 0, sizeof(chdr));
+    memcpy(chdr.magic, SINK_CAPTURE_MAGIC, sizeof(chdr.magic));
+    chdr.version = 1;
+    uint8_t *golden = NULL;
+    if (golden_path) {
+        FILE *g = fopen(golden_path, "rb");
+        if (!g) {
+            perror(golden_path);
+            return 1;
+        }
+        fseek(g, 0, SEEK_END);
+        long len = ftell(g);
+        fseek(g, 0, SEEK_SET);
+        golden = malloc(len > 0 ? len : 1);
+        if (!golden || len < (long)sizeof(chdr) || fread(golden, len, 1, g) != 1 ||
+            memcmp(golden, &chdr, sizeof(chdr)) != 0) {
+            fprintf(stderr, "%s: pas une sortie de replay_trace\n", golden_path);
+            fclose(g);
+            return 1;
+        }
+        fclose(g);
+        cfg.golden = golden + sizeof(chdr);
+        cfg.golden_len = len - sizeof(chdr);
+    }
+    if (out_path) {
+        cfg.out = fopen(out_path, "wb");
+        if (!cfg.out) {
+            perror(out_path);
+            return 1;
+        }
+        fwrite(&chdr, sizeof(chdr), 1, cfg.out);
+    }
+
+    ReplayState rs;
+    memset(&rs, 0, sizeof(rs));
+    uint64_t records = 0, events = 0, reports = 0, mismatches = 0, first_mismatch = 0;
+    bool golden_short = false;
+    uint64_t t_start = latency_now_ns();
+    int rv = 0;
+    for (int p = 0; p < passes && rv == 0; p++) {
+        rs.engine = hid_engine_create();
+        if (!rs.engine)
+            return 1;
+        rv = replay_once(&hdr, path, &cfg, &rs);
+        records += rs.records;
+        events += rs.nb_events;
+        reports += rs.reports;
+        if (p == 0) {
+            mismatches = rs.mismatches;
+            first_mismatch = rs.first_mismatch;
+            golden_short = cfg.golden && rs.golden_off != cfg.golden_len;
+            cfg.out = out_path ? (fclose(cfg.out), NULL) : NULL;
+            cfg.golden = NULL;
+        }
+        replay_reset(&rs);
+    }
+    uint64_t elapsed = latency_now_ns() - t_start;
+    free(golden);
+    if (rv < 0)
+        return 1;
+
+    double seconds = elapsed / 1e9;
+    printf("replay: %d passe(s), %llu enregistrements, %d joysticks virtuels%s\n", passes,
+           (unsigned long long)records, usb_nb_joysticks, cfg.realtime ? ", temps réel" : "");
+    printf("  événements    %llu (%.0f/s, %.0f ns/événement)\n", (unsigned long long)events,
+           events / seconds, events ? (double)elapsed / events : 0.0);
+    printf("  rapports      %llu\n", (unsigned long long)reports);
+    if (golden_path) {
+        if (mismatches || golden_short) {
+            printf("  référence     DIFFERENTE : %llu rapports différents (premier : n°%llu)%s\n",
+                   (unsigned long long)mismatches, (unsigned long long)first_mismatch,
+                   golden_short ? ", longueur différente" : "");
+            return 2;
+        }
+        printf("  référence     identique\n");
+    }
+    return 0;
+}
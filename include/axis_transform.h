@@ -0,0 +1,100 @@
+#ifndef AXIS_TRANSFORM_H
+#define AXIS_TRANSFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <linux/input.h>
+
+// Plage maximale (max - min) pour laquelle on précalcule une table directe
+#define AXIS_LUT_MAX_RANGE 1023
+// Entrées maximales d'une table d'axe avec courbe : au-delà, la plage native
+// est échantillonnée (la sortie HID n'a de toute façon que 16 bits)
+#define AXIS_CURVE_LUT_MAX_ENTRIES 65536
+// Points de contrôle d'une courbe de réponse
+#define AXIS_CURVE_MAX_POINTS 16
+
+// Courbe de réponse d'un axe : points de contrôle (x croissants strictement)
+// en unités HID, reliés par une spline cubique monotone (Hermite, pentes en
+// moyenne harmonique pondérée : pas de dépassement entre deux points). Les extrémités
+// (-32768, -32768) et (32767, 32767) sont implicites si aucun point ne les
+// couvre. nb_points == 0 : réponse linéaire.
+typedef struct AxisCurve {
+    uint8_t nb_points;
+    int16_t x[AXIS_CURVE_MAX_POINTS];
+    int16_t y[AXIS_CURVE_MAX_POINTS];
+} AxisCurve;
+
+struct AxisTable;
+
+// Transformation précompilée d'un axe physique vers la valeur HID 16 bits.
+// Equivalent à : clamp, mise à l'échelle sur [-32768, 32767], inversion, zone morte,
+// courbe, quantification (les extrémités restent atteignables). Un axe avec
+// courbe passe toujours par une table.
+typedef struct AxisTransform {
+    int32_t minimum;          // Valeur physique minimale
+    int32_t maximum;          // Valeur physique maximale
+    const int16_t *lut;       // Table directe indexée par (val - minimum) >> lut_shift, NULL sinon
+    struct AxisTable *table;  // Table partagée qui porte lut
+    uint64_t mul;             // Réciproque en virgule fixe de la plage
+    uint8_t shift;            // Décalage associé à mul
+    uint8_t pre_shift;        // Décalage d'entrée pour les très grandes plages
+    uint8_t invert;           // Inversion de l'axe
+    uint8_t degenerate;       // Plage nulle : la sortie vaut toujours 0
+    uint8_t lut_shift;        // Echantillonnage de la plage native par la table
+    int32_t dead_zone;        // Zone morte autour du centre
+    int32_t quantum;          // Pas de quantification de la sortie (0 ou 1 : aucun)
+} AxisTransform;
+
+// Compile les paramètres d'un axe (curve NULL : réponse linéaire). Les tables
+// sont partagées entre les axes de mêmes paramètres et entre les mappings
+// successifs : recompiler un mapping ne recalcule que les tables des axes
+// modifiés. Retourne false en cas d'échec d'allocation.
+bool axis_transform_compile(AxisTransform *t, const struct input_absinfo *info, int invert, int dead_zone,
+                            int quantum, const AxisCurve *curve);
+// Libère la référence éventuelle à la table
+void axis_transform_release(AxisTransform *t);
+// Tables calculées et réutilisées depuis le démarrage
+void axis_transform_table_counts(uint64_t *built, uint64_t *reused);
+
+// Valide une courbe (x strictement croissants) ; retourne false sinon
+bool axis_curve_valid(const AxisCurve *curve);
+
+// Mise à l'échelle, inversion et zone morte (chemin générique par réciproque)
+static inline int32_t axis_transform_linear(const AxisTransform *t, int32_t val) {
+    if (t->degenerate)
+        return 0;
+    uint64_t v = (uint64_t)((int64_t)val - t->minimum) >> t->pre_shift;
+    int32_t out = (int32_t)((v * t->mul) >> t->shift) - 32768;
+    if (t->invert)
+        out = (out == -32768) ? 32767 : -out;
+    if (out > -t->dead_zone && out < t->dead_zone)
+        out = 0;
+    return out;
+}
+
+static inline int16_t axis_transform_quantize(const AxisTransform *t, int32_t out) {
+    if (t->quantum > 1 && out > -32768 && out < 32767) {
+        // Arrondi symétrique au multiple le plus proche : le centre reste 0
+        int32_t q = t->quantum;
+        out = out >= 0 ? (out + q / 2) / q * q : -((-out + q / 2) / q * q);
+        if (out > 32767) out = 32767;
+        if (out < -32768) out = -32768;
+    }
+    return (int16_t)out;
+}
+
+// Chemin sans table (axe sans courbe de grande plage)
+static inline int16_t axis_transform_compute(const AxisTransform *t, int32_t val) {
+    return axis_transform_quantize(t, axis_transform_linear(t, val));
+}
+
+// Application sur le chemin chaud : clamp puis table ou multiplication
+static inline int16_t axis_transform_apply(const AxisTransform *t, int32_t val) {
+    if (val < t->minimum) val = t->minimum;
+    if (val > t->maximum) val = t->maximum;
+    if (t->lut)
+        return t->lut[((uint32_t)val - (uint32_t)t->minimum) >> t->lut_shift];
+    return axis_transform_compute(t, val);
+}
+
+#endif // AXIS_TRANSFORM_H
@@ -0,0 +1,24 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H
+
+#include <stddef.h>
+
+// Socket Unix de contrôle du démon. Une commande par connexion, terminée par
+// '\n', réponse "ok\n" ou "error <raison>\n" :
+//   reload            relit g_mapping_file et remplace le mapping à chaud
+//   reload <chemin>   idem depuis un autre fichier JSON
+//   ping              vérifie que le démon répond
+
+// Chemin par défaut (RAW_JOYSTICK_CONTROL_SOCKET pour le changer)
+#define CONTROL_SOCKET_DEFAULT_PATH "/run/raw_joystick.sock"
+#define CONTROL_SOCKET_MAX_LINE 1024
+
+// Démarre / arrête le thread d'écoute (path NULL : chemin par défaut ou environnement)
+int control_socket_start(const char *path);
+void control_socket_stop(void);
+
+// Recharge le mapping depuis filename et le publie au thread HID.
+// Retourne 0, ou -1 avec un message dans err.
+int control_reload_mapping(const char *filename, char *err, size_t err_len);
+
+#endif // CONTROL_SOCKET_H
@@ -0,0 +1,25 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include "input_mapping.h"
+
+// Table des périphériques d'entrée ouverts (g_devices / g_nb_joysticks) et
+// publication du mapping correspondant au thread HID. Les modifications
+// à chaud (rechargement, hotplug) sont sérialisées par device_table_lock().
+
+void device_table_lock(void);
+void device_table_unlock(void);
+
+// Copie de la table courante avec de la place pour extra entrées (verrou tenu).
+// Les descripteurs sont partagés avec la table courante.
+InputDevice *device_table_copy(int extra);
+
+// Compile devices (nb entrées), le publie au thread HID et en fait la table
+// courante ; l'ancienne table est libérée sans fermer ses descripteurs.
+// Verrou tenu. Retourne 0, ou -1 si la compilation échoue (devices inchangé).
+int device_table_publish(InputDevice *devices, int nb);
+
+// Index du périphérique ouvert sur path, -1 s'il est absent (verrou tenu)
+int device_table_find_path(const char *path);
+
+#endif // DEVICE_TABLE_H
@@ -2,8 +2,9 @@
 #define EP0_H
 
 #include "usb_raw.h"
+#include "output_sink.h"
 // Prototypes des fonctions de gestion de l'endpoint 0
-void ep0_loop(int fd);
+void ep0_loop(int fd, OutputSink *sink);
 
 
 #endif // EP0_H
@@ -0,0 +1,13 @@
+#ifndef HOTPLUG_H
+#define HOTPLUG_H
+
+// Surveillance de /dev/input (inotify) : les noeuds eventX créés sont sondés,
+// fusionnés avec le mapping sauvegardé et ajoutés au thread HID ; les noeuds
+// supprimés sont retirés. Le périphérique USB virtuel reste énuméré.
+
+#define HOTPLUG_INPUT_DIR "/dev/input"
+
+int hotplug_start(void);
+void hotplug_stop(void);
+
+#endif // HOTPLUG_H
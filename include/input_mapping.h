@@ -4,6 +4,9 @@
 #include <linux/input.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "usb_descriptors.h"    // Pour MAX_BUTTONS
+#include "axis_transform.h"     // Pour AxisCurve
 
 // On s'assure que KEY_MAX est défini (normalement dans <linux/input.h>)
 #ifndef KEY_MAX
@@ -18,29 +21,59 @@ typedef struct InputDevice {
     int has_abs[ABS_CNT];              // Indique si l'axe est présent
     int axis_mapping[ABS_CNT];         // Mapping physique vers virtuel
     int axis_dead_zone[ABS_CNT];       // Zone morte pour chaque axe
+    int axis_hysteresis[ABS_CNT];      // Hystérésis (unités HID) : variations plus petites ignorées
+    int axis_quantization[ABS_CNT];    // Pas de quantification de la sortie (0 : aucun)
+    AxisCurve axis_curve[ABS_CNT];     // Courbe de réponse (aucun point : linéaire)
     int axis_invert[ABS_CNT];          // Inversion de l'axe
-    int axis_virtual_joystick[ABS_CNT]; // Joystick virtuel cible (0 ou 1)
-    int axis_virtual_axis[ABS_CNT];     // Axe virtuel (0 à 7)
+    int axis_virtual_joystick[ABS_CNT]; // Joystick virtuel cible (0 à usb_nb_joysticks - 1)
+    int axis_virtual_axis[ABS_CNT];     // Axe virtuel (0 à nb_axes - 1 du joystick)
     int button_mapping[KEY_MAX + 1];         // Mapping des boutons
     int button_virtual_joystick[KEY_MAX + 1];  // Joystick virtuel pour les boutons
     int has_button[KEY_MAX + 1];               // Indique si le bouton existe
     int num_axes;                      // Nombre d'axes détectés
     int num_buttons;                   // Nombre de boutons détectés
     struct input_id id;                // Identifiants du périphérique
+    unsigned uid;                      // Identifiant unique attribué à l'ouverture (0 : non ouvert)
 } InputDevice;
 
+// Index des noeuds hidraw, construit une seule fois au démarrage : identifiants
+// et boutons du descripteur de rapport (lu dans la même ouverture)
+typedef struct HidrawEntry {
+    char path[64];
+    uint32_t bustype;
+    uint16_t vendor;
+    uint16_t product;
+    int nb_buttons;                    // -1 si le descripteur n'a pas de plage de boutons
+    int button_codes[MAX_BUTTONS];
+} HidrawEntry;
+
+typedef struct HidrawIndex {
+    HidrawEntry *entries;
+    int count;
+} HidrawIndex;
+
 // Variables globales (définies dans input_mapping.c)
 extern InputDevice *g_devices;
 extern int g_nb_joysticks;
 extern int global_axis_index;
 extern int global_button_index;
 extern char g_mapping_file[PATH_MAX];
+// Disposition des joysticks virtuels lue au démarrage ("virtual_joysticks")
+extern VirtualJoystickLayout g_virtual_joysticks[MAX_VIRTUAL_JOYSTICKS];
+extern int g_nb_virtual_joysticks;
 
 // Prototypes des fonctions de mapping
 int parse_hidraw_buttons(const char *hidraw_path, int *button_codes, int max_buttons);
 int find_hidraw_for_device(InputDevice *dev, char *hidraw_path, size_t hidraw_path_len);
+int hidraw_index_build(HidrawIndex *index);
+const HidrawEntry *hidraw_index_find(const HidrawIndex *index, const struct input_id *id);
+void hidraw_index_free(HidrawIndex *index);
 bool save_mapping(const char *filename, InputDevice *devices, int nb_joysticks, int global_axis, int global_button);
 bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks, int *global_axis, int *global_button);
+int apply_mapping_file(const char *filename, InputDevice *devices, int nb_devices);
+int probe_input_device(const char *path, InputDevice *dev);
+void assign_default_axis_mapping(InputDevice *dev);
 void init_physical_devices_wrapper(InputDevice **final_devices, int *nb_final);
+void free_input_devices(InputDevice *devices, int nb_devices);
 
 #endif // INPUT_MAPPING_H
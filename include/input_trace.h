@@ -0,0 +1,148 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/input.h>
+#include "input_mapping.h"
+#include "usb_descriptors.h"
+
+// Trace binaire des flux evdev lus par le thread HID (-R FICHIER), rejouable
+// dans le moteur de traduction par bench/replay_trace.c.
+//
+// Disposition : InputTraceHeader (dont les formats de rapport des joysticks
+// virtuels), puis une suite d'enregistrements InputTraceRecord suivis de
+// length octets :
+// - INPUT_TRACE_DEVICE : périphérique enregistré ou mapping rechargé
+//   (InputTraceDevice, nb_axes InputTraceAxis, nb_buttons InputTraceButton) ;
+// - INPUT_TRACE_EVENTS : un lot lu par read(), en InputTraceEvent ;
+// - INPUT_TRACE_SEED : état relu à l'enregistrement du périphérique ;
+// - INPUT_TRACE_RESYNC : état relu après un SYN_DROPPED, qui suit le lot
+//   INPUT_TRACE_EVENTS qui l'a déclenché.
+// Entiers dans l'ordre de la machine.
+//
+// L'écriture passe par un anneau vidé par un thread dédié : le thread HID ne
+// fait ni appel système ni allocation. Anneau plein : l'enregistrement est
+// perdu et compté (la trace n'est alors plus rejouable à l'identique).
+
+#define INPUT_TRACE_MAGIC   0x52545645   // "EVTR"
+#define INPUT_TRACE_VERSION 3
+
+enum input_trace_type {
+    INPUT_TRACE_DEVICE = 1,
+    INPUT_TRACE_EVENTS,
+    INPUT_TRACE_SEED,
+    INPUT_TRACE_RESYNC,
+};
+
+// Format compilé d'un rapport, suffisant pour le reconstruire au rejeu
+typedef struct InputTraceReport {
+    int32_t nb_axes;                   // Disposition (VirtualJoystickLayout)
+    int32_t nb_buttons;
+    int32_t compact;
+    int32_t axis_bits;
+    int32_t report_axis_bits;          // Format compilé (ReportLayout)
+    int32_t report_nb_axes;
+    int32_t report_nb_buttons;
+    uint8_t axis_slots[HID_MAX_AXES];
+    uint8_t button_slots[MAX_BUTTONS];
+} InputTraceReport;
+
+typedef struct InputTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t start_ns;                 // CLOCK_MONOTONIC au début de l'enregistrement
+    uint32_t nb_joysticks;
+    uint32_t reserved;
+    InputTraceReport reports[MAX_VIRTUAL_JOYSTICKS];
+} InputTraceHeader;
+
+typedef struct InputTraceRecord {
+    uint64_t ts_ns;                    // Instant de la lecture (CLOCK_MONOTONIC)
+    uint32_t uid;                      // InputDevice.uid
+    uint16_t type;                     // enum input_trace_type
+    uint16_t reserved;
+    uint32_t length;                   // Octets qui suivent
+    uint32_t reserved2;
+} InputTraceRecord;
+
+// Evénement compact : horodatage relatif à la lecture
+typedef struct InputTraceEvent {
+    uint32_t age_us;                   // ts_ns de l'enregistrement - horodatage evdev
+    uint16_t type;
+    uint16_t code;
+    int32_t value;
+} InputTraceEvent;
+
+typedef struct InputTraceDevice {
+    char name[256];
+    uint16_t bustype;
+    uint16_t vendor;
+    uint16_t product;
+    uint16_t version;
+    uint32_t nb_axes;
+    uint32_t nb_buttons;
+} InputTraceDevice;
+
+typedef struct InputTraceAxis {
+    int32_t code;
+    int32_t minimum;
+    int32_t maximum;
+    int32_t fuzz;
+    int32_t flat;
+    int32_t resolution;
+    int32_t mapped;
+    int32_t dead_zone;
+    int32_t hysteresis;
+    int32_t quantization;
+    int32_t invert;
+    int32_t virtual_joystick;
+    int32_t virtual_axis;
+    AxisCurve curve;
+} InputTraceAxis;
+
+typedef struct InputTraceButton {
+    int32_t code;
+    int32_t mapped;
+    int32_t virtual_joystick;
+} InputTraceButton;
+
+// Etat complet d'un périphérique (EVIOCGKEY, EVIOCGABS)
+typedef struct InputTraceState {
+    uint32_t keys_valid;               // EVIOCGKEY a réussi
+    uint8_t keys[KEY_MAX / 8 + 1];
+    uint8_t abs_valid[ABS_CNT / 8 + 1]; // EVIOCGABS a réussi, par code
+    int32_t abs[ABS_CNT];
+} InputTraceState;
+
+// Enregistrement : démarre le thread d'écriture et écrit l'en-tête (formats
+// de rapport courants) ; retourne -1 si le fichier ne peut être créé
+int input_trace_start(const char *path);
+// Vide l'anneau, ferme le fichier et affiche les enregistrements perdus
+void input_trace_stop(void);
+bool input_trace_active(void);
+
+// Appelées par le thread HID (producteur unique)
+void input_trace_device(const InputDevice *dev);
+void input_trace_events(unsigned uid, const struct input_event *events, int count);
+void input_trace_state(unsigned uid, int type, const InputTraceState *state);
+
+// Lecture d'une trace (fichier projeté en mémoire)
+typedef struct InputTraceReader {
+    const uint8_t *base;
+    size_t len;
+    size_t off;
+    const InputTraceHeader *header;
+} InputTraceReader;
+
+// Retourne -1 si le fichier n'est pas une trace valide
+int input_trace_open(const char *path, InputTraceReader *reader);
+// Enregistrement suivant et ses données ; false en fin de trace (ou trace tronquée)
+bool input_trace_next(InputTraceReader *reader, const InputTraceRecord **rec, const void **payload);
+void input_trace_close(InputTraceReader *reader);
+
+// Décode un enregistrement INPUT_TRACE_DEVICE (fd à -1, uid de l'enregistrement)
+bool input_trace_decode_device(const InputTraceRecord *rec, const void *payload, InputDevice *dev);
+
+#endif // INPUT_TRACE_H
@@ -0,0 +1,50 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Histogrammes de latence de type HDR : 16 sous-intervalles par puissance de 2,
+// soit une précision relative d'environ 6 % de la nanoseconde à plusieurs heures.
+#define LAT_HIST_SUB_BITS 4
+#define LAT_HIST_SUB_COUNT (1 << LAT_HIST_SUB_BITS)
+#define LAT_HIST_BUCKETS ((64 - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB_COUNT)
+
+// Nombre d'endpoints (joysticks virtuels) instrumentés : MAX_VIRTUAL_JOYSTICKS
+#define LATENCY_MAX_ENDPOINTS 8
+
+// Etapes mesurées pour chaque rapport envoyé
+enum latency_stage {
+    LAT_STAGE_READ_TO_COMMIT = 0,   // horodatage evdev du SYN_REPORT -> état du rapport mis à jour
+    LAT_STAGE_COMMIT_TO_WRITE,      // état mis à jour -> retour de l'écriture sur l'endpoint
+    LAT_STAGE_TOTAL,                // horodatage evdev -> retour de l'écriture
+    LAT_STAGE_COUNT
+};
+
+// Un seul écrivain (le thread d'écriture de l'endpoint), lecteurs concurrents tolérés
+typedef struct {
+    _Atomic uint64_t counts[LAT_HIST_BUCKETS];
+    _Atomic uint64_t total;
+    _Atomic uint64_t max;
+} LatencyHistogram;
+
+// Horloge commune (CLOCK_MONOTONIC, la même que celle des événements evdev)
+uint64_t latency_now_ns(void);
+
+void latency_hist_record(LatencyHistogram *h, uint64_t ns);
+uint64_t latency_hist_percentile(const LatencyHistogram *h, double percentile);
+void latency_hist_reset(LatencyHistogram *h);
+
+// Enregistrement par endpoint et par étape
+void latency_stats_record(int endpoint, int stage, uint64_t ns);
+void latency_stats_reset(void);
+// Résumé texte (p50/p99/p999/max) ; retourne la longueur écrite
+size_t latency_stats_format(char *buf, size_t len);
+
+// Vidage sur signal : le gestionnaire ne fait que lever un drapeau,
+// latency_stats_poll_dump() (appelée périodiquement) imprime le résumé.
+void latency_stats_install_signal(int signum);
+void latency_stats_poll_dump(void);
+
+#endif // LATENCY_STATS_H
@@ -0,0 +1,64 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+
+// Journalisation asynchrone : chaque thread producteur dispose de son propre
+// anneau sans verrou (un seul producteur, un seul consommateur) d'enregistrements
+// binaires de taille fixe. Le formatage et l'écriture sur stdout sont faits par
+// un thread de vidage ; le producteur ne fait qu'une copie bornée.
+
+// Catégories (chacune a sa propre limite de débit)
+enum log_category {
+    LOG_CAT_GENERAL = 0,
+    LOG_CAT_AXIS,
+    LOG_CAT_BUTTON,
+    LOG_CAT_DEVICE,
+    LOG_CAT_USB,
+    LOG_CAT_EP0,
+    LOG_CAT_COUNT
+};
+
+// Niveaux de verbosité
+enum log_level {
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+};
+
+// Nombre maximum de threads producteurs simultanés : lecteurs HID et thread
+// d'agrégation, un thread d'écriture par endpoint, ep0, contrôle, hotplug et
+// une réserve. Les deux limites sont définies dans usb_hid.h et
+// usb_descriptors.h, inclus par log_ring.c.
+#define LOG_MAX_PRODUCERS (HID_MAX_READERS + MAX_VIRTUAL_JOYSTICKS + 4)
+// Nombre d'enregistrements par anneau (puissance de 2)
+#define LOG_RING_SIZE 1024
+// Nombre maximum d'arguments numériques et taille cumulée des chaînes par message
+#define LOG_MAX_ARGS 8
+#define LOG_STR_MAX 96
+
+// Configuration (utilisables à tout moment)
+void log_ring_set_level(int level);
+int log_ring_get_level(void);
+void log_ring_set_rate(int category, unsigned per_second);   // 0 = illimité
+// Lit RAW_JOYSTICK_LOG_LEVEL (error|info|debug) et RAW_JOYSTICK_LOG_RATE ("axis=50,button=100")
+void log_ring_configure_from_env(void);
+// Applique une option "cat=rate" ou "level=..." (utilisé par l'environnement)
+int log_ring_apply_option(const char *opt);
+
+// Cycle de vie du thread de vidage
+int log_ring_start(void);
+void log_ring_stop(void);
+// Fonction appelée par le thread de vidage à chaque période (vidage de statistiques...)
+void log_ring_set_periodic_hook(void (*hook)(void));
+
+// Attribue / libère l'anneau du thread appelant. Sans anneau, log_msg écrit
+// directement sur stdout (démarrage, outils).
+int log_ring_register_thread(const char *name);
+void log_ring_release_thread(void);
+
+// Enregistre un message au format printf. Les chaînes (%s) sont copiées dans
+// l'enregistrement ; seules les conversions d i u x X o c s p f g e sont gérées.
+void log_msg(int category, int level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#endif // LOG_RING_H
@@ -0,0 +1,90 @@
+#ifndef MAPPING_CACHE_H
+#define MAPPING_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "input_mapping.h"
+
+// Cache binaire du mapping, écrit à côté du JSON (<fichier>.cache) et projeté
+// en mémoire au chargement suivant. Il n'est valide que si la taille et le
+// hachage du JSON source correspondent : le JSON n'est re-analysé que lorsqu'il
+// change. Seules les entrées qui diffèrent des valeurs par défaut de
+// load_mapping sont stockées, ainsi que la disposition des joysticks virtuels.
+//
+// Disposition : MappingCacheHeader, puis pour chaque périphérique un
+// MappingCacheDevice suivi de nb_axes MappingCacheAxis et nb_buttons
+// MappingCacheButton. Entiers dans l'ordre de la machine.
+
+#define MAPPING_CACHE_MAGIC   0x50414d4a   // "JMAP"
+#define MAPPING_CACHE_VERSION 5
+#define MAPPING_CACHE_SUFFIX  ".cache"
+
+typedef struct MappingCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_hash;              // FNV-1a 64 bits du JSON source
+    uint64_t source_size;              // Taille du JSON source en octets
+    uint32_t total_size;               // Taille totale du cache
+    uint32_t nb_devices;
+    int32_t global_axis;
+    int32_t global_button;
+    uint32_t nb_layouts;               // 0 : pas de "virtual_joysticks" dans le JSON
+    struct {
+        int32_t nb_axes;
+        int32_t nb_buttons;
+        int32_t compact;
+        int32_t axis_bits;
+    } layouts[MAX_VIRTUAL_JOYSTICKS];
+} MappingCacheHeader;
+
+typedef struct MappingCacheDevice {
+    char path[256];
+    char name[256];
+    uint16_t bustype;
+    uint16_t vendor;
+    uint16_t product;
+    uint16_t version;
+    int32_t num_axes;
+    int32_t num_buttons;
+    uint32_t nb_axes;                  // Entrées MappingCacheAxis qui suivent
+    uint32_t nb_buttons;               // Entrées MappingCacheButton qui suivent
+} MappingCacheDevice;
+
+typedef struct MappingCacheAxis {
+    int32_t code;
+    int32_t mapped;
+    int32_t dead_zone;
+    int32_t hysteresis;
+    int32_t quantization;
+    int32_t invert;
+    int32_t virtual_joystick;
+    int32_t virtual_axis;
+    AxisCurve curve;
+} MappingCacheAxis;
+
+typedef struct MappingCacheButton {
+    int32_t code;
+    int32_t mapped;
+    int32_t virtual_joystick;
+} MappingCacheButton;
+
+// Hachage du JSON source
+uint64_t mapping_cache_hash(const void *data, size_t len);
+
+// Initialise un périphérique chargé depuis un mapping (valeurs par défaut, fd à -1)
+void mapping_cache_reset_device(InputDevice *dev);
+
+// Charge le cache de json_file s'il correspond au JSON (hash, size).
+// Retourne false si le cache est absent, périmé ou invalide.
+bool mapping_cache_load(const char *json_file, uint64_t hash, size_t size,
+                        InputDevice **devices, int *nb_devices, int *global_axis, int *global_button,
+                        VirtualJoystickLayout *layouts, int *nb_layouts);
+
+// Écrit le cache de json_file (fichier temporaire puis rename) ; les erreurs
+// sont ignorées, le JSON restant la référence.
+void mapping_cache_store(const char *json_file, uint64_t hash, size_t size,
+                         const InputDevice *devices, int nb_devices, int global_axis, int global_button,
+                         const VirtualJoystickLayout *layouts, int nb_layouts);
+
+#endif // MAPPING_CACHE_H
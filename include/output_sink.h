@@ -0,0 +1,78 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/usb/ch9.h>
+
+// Destination des rapports HID produits par le moteur de traduction.
+// Trois implémentations : gadget USB raw (production), joystick virtuel
+// uinput (exécution locale) et fichier de capture horodaté (mesure, tests).
+
+// Evénements de cycle de vie transmis au puits
+enum sink_event {
+    SINK_EVENT_CONFIGURED = 1,    // Configuration choisie, les rapports peuvent partir
+    SINK_EVENT_RESET,             // Reset du bus : endpoints invalidés
+    SINK_EVENT_DISCONNECT,        // Déconnexion de l'hôte
+    SINK_EVENT_SHUTDOWN,          // Arrêt du démon
+};
+
+typedef struct OutputSink OutputSink;
+
+typedef struct OutputSinkOps {
+    const char *name;
+    // Non nul si write_report bloque jusqu'à l'interrogation de l'endpoint par
+    // l'hôte ; sinon le thread d'écriture cadence lui-même les rapports.
+    int host_paced;
+    // Active l'endpoint du joystick virtuel joy. Retourne 0 ou -1 (errno positionné).
+    int (*enable_endpoint)(OutputSink *sink, int joy, struct usb_endpoint_descriptor *desc);
+    // Envoie un rapport complet. Retourne le nombre d'octets écrits ou -1 (errno
+    // positionné ; ESHUTDOWN signifie que l'hôte a réinitialisé le périphérique).
+    int (*write_report)(OutputSink *sink, int joy, const uint8_t *report, size_t len);
+    void (*lifecycle)(OutputSink *sink, int event);
+    void (*destroy)(OutputSink *sink);
+} OutputSinkOps;
+
+struct OutputSink {
+    const OutputSinkOps *ops;
+    void *priv;
+};
+
+// Format du fichier de capture : en-tête puis suite d'enregistrements
+#define SINK_CAPTURE_MAGIC "RJCAP01"
+typedef struct {
+    char magic[8];                // SINK_CAPTURE_MAGIC
+    uint32_t version;             // 1
+    uint32_t reserved;
+} __attribute__((packed)) SinkCaptureHeader;
+
+typedef struct {
+    uint64_t ts_ns;               // CLOCK_MONOTONIC
+    uint16_t joy;                 // Joystick virtuel (rapports) ou 0
+    uint16_t length;              // Octets de rapport qui suivent (0 pour un événement)
+    uint32_t event;               // 0 pour un rapport, sinon enum sink_event
+} __attribute__((packed)) SinkCaptureRecord;
+
+// Constructeurs
+OutputSink *sink_raw_gadget_create(int gadget_fd);
+OutputSink *sink_uinput_create(void);
+OutputSink *sink_capture_create(const char *path);
+
+// Crée un puits à partir d'une spécification "gadget", "uinput" ou "capture:FICHIER"
+OutputSink *output_sink_create(const char *spec, int gadget_fd);
+void output_sink_destroy(OutputSink *sink);
+
+static inline int output_sink_enable_endpoint(OutputSink *sink, int joy, struct usb_endpoint_descriptor *desc) {
+    return sink->ops->enable_endpoint(sink, joy, desc);
+}
+
+static inline int output_sink_write(OutputSink *sink, int joy, const uint8_t *report, size_t len) {
+    return sink->ops->write_report(sink, joy, report, len);
+}
+
+static inline void output_sink_lifecycle(OutputSink *sink, int event) {
+    if (sink->ops->lifecycle)
+        sink->ops->lifecycle(sink, event);
+}
+
+#endif // OUTPUT_SINK_H
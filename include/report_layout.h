@@ -0,0 +1,42 @@
+#ifndef REPORT_LAYOUT_H
+#define REPORT_LAYOUT_H
+
+#include <stdint.h>
+#include "usb_descriptors.h"
+#include "input_mapping.h"
+
+// Compilateur de format de rapport. A partir de la disposition d'un joystick
+// virtuel (et, en mode compact, du mapping chargé au démarrage), il choisit
+// les axes et boutons présents dans le rapport et la largeur des axes, puis
+// produit le descripteur de rapport correspondant et une routine
+// d'assemblage spécialisée. Le rapport est annoncé à l'hôte à l'énumération :
+// un contrôle mappé plus tard hors du rapport compact est ignoré jusqu'au
+// prochain démarrage.
+
+// Format complet : tous les axes et boutons de la disposition
+void report_layout_full(ReportLayout *rl, int joy, const VirtualJoystickLayout *vl);
+
+// Format minimal : seuls les axes et boutons mappés sur joy par devices ;
+// largeur des axes déduite de la résolution des axes sources (8, 10, 12 ou 16
+// bits) sauf si vl->axis_bits l'impose
+void report_layout_compile(ReportLayout *rl, int joy, const VirtualJoystickLayout *vl,
+                           const InputDevice *devices, int nb_devices);
+
+// Format explicite (rejeu d'une trace) ; retourne -1 si les slots ou la
+// largeur ne sont pas valides
+int report_layout_custom(ReportLayout *rl, int joy, int axis_bits, const uint8_t *axis_slots, int nb_axes,
+                         const uint8_t *button_slots, int nb_buttons);
+
+// Ecrit le descripteur de rapport ; retourne sa taille, ou -1 si len est insuffisant
+int report_layout_descriptor(const ReportLayout *rl, uint8_t *desc, int len);
+
+// Décode un rapport vers l'état par axe et bouton virtuel (axes remis sur 16 bits)
+void report_layout_unpack(const ReportLayout *rl, const uint8_t *report, int16_t *axes, uint8_t *buttons);
+
+// Assemble le rapport depuis l'état des axes (16 bits) et des boutons virtuels
+static inline void report_layout_pack(const ReportLayout *rl, uint8_t *report,
+                                      const int16_t *axes, const uint8_t *buttons) {
+    rl->pack(rl, report, axes, buttons);
+}
+
+#endif // REPORT_LAYOUT_H
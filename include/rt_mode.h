@@ -0,0 +1,45 @@
+#ifndef RT_MODE_H
+#define RT_MODE_H
+
+#include <stdbool.h>
+
+// Mode temps réel optionnel (-P/-C) : priorité SCHED_FIFO et affinité CPU pour
+// le thread HID et les threads d'écriture, mémoire verrouillée et préchargée.
+// Après le démarrage, ces threads n'allouent plus et n'écrivent plus sur
+// stdout : les tampons sont préalloués à leur création (et à chaque changement
+// de mapping), les messages passent par l'anneau de log.
+
+#define RT_MODE_NO_CPU (-1)
+
+typedef enum {
+    RT_ROLE_HID = 0,     // Thread de lecture evdev et d'assemblage des rapports
+    RT_ROLE_WRITER,      // Threads d'écriture des endpoints
+    RT_ROLE_READER,      // Lecteurs de périphériques (hid_configure_readers), sans affinité
+    RT_ROLE_COUNT
+} RtRole;
+
+// Active le mode avec la priorité SCHED_FIFO priority ; retourne -1 si elle
+// est hors de la plage du système
+int rt_mode_configure(int priority);
+
+// Affinités au format "CPU[,CPU]" : thread HID puis threads d'écriture (même
+// CPU que le thread HID si le second est omis) ; retourne -1 si invalide
+int rt_mode_parse_cpus(const char *spec);
+
+bool rt_mode_enabled(void);
+
+// Désactive la restitution de mémoire au système, précharge une réserve de
+// tas et verrouille les pages (mlockall) ; sans effet hors mode temps réel.
+// A appeler une fois, avant la création des threads HID.
+void rt_mode_lock_memory(void);
+
+// Appelée par le thread lui-même au démarrage : ordonnancement, affinité et
+// préchargement de la pile. Un échec (EPERM sans CAP_SYS_NICE) est signalé
+// une fois puis le thread continue en ordonnancement normal.
+void rt_mode_enter_thread(RtRole role);
+
+// Vrai dans un thread passé par rt_mode_enter_thread, même hors mode temps
+// réel (comptage des allocations du banc)
+bool rt_mode_is_pipeline_thread(void);
+
+#endif // RT_MODE_H
@@ -0,0 +1,67 @@
+#ifndef RUNTIME_MAPPING_H
+#define RUNTIME_MAPPING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/input.h>
+#include "axis_transform.h"
+#include "input_mapping.h"
+
+// Représentation compacte du mapping utilisée par le thread HID.
+// Elle est construite à partir des InputDevice (configuration "froide") et ne
+// contient que les codes réellement présents sur chaque périphérique.
+
+// Axe présent sur un périphérique
+typedef struct RtAxis {
+    AxisTransform xform;      // Transformation précompilée
+    uint16_t code;            // Code ABS_*
+    int8_t joy;               // Joystick virtuel cible, -1 si non mappé
+    uint8_t slot;             // Axe virtuel (0 à HID_MAX_AXES - 1)
+    int32_t hysteresis;       // Variation minimale de la sortie (unités HID), 0 : aucune
+} RtAxis;
+
+// Bouton présent sur un périphérique (tableau trié par code)
+typedef struct RtButton {
+    uint16_t code;            // Code KEY_* / BTN_*
+    int8_t joy;               // Joystick virtuel cible, -1 si non mappé
+    uint8_t slot;             // Bouton virtuel (0 à MAX_BUTTONS-1)
+} RtButton;
+
+typedef struct RtDevice {
+    int fd;                   // Descripteur evdev
+    unsigned uid;             // Identifiant stable du périphérique ouvert (hotplug)
+    uint16_t nb_axes;
+    uint16_t nb_buttons;
+    int8_t abs_index[ABS_CNT]; // Index dans axes[] par code ABS_*, -1 si absent
+    RtAxis *axes;
+    RtButton *buttons;
+    InputDevice *cfg;         // Configuration froide (nom, boutons découverts)
+} RtDevice;
+
+typedef struct RuntimeMapping {
+    uint64_t generation;      // Numéro de publication (attribué par hid_mapping_swap)
+    int nb_devices;
+    RtDevice *devices;
+} RuntimeMapping;
+
+// Construit la table d'exécution (un seul bloc mémoire, hors tables d'axes)
+RuntimeMapping *runtime_mapping_build(InputDevice *devices, int nb_devices);
+void runtime_mapping_free(RuntimeMapping *rt);
+
+// Recherche dichotomique d'un bouton par code, NULL si le code est inconnu
+static inline const RtButton *runtime_mapping_find_button(const RtDevice *dev, int code) {
+    int lo = 0, hi = dev->nb_buttons - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) >> 1;
+        int c = dev->buttons[mid].code;
+        if (c == code)
+            return &dev->buttons[mid];
+        if (c < code)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return NULL;
+}
+
+#endif // RUNTIME_MAPPING_H
@@ -26,7 +26,8 @@ extern "C" {
 #define USB_VENDOR      0x1d6b
 #define USB_PRODUCT     0x0101
 #define EP_MAX_PACKET_CONTROL   64
-#define USB_SPEED_HIGH  2
+// Vitesse demandée au contrôleur : valeurs de enum usb_device_speed (ch9.h)
+#define USB_DEVICE_SPEED USB_SPEED_HIGH
 
 // Identifiants de chaîne USB
 #define STRING_ID_LANG           0
@@ -34,16 +35,58 @@ extern "C" {
 #define STRING_ID_PRODUCT        2
 #define STRING_ID_SERIAL         5
 #define STRING_ID_CONFIG         4
-#define STRING_ID_INTERFACE0     5
-#define STRING_ID_INTERFACE1     6
+#define STRING_ID_INTERFACE_BASE 6   // Interface du joystick j : STRING_ID_INTERFACE_BASE + j
 
-// Numérotation des endpoints pour les rapports HID
+// Numérotation des endpoints pour les rapports HID : EP_NUM_INT_IN0 + j
 #define EP_NUM_INT_IN0   1
-#define EP_NUM_INT_IN1   2
 
-// Nombre maximum de boutons
+// Nombre maximum de boutons par joystick virtuel
 #define MAX_BUTTONS 128
 
+// Joysticks virtuels : leur nombre et le nombre d'axes et de boutons de chacun
+// viennent du mapping ("virtual_joysticks"). Chacun a son interface, son
+// endpoint et son rapport : Report ID, axes (8 à 16 bits), boutons (1 bit
+// chacun), bourrage jusqu'à l'octet.
+#define MAX_VIRTUAL_JOYSTICKS 8
+#define HID_MAX_AXES 16
+#define HID_MAX_REPORT_SIZE (1 + HID_MAX_AXES * 2 + MAX_BUTTONS / 8)
+// Disposition par défaut (mapping sans "virtual_joysticks")
+#define DEFAULT_VIRTUAL_JOYSTICKS 2
+#define DEFAULT_JOYSTICK_AXES 8
+#define DEFAULT_JOYSTICK_BUTTONS MAX_BUTTONS
+
+typedef struct VirtualJoystickLayout {
+    int nb_axes;                       // 0 à HID_MAX_AXES
+    int nb_buttons;                    // 0 à MAX_BUTTONS
+    int compact;                       // Rapport réduit aux contrôles mappés au démarrage
+    int axis_bits;                     // 8, 10, 12 ou 16 ; 0 : 16, ou selon les axes sources si compact
+} VirtualJoystickLayout;
+
+// Format compilé du rapport d'un joystick (report_layout.c) : axes et boutons
+// présents, largeur des axes et routine d'assemblage spécialisée
+typedef struct ReportLayout ReportLayout;
+typedef void (*ReportPackFn)(const ReportLayout *rl, uint8_t *report, const int16_t *axes, const uint8_t *buttons);
+struct ReportLayout {
+    uint8_t report_id;
+    int axis_bits;
+    int nb_axes;                         // Axes présents dans le rapport
+    uint8_t axis_slots[HID_MAX_AXES];    // Axe virtuel de chaque axe du rapport
+    int nb_buttons;                      // Boutons présents dans le rapport
+    uint8_t button_slots[MAX_BUTTONS];   // Bouton virtuel de chaque bit du rapport
+    int8_t axis_index[HID_MAX_AXES];     // Position de l'axe virtuel dans le rapport, -1 si absent
+    int16_t button_index[MAX_BUTTONS];   // Idem pour les boutons
+    int size;                            // Octets, Report ID compris
+    ReportPackFn pack;
+};
+
+// Fréquence d'interrogation des endpoints interrupt, en Hz : puissance de 2
+// fois 125 entre 125 Hz et 8 kHz. En high speed, bInterval est l'exposant
+// 2^(bInterval-1) de microtrames de 125 us ; en full speed, un nombre de
+// trames de 1 ms (1 kHz au plus).
+#define USB_POLL_RATE_MIN     125
+#define USB_POLL_RATE_MAX     8000
+#define USB_POLL_RATE_DEFAULT 1000
+
 // Structures HID (pour le descripteur HID)
 struct hid_class_descriptor {
     uint8_t  bDescriptorType;
@@ -59,26 +102,45 @@ struct hid_descriptor {
     struct hid_class_descriptor desc[1];
 } __attribute__ ((packed));
 
-// Déclarations des rapports HID et de leurs tailles
-extern const unsigned char usb_hid_report0[];
-extern const unsigned int usb_hid_report0_size;
-extern const unsigned char usb_hid_report1[];
-extern const unsigned int usb_hid_report1_size;
+// Taille maximale d'un descripteur de rapport généré (boutons épars : une
+// plage d'usages par suite de boutons consécutifs)
+#define HID_MAX_REPORT_DESC_SIZE 640
+
+// Disposition et descripteurs générés par usb_configure_joysticks (par
+// défaut : DEFAULT_VIRTUAL_JOYSTICKS joysticks de 8 axes et 128 boutons)
+extern int usb_nb_joysticks;
+extern VirtualJoystickLayout usb_joysticks[MAX_VIRTUAL_JOYSTICKS];
+extern ReportLayout usb_reports[MAX_VIRTUAL_JOYSTICKS];
+extern unsigned char usb_hid_reports[MAX_VIRTUAL_JOYSTICKS][HID_MAX_REPORT_DESC_SIZE];
+extern unsigned int usb_hid_report_sizes[MAX_VIRTUAL_JOYSTICKS];
+extern struct hid_descriptor usb_hids[MAX_VIRTUAL_JOYSTICKS];
+extern struct usb_interface_descriptor usb_interfaces[MAX_VIRTUAL_JOYSTICKS];
+extern struct usb_endpoint_descriptor usb_endpoints[MAX_VIRTUAL_JOYSTICKS];
 
 // Déclarations externes des descripteurs USB
-extern struct hid_descriptor usb_hid0;
-extern struct hid_descriptor usb_hid1;
 extern struct usb_device_descriptor usb_device;
 extern struct usb_config_descriptor usb_config;
 extern struct usb_qualifier_descriptor usb_qualifier;
-extern struct usb_interface_descriptor usb_interface0;
-extern struct usb_interface_descriptor usb_interface1;
-extern struct usb_endpoint_descriptor usb_endpoint0;
-extern struct usb_endpoint_descriptor usb_endpoint1;
 
-// Prototype de la fonction de construction dynamique de la configuration USB
+// Génère interfaces, descripteurs HID et de rapport et endpoints pour count
+// joysticks, à partir de leur format compilé (report_layout_full ou
+// report_layout_compile). Retourne -1 si la disposition n'est pas valide.
+int usb_configure_joysticks(const VirtualJoystickLayout *layouts, const ReportLayout *reports, int count);
+// Vérifie une disposition (bornes de MAX_VIRTUAL_JOYSTICKS, HID_MAX_AXES, MAX_BUTTONS, axis_bits)
+int usb_joystick_layout_valid(const VirtualJoystickLayout *layouts, int count);
+
+// Prototype de la fonction de construction dynamique de la configuration USB.
+// La configuration décrit la vitesse de fonctionnement, other_speed l'autre
+// vitesse (USB_DT_OTHER_SPEED_CONFIG), chacune avec ses propres bInterval.
 int build_config(char *data, int length, int other_speed);
 
+// Choisit la vitesse de fonctionnement et la fréquence d'interrogation, et met
+// à jour usb_endpoints en conséquence. Retourne -1 si hz n'est pas valide.
+int usb_configure_polling(int speed, int hz);
+// Fréquence effective à la vitesse de fonctionnement, et période correspondante
+int usb_poll_rate(void);
+uint64_t usb_poll_period_ns(void);
+
 #ifdef __cplusplus
 }
 #endif
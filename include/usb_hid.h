@@ -3,17 +3,130 @@
 
 #include "usb_raw.h"
 #include "usb_descriptors.h"
+#include "runtime_mapping.h"
+#include "output_sink.h"
+#include "input_trace.h"
 #include <pthread.h>
+#include <time.h>
 
 // Structure d'arguments pour le thread HID
 typedef struct {
-    int fd;                   // Descripteur du gadget USB
-    void *devices;            // Tableau des périphériques d'entrée (voir input_mapping.h)
-    int nb_joysticks;         // Nombre de périphériques
+    OutputSink *sink;         // Destination des rapports (gadget, uinput, capture)
+    RuntimeMapping *rt;       // Mapping publié au démarrage (NULL : mapping courant)
+    int stop_fd;              // eventfd signalant l'arrêt du thread
+    int wake_fd;              // eventfd signalant un nouveau mapping à enregistrer
+    int reader;               // Index du lecteur, -1 pour le thread HID unique
+    int nb_readers;           // Nombre de lecteurs (répartition des périphériques par uid)
 } HidReportArgs;
 
-// Prototype de la fonction de traitement des rapports HID
+// Prototype de la fonction de traitement des rapports HID (thread unique ou lecteur)
 void *process_and_send_hid_reports(void *arg);
 
+// Démarrage / arrêt du thread HID (un seul thread actif à la fois), avec un
+// thread d'écriture par endpoint qui envoie au puits le dernier rapport publié.
+// rt non NULL est publié comme mapping courant avant le démarrage.
+int hid_thread_start(OutputSink *sink, RuntimeMapping *rt);
+void hid_thread_stop(void);
+// Horloge CPU du thread HID, ou du thread d'agrégation avec des lecteurs
+// (mesures) ; -1 si aucun thread actif
+int hid_thread_cpu_clock(clockid_t *clock);
+
+// Budget d'événements lus par périphérique à chaque passe de la boucle de
+// lecture : les périphériques en attente sont servis à tour de rôle et un
+// périphérique bavard ne retarde les autres que d'un budget par passe (le
+// reste est repris à la passe suivante). 0 : lecture jusqu'à EAGAIN. Pris en
+// compte au prochain hid_thread_start.
+#define HID_DEVICE_BUDGET_DEFAULT 128
+void hid_configure_device_budget(unsigned events);
+
+// Compteurs par périphérique depuis hid_thread_start
+#define HID_MAX_DEVICE_STATS 64
+typedef struct {
+    unsigned uid;
+    char name[48];
+    uint64_t events;                // Evénements lus
+    uint64_t reads;                 // Lots lus (read())
+    uint64_t budget_hits;           // Passes terminées avec des événements encore en attente
+    uint64_t max_backlog_passes;    // Plus longue suite de passes en retard
+    uint64_t read_age_ns;           // Somme des âges du plus ancien événement de chaque lot
+    uint64_t max_read_age_ns;       // Plus grand âge à la lecture (retard du tampon evdev)
+    uint64_t hysteresis_events;     // Valeurs d'axe écartées par l'hystérésis
+    uint64_t absorbed_events;       // Valeurs d'axe changées sans changer la sortie (quantification, zone morte)
+    uint64_t suppressed_frames;     // Trames dont tous les changements ont été écartés : rapports évités
+} HidDeviceStats;
+// Copie les compteurs des périphériques enregistrés ; retourne leur nombre
+int hid_device_stats(HidDeviceStats *out, int max);
+
+// Lecteurs de périphériques (multi-coeurs) : 0 (défaut), un seul thread HID
+// lit, traduit et assemble les rapports ; N > 0, N lecteurs se répartissent
+// les périphériques (par uid), traduisent leurs trames en deltas (valeur
+// finale d'un axe, état d'un bouton) et les poussent dans une file sans verrou
+// multi-producteurs vers un thread d'agrégation, seul à tenir l'état des
+// rapports et à publier dans les boîtes aux lettres. -1 au-delà de
+// HID_MAX_READERS. Pris en compte au prochain hid_thread_start ; incompatible
+// avec l'enregistrement d'une trace (input_trace.h, producteur unique).
+#define HID_MAX_READERS 8
+int hid_configure_readers(int nb_readers);
+
+// Compteurs de la file des lecteurs (remis à zéro par hid_thread_start)
+typedef struct {
+    int nb_readers;
+    uint64_t deltas;                // Deltas transmis à l'agrégateur
+    uint64_t ops;                   // Modifications d'axe ou de bouton transmises
+    uint64_t queue_full;            // Attentes d'un lecteur sur la file pleine
+    uint64_t max_backlog;           // Deltas en attente au plus fort, vus par l'agrégateur
+} HidReaderStats;
+void hid_reader_stats(HidReaderStats *out);
+// Horloges CPU des lecteurs actifs ; retourne leur nombre (0 en thread unique)
+int hid_reader_cpu_clocks(clockid_t *clocks, int max);
+
+// Attente active (busy-poll) du thread HID : pendant window_us microsecondes
+// après une trame, les périphériques sont relus sans bloquer au lieu
+// d'attendre le réveil par epoll, au prix d'un coeur occupé pendant la
+// fenêtre. 0 désactive (défaut) ; -1 au-delà de 100 ms. Pris en compte au
+// prochain hid_thread_start.
+int hid_configure_busy_poll(unsigned window_us);
+
+// Compteurs du thread HID courant (remis à zéro par hid_thread_start)
+typedef struct {
+    uint64_t window_ns;             // Fenêtre configurée
+    uint64_t blocking_waits;        // Attentes epoll bloquantes
+    uint64_t spin_polls;            // Tours d'attente active
+    uint64_t spin_ns;               // Temps passé en attente active (coût CPU)
+    uint64_t spin_frames;           // Trames lues en attente active
+    uint64_t spin_latency_ns;       // Somme des latences evdev -> trame appliquée
+    uint64_t blocking_frames;       // Trames lues après un réveil epoll
+    uint64_t blocking_latency_ns;
+} HidBusyPollStats;
+void hid_busy_poll_stats(HidBusyPollStats *out);
+
+// Moteur de traduction sans thread ni epoll, pour le rejeu déterministe d'une
+// trace (input_trace.h) : mêmes trames, recalages et formats de rapport que le
+// thread HID, un rapport par joystick modifié après chaque lot.
+typedef struct HidEngine HidEngine;
+HidEngine *hid_engine_create(void);
+void hid_engine_free(HidEngine *e);
+// Mapping utilisé par les lots suivants (les trames en cours sont conservées par uid)
+void hid_engine_set_mapping(HidEngine *e, const RuntimeMapping *rt);
+// Etat initial d'un périphérique (INPUT_TRACE_SEED)
+void hid_engine_seed(HidEngine *e, unsigned uid, const InputTraceState *state);
+// Lot d'événements d'un périphérique ; resync : état INPUT_TRACE_RESYNC qui
+// suit le lot dans la trace, ou NULL
+void hid_engine_feed(HidEngine *e, unsigned uid, const struct input_event *events, int count,
+                     const InputTraceState *resync);
+// Rapport du joystick joy s'il a changé depuis le dernier appel ; retourne sa
+// taille, 0 sinon
+int hid_engine_take_report(HidEngine *e, int joy, uint8_t *report);
+
+// Mapping courant du thread HID
+RuntimeMapping *hid_mapping_current(void);
+// Publie un nouveau mapping et retourne l'ancien une fois que le thread HID ne
+// peut plus l'utiliser : l'appelant peut alors le libérer. Le remplacement a
+// lieu entre deux réveils, sans perdre de trame ni de rapport ; les
+// périphériques ajoutés ou retirés (suivis par uid) sont enregistrés dans
+// l'epoll du thread au réveil suivant. Le fd d'un périphérique retiré ne doit
+// être fermé qu'après le retour de cette fonction.
+RuntimeMapping *hid_mapping_swap(RuntimeMapping *next);
+
 
 #endif // USB_HID_H
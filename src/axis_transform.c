@@ -0,0 +1,255 @@
+#include "axis_transform.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Paramètres qui déterminent le contenu d'une table (clé de partage)
+typedef struct {
+    int32_t minimum;
+    int32_t maximum;
+    int32_t dead_zone;
+    int32_t quantum;
+    int32_t invert;
+    AxisCurve curve;
+} AxisTableKey;
+
+// Table d'axe partagée, comptée par référence. Les tables ne sont créées et
+// libérées que hors du thread HID (chargement et remplacement du mapping), qui
+// ne lit que AxisTransform.lut.
+typedef struct AxisTable {
+    struct AxisTable *next;
+    unsigned refs;
+    AxisTableKey key;
+    int16_t *lut;
+} AxisTable;
+
+static pthread_mutex_t axis_tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static AxisTable *axis_tables = NULL;
+static uint64_t axis_tables_built = 0;
+static uint64_t axis_tables_reused = 0;
+
+// Nombre de bits significatifs de x (0 pour x == 0)
+static int bit_length(uint64_t x) {
+    int n = 0;
+    while (x) {
+        n++;
+        x >>= 1;
+    }
+    return n;
+}
+
+bool axis_curve_valid(const AxisCurve *curve) {
+    if (curve->nb_points > AXIS_CURVE_MAX_POINTS)
+        return false;
+    for (int i = 1; i < curve->nb_points; i++)
+        if (curve->x[i] <= curve->x[i - 1])
+            return false;
+    return true;
+}
+
+// Courbe complétée par ses extrémités implicites, avec la pente en chaque point
+typedef struct {
+    int n;
+    double x[AXIS_CURVE_MAX_POINTS + 2];
+    double y[AXIS_CURVE_MAX_POINTS + 2];
+    double m[AXIS_CURVE_MAX_POINTS + 2];
+} CurveSpline;
+
+static void curve_prepare(const AxisCurve *c, CurveSpline *s) {
+    int n = 0;
+    if (c->nb_points == 0 || c->x[0] > -32768) {
+        s->x[n] = -32768;
+        s->y[n++] = -32768;
+    }
+    for (int i = 0; i < c->nb_points; i++) {
+        s->x[n] = c->x[i];
+        s->y[n++] = c->y[i];
+    }
+    if (s->x[n - 1] < 32767) {
+        s->x[n] = 32767;
+        s->y[n++] = 32767;
+    }
+    s->n = n;
+    // Pentes des segments, puis pentes aux points : nulle à un extremum local,
+    // moyenne harmonique pondérée des segments voisins sinon (monotone)
+    double d[AXIS_CURVE_MAX_POINTS + 1] = {0};
+    double h[AXIS_CURVE_MAX_POINTS + 1] = {0};
+    for (int k = 0; k < n - 1; k++) {
+        h[k] = s->x[k + 1] - s->x[k];
+        d[k] = (s->y[k + 1] - s->y[k]) / h[k];
+    }
+    s->m[0] = d[0];
+    s->m[n - 1] = d[n - 2];
+    for (int k = 1; k < n - 1; k++) {
+        if (d[k - 1] * d[k] <= 0) {
+            s->m[k] = 0;
+        } else {
+            double w1 = 2 * h[k] + h[k - 1];
+            double w2 = h[k] + 2 * h[k - 1];
+            s->m[k] = (w1 + w2) / (w1 / d[k - 1] + w2 / d[k]);
+        }
+    }
+}
+
+static int32_t curve_eval(const CurveSpline *s, int32_t v) {
+    int lo = 0, hi = s->n - 1;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) >> 1;
+        if (v < s->x[mid])
+            hi = mid;
+        else
+            lo = mid;
+    }
+    double h = s->x[hi] - s->x[lo];
+    double t = (v - s->x[lo]) / h;
+    double t2 = t * t, t3 = t2 * t;
+    double y = (2 * t3 - 3 * t2 + 1) * s->y[lo] + (t3 - 2 * t2 + t) * h * s->m[lo] +
+               (-2 * t3 + 3 * t2) * s->y[hi] + (t3 - t2) * h * s->m[hi];
+    int32_t out = (int32_t)(y >= 0 ? y + 0.5 : y - 0.5);
+    if (out > 32767) out = 32767;
+    if (out < -32768) out = -32768;
+    return out;
+}
+
+// Calcule une table : entrée i pour la valeur minimum + (i << lut_shift), la
+// dernière pour maximum
+static int16_t *table_build(const AxisTransform *t, const AxisCurve *curve) {
+    uint32_t last = ((uint32_t)t->maximum - (uint32_t)t->minimum) >> t->lut_shift;
+    int16_t *lut = malloc(((size_t)last + 1) * sizeof(int16_t));
+    if (!lut)
+        return NULL;
+    CurveSpline spline = {0};
+    if (curve)
+        curve_prepare(curve, &spline);
+    for (uint32_t i = 0; i <= last; i++) {
+        int32_t val = i == last ? t->maximum : (int32_t)((uint32_t)t->minimum + (i << t->lut_shift));
+        int32_t out = axis_transform_linear(t, val);
+        if (curve)
+            out = curve_eval(&spline, out);
+        lut[i] = axis_transform_quantize(t, out);
+    }
+    return lut;
+}
+
+// Référence à la table de t, calculée si aucun axe ne la partage encore
+static bool table_acquire(AxisTransform *t, const AxisCurve *curve) {
+    AxisTableKey key;
+    memset(&key, 0, sizeof(key));
+    key.minimum = t->minimum;
+    key.maximum = t->maximum;
+    key.dead_zone = t->dead_zone;
+    key.quantum = t->quantum;
+    key.invert = t->invert;
+    if (curve) {
+        // Champ par champ : la clé est comparée octet par octet
+        key.curve.nb_points = curve->nb_points;
+        for (int i = 0; i < curve->nb_points; i++) {
+            key.curve.x[i] = curve->x[i];
+            key.curve.y[i] = curve->y[i];
+        }
+    }
+    pthread_mutex_lock(&axis_tables_lock);
+    for (AxisTable *tab = axis_tables; tab; tab = tab->next) {
+        if (memcmp(&tab->key, &key, sizeof(key)) == 0) {
+            tab->refs++;
+            axis_tables_reused++;
+            t->table = tab;
+            t->lut = tab->lut;
+            pthread_mutex_unlock(&axis_tables_lock);
+            return true;
+        }
+    }
+    pthread_mutex_unlock(&axis_tables_lock);
+    // Calcul hors verrou : deux compilations concurrentes d'une même table en
+    // produisent au pire deux exemplaires
+    AxisTable *tab = calloc(1, sizeof(AxisTable));
+    int16_t *lut = tab ? table_build(t, curve) : NULL;
+    if (!lut) {
+        free(tab);
+        return false;
+    }
+    tab->refs = 1;
+    tab->key = key;
+    tab->lut = lut;
+    pthread_mutex_lock(&axis_tables_lock);
+    tab->next = axis_tables;
+    axis_tables = tab;
+    axis_tables_built++;
+    pthread_mutex_unlock(&axis_tables_lock);
+    t->table = tab;
+    t->lut = lut;
+    return true;
+}
+
+bool axis_transform_compile(AxisTransform *t, const struct input_absinfo *info, int invert, int dead_zone,
+                            int quantum, const AxisCurve *curve) {
+    memset(t, 0, sizeof(*t));
+    t->minimum = info->minimum;
+    t->maximum = info->maximum;
+    t->invert = invert ? 1 : 0;
+    t->dead_zone = dead_zone > 0 ? dead_zone : 0;
+    t->quantum = quantum > 1 ? quantum : 0;
+    if (curve && curve->nb_points == 0)
+        curve = NULL;
+    int64_t range = (int64_t)info->maximum - info->minimum;
+    if (range <= 0) {
+        // Plage nulle ou incohérente : l'ancien code renvoyait 0
+        t->degenerate = 1;
+        if (t->maximum < t->minimum)
+            t->maximum = t->minimum;
+        return true;
+    }
+    // On limite la plage à 23 bits pour que v * mul tienne sur 64 bits.
+    // Au-delà la précision de l'axe dépasse de loin celle du rapport HID.
+    int bits = bit_length((uint64_t)range);
+    if (bits > 23) {
+        t->pre_shift = bits - 23;
+        range >>= t->pre_shift;
+        bits = 23;
+    }
+    // floor(v * 65535 / range) == (v * mul) >> shift pour tout v dans [0, range]
+    // dès que 2^shift > range^2 et mul = ceil(65535 * 2^shift / range).
+    t->shift = 2 * bits + 1;
+    t->mul = (((uint64_t)65535 << t->shift) + (uint64_t)range - 1) / (uint64_t)range;
+    if (curve) {
+        // Courbe : une lecture de table quelle que soit la plage
+        uint64_t span = (uint64_t)((int64_t)info->maximum - info->minimum);
+        while ((span >> t->lut_shift) + 1 > AXIS_CURVE_LUT_MAX_ENTRIES)
+            t->lut_shift++;
+        return table_acquire(t, curve);
+    }
+    if (info->maximum - (int64_t)info->minimum <= AXIS_LUT_MAX_RANGE)
+        return table_acquire(t, NULL);
+    return true;
+}
+
+void axis_transform_release(AxisTransform *t) {
+    AxisTable *tab = t->table;
+    t->table = NULL;
+    t->lut = NULL;
+    if (!tab)
+        return;
+    pthread_mutex_lock(&axis_tables_lock);
+    if (--tab->refs == 0) {
+        for (AxisTable **p = &axis_tables; *p; p = &(*p)->next) {
+            if (*p == tab) {
+                *p = tab->next;
+                break;
+            }
+        }
+    } else {
+        tab = NULL;
+    }
+    pthread_mutex_unlock(&axis_tables_lock);
+    if (tab) {
+        free(tab->lut);
+        free(tab);
+    }
+}
+
+void axis_transform_table_counts(uint64_t *built, uint64_t *reused) {
+    pthread_mutex_lock(&axis_tables_lock);
+    *built = axis_tables_built;
+    *reused = axis_tables_reused;
+    pthread_mutex_unlock(&axis_tables_lock);
+}
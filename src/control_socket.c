@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+#include "control_socket.h"
+#include "input_mapping.h"
+#include "device_table.h"
+#include "log_ring.h"
+#include "latency_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+
+// Thread d'écoute et ses descripteurs (-1 si inactif)
+static pthread_t control_thread;
+static bool control_active = false;
+static int control_listen_fd = -1;
+static int control_stop_fd = -1;
+static char control_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+int control_reload_mapping(const char *filename, char *err, size_t err_len) {
+    device_table_lock();
+    int nb = g_nb_joysticks;
+    InputDevice *devices = device_table_copy(0);
+    if (!devices) {
+        snprintf(err, err_len, "mémoire insuffisante");
+        device_table_unlock();
+        return -1;
+    }
+    if (apply_mapping_file(filename, devices, nb) < 0) {
+        snprintf(err, err_len, "lecture de %s impossible", filename);
+        free(devices);
+        device_table_unlock();
+        return -1;
+    }
+    uint64_t start = latency_now_ns();
+    if (device_table_publish(devices, nb) < 0) {
+        snprintf(err, err_len, "compilation du mapping impossible");
+        free(devices);
+        device_table_unlock();
+        return -1;
+    }
+    log_msg(LOG_CAT_GENERAL, LOG_LEVEL_INFO,
+            "Mapping rechargé depuis %s : %d périphériques, compilation et échange %.1f us\n",
+            filename, nb, (latency_now_ns() - start) / 1000.0);
+    device_table_unlock();
+    return 0;
+}
+
+// Lit une ligne de commande (délai d'une seconde) ; retourne sa longueur ou -1
+static int read_command(int fd, char *line, size_t len) {
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    size_t used = 0;
+    while (used < len - 1) {
+        ssize_t n = read(fd, line + used, len - 1 - used);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            break;
+        used += n;
+        if (memchr(line, '\n', used))
+            break;
+    }
+    line[used] = '\0';
+    char *end = strpbrk(line, "\r\n");
+    if (end)
+        *end = '\0';
+    return (int)strlen(line);
+}
+
+static void handle_client(int fd) {
+    char line[CONTROL_SOCKET_MAX_LINE];
+    char reply[CONTROL_SOCKET_MAX_LINE + 64];
+    if (read_command(fd, line, sizeof(line)) < 0)
+        return;
+    if (strcmp(line, "ping") == 0) {
+        snprintf(reply, sizeof(reply), "ok\n");
+    } else if (strcmp(line, "reload") == 0 || strncmp(line, "reload ", 7) == 0) {
+        const char *path = line[6] == ' ' && line[7] != '\0' ? line + 7 : g_mapping_file;
+        char err[CONTROL_SOCKET_MAX_LINE + 32];
+        if (control_reload_mapping(path, err, sizeof(err)) == 0)
+            snprintf(reply, sizeof(reply), "ok\n");
+        else
+            snprintf(reply, sizeof(reply), "error %s\n", err);
+    } else {
+        snprintf(reply, sizeof(reply), "error commande inconnue\n");
+    }
+    if (write(fd, reply, strlen(reply)) < 0)
+        perror("write control reply");
+}
+
+static void *control_loop(void *arg) {
+    (void)arg;
+    log_ring_register_thread("control");
+    struct pollfd fds[2];
+    fds[0].fd = control_listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = control_stop_fd;
+    fds[1].events = POLLIN;
+    for (;;) {
+        int n = poll(fds, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll control socket");
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (!(fds[0].revents & POLLIN))
+            continue;
+        int client = accept4(control_listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno != EINTR && errno != EAGAIN)
+                perror("accept control socket");
+            continue;
+        }
+        handle_client(client);
+        close(client);
+    }
+    log_ring_release_thread();
+    return NULL;
+}
+
+int control_socket_start(const char *path) {
+    if (control_active)
+        return 0;
+    if (!path)
+        path = getenv("RAW_JOYSTICK_CONTROL_SOCKET");
+    if (!path || !*path)
+        path = CONTROL_SOCKET_DEFAULT_PATH;
+    if (strlen(path) >= sizeof(control_path)) {
+        fprintf(stderr, "Chemin de socket de contrôle trop long: %s\n", path);
+        return -1;
+    }
+    strcpy(control_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket control");
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, control_path);
+    // Une socket laissée par une instance précédente empêcherait le bind
+    unlink(control_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind control socket");
+        close(fd);
+        return -1;
+    }
+    chmod(control_path, 0660);
+    if (listen(fd, 4) < 0) {
+        perror("listen control socket");
+        close(fd);
+        unlink(control_path);
+        return -1;
+    }
+    int stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stop_fd < 0) {
+        perror("eventfd control");
+        close(fd);
+        unlink(control_path);
+        return -1;
+    }
+    control_listen_fd = fd;
+    control_stop_fd = stop_fd;
+    int rv = pthread_create(&control_thread, NULL, control_loop, NULL);
+    if (rv != 0) {
+        errno = rv;
+        perror("pthread_create control");
+        close(fd);
+        close(stop_fd);
+        unlink(control_path);
+        control_listen_fd = -1;
+        control_stop_fd = -1;
+        return -1;
+    }
+    control_active = true;
+    printf("Socket de contrôle: %s\n", control_path);
+    return 0;
+}
+
+void control_socket_stop(void) {
+    if (!control_active)
+        return;
+    uint64_t one = 1;
+    if (write(control_stop_fd, &one, sizeof(one)) < 0)
+        perror("write(control_stop_fd)");
+    pthread_join(control_thread, NULL);
+    close(control_listen_fd);
+    close(control_stop_fd);
+    unlink(control_path);
+    control_listen_fd = -1;
+    control_stop_fd = -1;
+    control_active = false;
+}
@@ -0,0 +1,52 @@
+#include "device_table.h"
+#include "runtime_mapping.h"
+#include "usb_hid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void device_table_lock(void) {
+    pthread_mutex_lock(&table_lock);
+}
+
+void device_table_unlock(void) {
+    pthread_mutex_unlock(&table_lock);
+}
+
+InputDevice *device_table_copy(int extra) {
+    int nb = g_nb_joysticks + extra;
+    InputDevice *devices = malloc((nb > 0 ? nb : 1) * sizeof(InputDevice));
+    if (!devices) {
+        perror("malloc device table");
+        return NULL;
+    }
+    if (g_nb_joysticks > 0)
+        memcpy(devices, g_devices, g_nb_joysticks * sizeof(InputDevice));
+    return devices;
+}
+
+int device_table_publish(InputDevice *devices, int nb) {
+    RuntimeMapping *rt = runtime_mapping_build(devices, nb);
+    if (!rt)
+        return -1;
+    // L'ancienne table reste référencée par l'ancien mapping jusqu'au retour
+    // de hid_mapping_swap (période de grâce)
+    RuntimeMapping *old = hid_mapping_swap(rt);
+    InputDevice *old_devices = g_devices;
+    g_devices = devices;
+    g_nb_joysticks = nb;
+    runtime_mapping_free(old);
+    free(old_devices);
+    return 0;
+}
+
+int device_table_find_path(const char *path) {
+    for (int i = 0; i < g_nb_joysticks; i++) {
+        if (strcmp(g_devices[i].path, path) == 0)
+            return i;
+    }
+    return -1;
+}
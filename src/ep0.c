@@ -4,6 +4,7 @@
 #include "usb_hid.h"
 #include "input_mapping.h"
 #include "usb_raw.h"
+#include "log_ring.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,13 +20,14 @@ struct usb_raw_control_event {
 
 struct usb_raw_control_io {
     struct usb_raw_ep_io inner;
-    char data[256]; // Taille maximale pour EP0
+    char data[HID_MAX_REPORT_DESC_SIZE]; // Taille maximale pour EP0 (descripteur de rapport le plus long)
 };
 
 volatile bool keep_running = true; // Variable de contrôle globale
 
 void stop_ep0_loop(void) {
     keep_running = false;
+    hid_thread_stop();
 }
 
 void start_ep0_loop(void) {
@@ -33,7 +35,7 @@ void start_ep0_loop(void) {
 }
 
 // Fonction interne de traitement d'une requête sur EP0
-static int ep0_request(int fd, struct usb_raw_control_event *event, struct usb_raw_control_io *io) {
+static int ep0_request(int fd, OutputSink *sink, struct usb_raw_control_event *event, struct usb_raw_control_io *io) {
     switch (event->ctrl.bRequestType & USB_TYPE_MASK) {
         case USB_TYPE_STANDARD:
             switch (event->ctrl.bRequest) {
@@ -100,29 +102,18 @@ static int ep0_request(int fd, struct usb_raw_control_event *event, struct usb_r
                                      io->data[2 + i*2+1] = 0;
                                  }
                                  io->inner.length = desc_len;
-                             } else if (index == STRING_ID_INTERFACE0) {
-                                 const char *iface0 = "Composite Joystick 0";
-                                 int len = strlen(iface0);
+                             } else if (index >= STRING_ID_INTERFACE_BASE &&
+                                        index < STRING_ID_INTERFACE_BASE + usb_nb_joysticks) {
+                                 char iface[32];
+                                 snprintf(iface, sizeof(iface), "Composite Joystick %d", index - STRING_ID_INTERFACE_BASE);
+                                 int len = strlen(iface);
                                  int desc_len = 2 + len * 2;
                                  if (desc_len > (int)sizeof(io->data))
                                      desc_len = sizeof(io->data);
                                  io->data[0] = desc_len;
                                  io->data[1] = USB_DT_STRING;
                                  for (int i = 0; i < len; i++) {
-                                     io->data[2 + i*2] = iface0[i];
-                                     io->data[2 + i*2+1] = 0;
-                                 }
-                                 io->inner.length = desc_len;
-                             } else if (index == STRING_ID_INTERFACE1) {
-                                 const char *iface1 = "Composite Joystick 1";
-                                 int len = strlen(iface1);
-                                 int desc_len = 2 + len * 2;
-                                 if (desc_len > (int)sizeof(io->data))
-                                     desc_len = sizeof(io->data);
-                                 io->data[0] = desc_len;
-                                 io->data[1] = USB_DT_STRING;
-                                 for (int i = 0; i < len; i++) {
-                                     io->data[2 + i*2] = iface1[i];
+                                     io->data[2 + i*2] = iface[i];
                                      io->data[2 + i*2+1] = 0;
                                  }
                                  io->inner.length = desc_len;
@@ -134,47 +125,37 @@ static int ep0_request(int fd, struct usb_raw_control_event *event, struct usb_r
                              return 1;
                         }
                         case HID_DT_REPORT: {
-                            if (event->ctrl.wIndex == 0) {
-                                memcpy(io->data, usb_hid_report0, usb_hid_report0_size);
-                                io->inner.length = usb_hid_report0_size;
-                            } else {
-                                memcpy(io->data, usb_hid_report1, usb_hid_report1_size);
-                                io->inner.length = usb_hid_report1_size;
+                            // wIndex : numéro d'interface, donc du joystick
+                            int joy = event->ctrl.wIndex;
+                            if (joy >= usb_nb_joysticks) {
+                                log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0_request: no report for interface %d\n", joy);
+                                return 0;
                             }
+                            memcpy(io->data, usb_hid_reports[joy], usb_hid_report_sizes[joy]);
+                            io->inner.length = usb_hid_report_sizes[joy];
                             return 1;
                         }
                         default:
-                            printf("ep0_request: unknown descriptor type: 0x%x\n", event->ctrl.wValue >> 8);
+                            log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0_request: unknown descriptor type: 0x%x\n", event->ctrl.wValue >> 8);
                             return 0;
                     }
                     break;
                 case USB_REQ_SET_CONFIGURATION: {
-                    extern int ep_int_in0, ep_int_in1;
-                    ep_int_in0 = usb_raw_ep_enable(fd, &usb_endpoint0);
-                    ep_int_in1 = usb_raw_ep_enable(fd, &usb_endpoint1);
-                    printf("ep0_request: endpoints enabled: ep_int_in0 = %d, ep_int_in1 = %d\n", ep_int_in0, ep_int_in1);
-                    
-                    // Démarrage du thread HID
-                    HidReportArgs *args = malloc(sizeof(HidReportArgs));
-                    if (!args) {
-                        perror("malloc");
-                        exit(EXIT_FAILURE);
+                    for (int j = 0; j < usb_nb_joysticks; j++) {
+                        if (output_sink_enable_endpoint(sink, j, &usb_endpoints[j]) < 0) {
+                            perror("enable_endpoint");
+                            exit(EXIT_FAILURE);
+                        }
                     }
-                    extern InputDevice *g_devices;
-                    extern int g_nb_joysticks;
-                    args->fd = fd;
-                    args->devices = g_devices;
-                    args->nb_joysticks = g_nb_joysticks;
-                    pthread_t hid_thread;
-                    int rv = pthread_create(&hid_thread, NULL, process_and_send_hid_reports, args);
-                    if (rv != 0) {
-                        perror("pthread_create");
+                    log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0_request: endpoints enabled (%s)\n", sink->ops->name);
+                    
+                    // Démarrage du thread HID (remplace un éventuel thread précédent)
+                    if (hid_thread_start(sink, NULL) != 0)
                         exit(EXIT_FAILURE);
-                    }
-                    pthread_detach(hid_thread);
                     
                     usb_raw_vbus_draw(fd, usb_config.bMaxPower);
                     usb_raw_configure(fd);
+                    output_sink_lifecycle(sink, SINK_EVENT_CONFIGURED);
                     io->inner.length = 0;
                     return 1;
                 }
@@ -183,7 +164,7 @@ static int ep0_request(int fd, struct usb_raw_control_event *event, struct usb_r
                     io->inner.length = 1;
                     return 1;
                 default:
-                    printf("ep0_request: unsupported standard request 0x%x\n", event->ctrl.bRequest);
+                    log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0_request: unsupported standard request 0x%x\n", event->ctrl.bRequest);
                     return 0;
             }
             break;
@@ -199,18 +180,19 @@ static int ep0_request(int fd, struct usb_raw_control_event *event, struct usb_r
                     io->inner.length = 0;
                     return 1;
                 default:
-                    printf("ep0_request: unsupported class request 0x%x\n", event->ctrl.bRequest);
+                    log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0_request: unsupported class request 0x%x\n", event->ctrl.bRequest);
                     return 0;
             }
             break;
         default:
-            printf("ep0_request: unknown request type\n");
+            log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0_request: unknown request type\n");
             return 0;
     }
     return 0;
 }
 
-void ep0_loop(int fd) {
+void ep0_loop(int fd, OutputSink *sink) {
+    log_ring_register_thread("ep0");
     while (keep_running) { // La boucle s'exécute tant que keep_running est true
         struct usb_raw_control_event event;
         event.inner.type = 0;
@@ -219,8 +201,14 @@ void ep0_loop(int fd) {
         log_event((struct usb_raw_event *)&event);
         if (event.inner.type == USB_RAW_EVENT_CONNECT)
             continue;
-        if (event.inner.type == USB_RAW_EVENT_RESET)
+        if (event.inner.type == USB_RAW_EVENT_RESET) {
+            output_sink_lifecycle(sink, SINK_EVENT_RESET);
+            continue;
+        }
+        if (event.inner.type == USB_RAW_EVENT_DISCONNECT) {
+            output_sink_lifecycle(sink, SINK_EVENT_DISCONNECT);
             continue;
+        }
         if (event.inner.type != USB_RAW_EVENT_CONTROL)
             continue;
         
@@ -229,9 +217,9 @@ void ep0_loop(int fd) {
         io.inner.ep = 0;
         io.inner.flags = 0;
         io.inner.length = 0;
-        int reply = ep0_request(fd, &event, &io);
+        int reply = ep0_request(fd, sink, &event, &io);
         if (!reply) {
-            printf("ep0: stalling\n");
+            log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0: stalling\n");
             usb_raw_ep0_stall(fd);
             continue;
         }
@@ -239,11 +227,12 @@ void ep0_loop(int fd) {
             io.inner.length = event.ctrl.wLength;
         if (event.ctrl.bRequestType & USB_DIR_IN) {
             int rv = usb_raw_ep0_write(fd, (struct usb_raw_ep_io *)&io);
-            printf("ep0: transferred %d bytes (in)\n", rv);
+            log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0: transferred %d bytes (in)\n", rv);
         } else {
             int rv = usb_raw_ep0_read(fd, (struct usb_raw_ep_io *)&io);
-            printf("ep0: transferred %d bytes (out)\n", rv);
+            log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "ep0: transferred %d bytes (out)\n", rv);
         }
     }
+    log_ring_release_thread();
     printf("ep0_loop stoppé.\n");
 }
@@ -0,0 +1,246 @@
+#include "hotplug.h"
+#include "device_table.h"
+#include "usb_descriptors.h"    // Pour USB_VENDOR / USB_PRODUCT
+#include "log_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <glob.h>
+#include <limits.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+
+// Thread de surveillance et ses descripteurs (-1 si inactif)
+static pthread_t hotplug_thread;
+static bool hotplug_active = false;
+static int hotplug_inotify_fd = -1;
+static int hotplug_stop_fd = -1;
+
+// Sauvegarde différée du mapping : une rafale de branchements (ou le
+// rattrapage initial) ne donne qu'une écriture, faite par ce thread
+#define HOTPLUG_SAVE_DELAY_MS 500
+static bool save_pending = false;
+static struct timespec save_deadline;
+
+static void schedule_save(void) {
+    clock_gettime(CLOCK_MONOTONIC, &save_deadline);
+    save_deadline.tv_nsec += HOTPLUG_SAVE_DELAY_MS * 1000000L;
+    save_deadline.tv_sec += save_deadline.tv_nsec / 1000000000L;
+    save_deadline.tv_nsec %= 1000000000L;
+    save_pending = true;
+}
+
+// Délai de poll jusqu'à la sauvegarde en attente, -1 s'il n'y en a pas
+static int save_timeout_ms(void) {
+    if (!save_pending)
+        return -1;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (save_deadline.tv_sec - now.tv_sec) * 1000L + (save_deadline.tv_nsec - now.tv_nsec) / 1000000L;
+    return ms > 0 ? (int)ms : 0;
+}
+
+static void flush_save(void) {
+    if (!save_pending)
+        return;
+    save_pending = false;
+    device_table_lock();
+    bool ok = save_mapping(g_mapping_file, g_devices, g_nb_joysticks, global_axis_index, global_button_index);
+    device_table_unlock();
+    if (!ok)
+        log_msg(LOG_CAT_DEVICE, LOG_LEVEL_ERROR, "Hotplug: sauvegarde du mapping impossible\n");
+}
+
+// Les joysticks créés par le puits uinput ne doivent pas être relus
+static bool is_own_output(const InputDevice *dev) {
+    return dev->id.bustype == BUS_VIRTUAL && dev->id.vendor == USB_VENDOR && dev->id.product == USB_PRODUCT;
+}
+
+static void hotplug_add(const char *path) {
+    device_table_lock();
+    bool known = device_table_find_path(path) >= 0;
+    device_table_unlock();
+    if (known)
+        return;
+    InputDevice dev;
+    if (probe_input_device(path, &dev) < 0)
+        return;
+    if (is_own_output(&dev)) {
+        close(dev.fd);
+        return;
+    }
+    int matched = apply_mapping_file(g_mapping_file, &dev, 1);
+    device_table_lock();
+    // Un second événement (IN_ATTRIB après IN_CREATE) a pu l'ajouter entre-temps
+    if (device_table_find_path(path) >= 0) {
+        device_table_unlock();
+        close(dev.fd);
+        return;
+    }
+    int nb = g_nb_joysticks;
+    InputDevice *devices = device_table_copy(1);
+    if (!devices) {
+        device_table_unlock();
+        close(dev.fd);
+        return;
+    }
+    // Périphérique inconnu (ou fichier de mapping absent, matched < 0) : axes
+    // numérotés à la suite, sous le verrou de la table
+    if (matched <= 0)
+        assign_default_axis_mapping(&dev);
+    devices[nb] = dev;
+    if (device_table_publish(devices, nb + 1) < 0) {
+        device_table_unlock();
+        free(devices);
+        close(dev.fd);
+        return;
+    }
+    log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO, "Hotplug: %s (%s) ajouté, %s\n", path, dev.name,
+            matched > 0 ? "mapping sauvegardé appliqué" : "nouveau périphérique");
+    device_table_unlock();
+    // Un périphérique inconnu est ajouté au fichier pour apparaître dans l'interface
+    if (matched <= 0)
+        schedule_save();
+}
+
+static void hotplug_remove(const char *path) {
+    device_table_lock();
+    int index = device_table_find_path(path);
+    if (index < 0) {
+        device_table_unlock();
+        return;
+    }
+    int nb = g_nb_joysticks;
+    InputDevice *devices = device_table_copy(0);
+    if (!devices) {
+        device_table_unlock();
+        return;
+    }
+    int fd = devices[index].fd;
+    char name[sizeof(devices[index].name)];
+    strcpy(name, devices[index].name);
+    memmove(&devices[index], &devices[index + 1], (nb - index - 1) * sizeof(InputDevice));
+    if (device_table_publish(devices, nb - 1) < 0) {
+        device_table_unlock();
+        free(devices);
+        return;
+    }
+    // Le thread HID ne peut plus utiliser ce descripteur
+    if (fd >= 0)
+        close(fd);
+    device_table_unlock();
+    log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO, "Hotplug: %s (%s) retiré\n", path, name);
+}
+
+// Rattrape les noeuds apparus entre le sondage initial et l'ajout de la surveillance
+static void hotplug_rescan(void) {
+    glob_t g;
+    if (glob(HOTPLUG_INPUT_DIR "/event*", 0, NULL, &g) != 0)
+        return;
+    for (size_t i = 0; i < g.gl_pathc; i++)
+        hotplug_add(g.gl_pathv[i]);
+    globfree(&g);
+}
+
+static void *hotplug_loop(void *arg) {
+    (void)arg;
+    log_ring_register_thread("hotplug");
+    hotplug_rescan();
+    struct pollfd fds[2];
+    fds[0].fd = hotplug_inotify_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = hotplug_stop_fd;
+    fds[1].events = POLLIN;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        int n = poll(fds, 2, save_timeout_ms());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll hotplug");
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (n == 0) {
+            flush_save();
+            continue;
+        }
+        if (!(fds[0].revents & POLLIN))
+            continue;
+        ssize_t len = read(hotplug_inotify_fd, buf, sizeof(buf));
+        if (len <= 0)
+            continue;
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->len == 0 || strncmp(ev->name, "event", 5) != 0)
+                continue;
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", HOTPLUG_INPUT_DIR, ev->name);
+            if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                hotplug_remove(path);
+            else
+                hotplug_add(path);
+        }
+    }
+    flush_save();
+    log_ring_release_thread();
+    return NULL;
+}
+
+int hotplug_start(void) {
+    if (hotplug_active)
+        return 0;
+    int ifd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (ifd < 0) {
+        perror("inotify_init1");
+        return -1;
+    }
+    // IN_ATTRIB : udev ajuste les droits du noeud après sa création
+    if (inotify_add_watch(ifd, HOTPLUG_INPUT_DIR, IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+        perror("inotify_add_watch " HOTPLUG_INPUT_DIR);
+        close(ifd);
+        return -1;
+    }
+    int stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stop_fd < 0) {
+        perror("eventfd hotplug");
+        close(ifd);
+        return -1;
+    }
+    hotplug_inotify_fd = ifd;
+    hotplug_stop_fd = stop_fd;
+    int rv = pthread_create(&hotplug_thread, NULL, hotplug_loop, NULL);
+    if (rv != 0) {
+        errno = rv;
+        perror("pthread_create hotplug");
+        close(ifd);
+        close(stop_fd);
+        hotplug_inotify_fd = -1;
+        hotplug_stop_fd = -1;
+        return -1;
+    }
+    hotplug_active = true;
+    return 0;
+}
+
+void hotplug_stop(void) {
+    if (!hotplug_active)
+        return;
+    uint64_t one = 1;
+    if (write(hotplug_stop_fd, &one, sizeof(one)) < 0)
+        perror("write(hotplug_stop_fd)");
+    pthread_join(hotplug_thread, NULL);
+    close(hotplug_inotify_fd);
+    close(hotplug_stop_fd);
+    hotplug_inotify_fd = -1;
+    hotplug_stop_fd = -1;
+    hotplug_active = false;
+}
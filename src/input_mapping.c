@@ -23,6 +23,8 @@
  * - `global_axis_index`: Global index for axis mapping.
  * - `global_button_index`: Global index for button mapping.
  * - `g_mapping_file`: Path to the JSON file used for saving/loading mappings.
+ * - `g_virtual_joysticks`, `g_nb_virtual_joysticks`: Virtual joystick layout ("virtual_joysticks"),
+ *   read once at startup; a change needs a restart since the host enumerates it.
  *
  * Functions:
  * - `int parse_hidraw_buttons(const char *hidraw_path, int *button_codes, int max_buttons)`: 
@@ -32,9 +34,19 @@
  * - `bool save_mapping(const char *filename, InputDevice *devices, int nb_joysticks, int global_axis, int global_button)`:
  *   Saves the input device mappings to a JSON file.
  * - `bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks, int *global_axis, int *global_button)`:
- *   Loads input device mappings from a JSON file.
+ *   Loads input device mappings from a JSON file, through the binary cache (mapping_cache.c)
+ *   when it matches the JSON source.
  * - `void init_physical_devices_wrapper(InputDevice **final_devices, int *nb_final)`:
  *   Initializes and merges detected input devices with saved mappings, and saves the updated mapping.
+ * - `int probe_input_device(const char *path, InputDevice *dev)`:
+ *   Opens one evdev node and fills its axes and buttons, without numbering its axes.
+ * - `void assign_default_axis_mapping(InputDevice *dev)`:
+ *   Gives the axes of a new device the next global axis indices.
+ * - `int apply_mapping_file(const char *filename, InputDevice *devices, int nb_devices)`:
+ *   Applies the saved mapping of a JSON file to already probed devices (live reload, hotplug);
+ *   returns the number of devices found in the file, or -1.
+ * - `void free_input_devices(InputDevice *devices, int nb_devices)`:
+ *   Closes the device descriptors and frees the device array.
  *
  * Usage:
  * - The functions in this file are designed to work with Linux input devices and require
@@ -44,6 +56,7 @@
  */
 #include "input_mapping.h"
 #include "usb_descriptors.h"    // Pour MAX_BUTTONS
+#include "mapping_cache.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,7 +64,11 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include <libgen.h>
+#include <sys/stat.h>
 #include <json-c/json.h>
 #include <sys/ioctl.h>
 #include <linux/input.h>
@@ -63,25 +80,42 @@ extern int g_nb_joysticks;
 int global_axis_index = 0;
 int global_button_index = 0;
 char g_mapping_file[PATH_MAX] = {0};
+VirtualJoystickLayout g_virtual_joysticks[MAX_VIRTUAL_JOYSTICKS] = {
+    { .nb_axes = DEFAULT_JOYSTICK_AXES, .nb_buttons = DEFAULT_JOYSTICK_BUTTONS },
+    { .nb_axes = DEFAULT_JOYSTICK_AXES, .nb_buttons = DEFAULT_JOYSTICK_BUTTONS },
+};
+int g_nb_virtual_joysticks = DEFAULT_VIRTUAL_JOYSTICKS;
 
-int parse_hidraw_buttons(const char *hidraw_path, int *button_codes, int max_buttons) {
-    int fd = open(hidraw_path, O_RDONLY);
-    if (fd < 0) return -1;
+// Ouvre un noeud evdev en non bloquant et bascule ses horodatages sur
+// CLOCK_MONOTONIC, l'horloge utilisée pour les mesures de latence.
+static int open_event_device(const char *path) {
+    int fd = open(path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0)
+        return -1;
+    int clk = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clk) < 0)
+        perror("Erreur EVIOCSCLOCKID");
+    return fd;
+}
+
+// Extrait la plage de boutons (Usage Page Button, Usage Minimum/Maximum) du
+// descripteur de rapport d'un hidraw déjà ouvert
+static int parse_hidraw_descriptor(int fd, int *button_codes, int max_buttons) {
     int desc_size;
-    if (ioctl(fd, HIDIOCGRDESCSIZE, &desc_size) < 0) {
-        close(fd);
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &desc_size) < 0)
         return -1;
-    }
-    unsigned char *desc = malloc(desc_size);
-    if (!desc) {
-        close(fd);
+    if (desc_size <= 0 || desc_size > HID_MAX_DESCRIPTOR_SIZE)
         return -1;
-    }
-    if (ioctl(fd, HIDIOCGRDESC, desc) < 0) {
-        free(desc);
-        close(fd);
+    // HIDIOCGRDESC attend une struct hidraw_report_descriptor dont size est renseigné
+    struct hidraw_report_descriptor *rdesc = malloc(sizeof(*rdesc));
+    if (!rdesc)
+        return -1;
+    rdesc->size = desc_size;
+    if (ioctl(fd, HIDIOCGRDESC, rdesc) < 0) {
+        free(rdesc);
         return -1;
     }
+    const unsigned char *desc = rdesc->value;
     int count = 0;
     int usage_page_found = 0;
     int usage_min = -1, usage_max = -1;
@@ -98,8 +132,7 @@ int parse_hidraw_buttons(const char *hidraw_path, int *button_codes, int max_but
              break;
          }
     }
-    free(desc);
-    close(fd);
+    free(rdesc);
     if (usage_page_found && usage_min != -1 && usage_max != -1 && usage_min <= usage_max) {
          for (int u = usage_min; u <= usage_max && count < max_buttons; u++) {
               button_codes[count] = 0x120 + (u - 1);
@@ -110,6 +143,14 @@ int parse_hidraw_buttons(const char *hidraw_path, int *button_codes, int max_but
     return -1;
 }
 
+int parse_hidraw_buttons(const char *hidraw_path, int *button_codes, int max_buttons) {
+    int fd = open(hidraw_path, O_RDONLY);
+    if (fd < 0) return -1;
+    int count = parse_hidraw_descriptor(fd, button_codes, max_buttons);
+    close(fd);
+    return count;
+}
+
 int find_hidraw_for_device(InputDevice *dev, char *hidraw_path, size_t hidraw_path_len) {
     glob_t glob_hid;
     if (glob("/dev/hidraw*", 0, NULL, &glob_hid) != 0) return -1;
@@ -136,10 +177,246 @@ int find_hidraw_for_device(InputDevice *dev, char *hidraw_path, size_t hidraw_pa
     return ret;
 }
 
+int hidraw_index_build(HidrawIndex *index) {
+    index->entries = NULL;
+    index->count = 0;
+    glob_t glob_hid;
+    if (glob("/dev/hidraw*", 0, NULL, &glob_hid) != 0)
+        return 0;
+    index->entries = calloc(glob_hid.gl_pathc, sizeof(HidrawEntry));
+    if (!index->entries) {
+        perror("malloc hidraw index");
+        globfree(&glob_hid);
+        return -1;
+    }
+    for (size_t i = 0; i < glob_hid.gl_pathc; i++) {
+        int fd = open(glob_hid.gl_pathv[i], O_RDONLY);
+        if (fd < 0)
+            continue;
+        struct hidraw_devinfo info;
+        memset(&info, 0, sizeof(info));
+        if (ioctl(fd, HIDIOCGRAWINFO, &info) == 0) {
+            HidrawEntry *entry = &index->entries[index->count++];
+            strncpy(entry->path, glob_hid.gl_pathv[i], sizeof(entry->path)-1);
+            entry->bustype = info.bustype;
+            entry->vendor = (uint16_t)info.vendor;   // __s16 dans hidraw_devinfo
+            entry->product = (uint16_t)info.product;
+            // Descripteur lu dans la même ouverture
+            entry->nb_buttons = parse_hidraw_descriptor(fd, entry->button_codes, MAX_BUTTONS);
+        }
+        close(fd);
+    }
+    globfree(&glob_hid);
+    return 0;
+}
+
+const HidrawEntry *hidraw_index_find(const HidrawIndex *index, const struct input_id *id) {
+    // Premier noeud correspondant, comme find_hidraw_for_device
+    for (int i = 0; i < index->count; i++) {
+        const HidrawEntry *entry = &index->entries[i];
+        if (entry->vendor == id->vendor && entry->product == id->product && entry->bustype == id->bustype)
+            return entry;
+    }
+    return NULL;
+}
+
+void hidraw_index_free(HidrawIndex *index) {
+    free(index->entries);
+    index->entries = NULL;
+    index->count = 0;
+}
+
+// Partie entrées/sorties du sondage (sans état global, exécutable en parallèle) :
+// nom, identifiants, axes, boutons complétés par le descripteur hidraw, pris
+// dans index s'il est fourni. Retourne -1 si le noeud est inaccessible ou ignoré.
+static int probe_device_io(const char *path, InputDevice *dev, const HidrawIndex *index) {
+    memset(dev, 0, sizeof(InputDevice));
+    strncpy(dev->path, path, sizeof(dev->path)-1);
+    dev->path[sizeof(dev->path)-1] = '\0';
+    dev->fd = open_event_device(dev->path);
+    if (dev->fd < 0) {
+        perror("Erreur open dev");
+        return -1;
+    }
+    // Distingue deux ouvertures successives réutilisant le même numéro de fd
+    static _Atomic unsigned next_uid = 1;
+    dev->uid = atomic_fetch_add(&next_uid, 1);
+    if (ioctl(dev->fd, EVIOCGNAME(sizeof(dev->name)), dev->name) < 0) {
+        perror("Erreur EVIOCGNAME");
+        strncpy(dev->name, "Unknown", sizeof(dev->name)-1);
+    }
+    if (ioctl(dev->fd, EVIOCGID, &dev->id) < 0) {
+        perror("Erreur EVIOCGID");
+        memset(&dev->id, 0, sizeof(dev->id));
+    }
+    if (strstr(dev->name, "vc4-hdmi")) {
+        close(dev->fd);
+        dev->fd = -1;
+        return -1;
+    }
+    for (int j = 0; j < ABS_CNT; j++) {
+        dev->axis_mapping[j] = -1;
+        dev->axis_dead_zone[j] = 0;
+        dev->axis_hysteresis[j] = 0;
+        dev->axis_quantization[j] = 0;
+        dev->axis_curve[j].nb_points = 0;
+        dev->axis_invert[j] = 0;
+        dev->axis_virtual_joystick[j] = 0;
+        dev->axis_virtual_axis[j] = -1;
+    }
+    for (int j = 0; j <= KEY_MAX; j++) {
+        dev->button_mapping[j] = -1;
+        dev->button_virtual_joystick[j] = 0;
+        dev->has_button[j] = 0;
+    }
+    unsigned char abs_bitmask[(ABS_CNT/8)+1] = {0};
+    if (ioctl(dev->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bitmask)), abs_bitmask) < 0) {
+        perror("Erreur EVIOCGBIT(EV_ABS)");
+    } else {
+        for (int j = 0; j < ABS_CNT; j++) {
+            if (abs_bitmask[j/8] & (1 << (j % 8))) {
+                if (ioctl(dev->fd, EVIOCGABS(j), &dev->absinfo[j]) == 0) {
+                    dev->has_abs[j] = 1;
+                    dev->num_axes++;
+                    if (dev->num_axes <= 8)
+                        dev->axis_virtual_axis[j] = dev->num_axes - 1;
+                    else
+                        dev->axis_virtual_axis[j] = (dev->num_axes - 1) % 8;
+                    dev->axis_virtual_joystick[j] = 0;
+                }
+            }
+        }
+    }
+    int taille_bitmask = (KEY_MAX + 7) / 8;
+    unsigned char key_bitmask[taille_bitmask];
+    memset(key_bitmask, 0, taille_bitmask);
+    if (ioctl(dev->fd, EVIOCGBIT(EV_KEY, taille_bitmask), key_bitmask) < 0) {
+        perror("Erreur EVIOCGBIT(EV_KEY)");
+    } else {
+        for (int j = 0; j <= KEY_MAX; j++) {
+            if (key_bitmask[j / 8] & (1 << (j % 8))) {
+                dev->has_button[j] = 1;
+                dev->num_buttons++;
+            }
+        }
+    }
+    int button_codes[MAX_BUTTONS];
+    int num = -1;
+    if (index) {
+        const HidrawEntry *entry = hidraw_index_find(index, &dev->id);
+        if (entry && entry->nb_buttons > 0) {
+            num = entry->nb_buttons;
+            memcpy(button_codes, entry->button_codes, num * sizeof(int));
+        }
+    } else {
+        char hidraw_path[PATH_MAX];
+        if (find_hidraw_for_device(dev, hidraw_path, sizeof(hidraw_path)) == 0)
+            num = parse_hidraw_buttons(hidraw_path, button_codes, MAX_BUTTONS);
+    }
+    for (int b = 0; b < num; b++) {
+        int ev_code = button_codes[b];
+        if (ev_code <= KEY_MAX) {
+            dev->has_button[ev_code] = 1;
+        }
+    }
+    return 0;
+}
+
+// Numérotation globale des axes d'un nouveau périphérique. Hors démarrage,
+// l'appelant tient device_table_lock() (global_axis_index est partagé avec la
+// sauvegarde et le rechargement).
+void assign_default_axis_mapping(InputDevice *dev) {
+    for (int j = 0; j < ABS_CNT; j++) {
+        if (dev->has_abs[j])
+            dev->axis_mapping[j] = global_axis_index++;
+    }
+}
+
+// Partie séquentielle : numérotation globale des axes, dans l'ordre des noeuds
+static void probe_device_finish(InputDevice *dev) {
+    assign_default_axis_mapping(dev);
+    printf("Périphérique: %s (%s) => %d axes, %d boutons\n",
+           dev->path, dev->name, dev->num_axes, dev->num_buttons);
+}
+
+// Ouvre et décrit un noeud evdev : nom, identifiants, axes, boutons
+// (complétés par le descripteur hidraw). Les axes ne sont pas numérotés :
+// voir assign_default_axis_mapping. Retourne -1 si le noeud est inaccessible
+// ou ignoré.
+int probe_input_device(const char *path, InputDevice *dev) {
+    if (probe_device_io(path, dev, NULL) < 0)
+        return -1;
+    printf("Périphérique: %s (%s) => %d axes, %d boutons\n",
+           dev->path, dev->name, dev->num_axes, dev->num_buttons);
+    return 0;
+}
+
+// Écriture atomique : fichier temporaire dans le même répertoire, fsync puis
+// rename, pour qu'une coupure ne laisse jamais un mapping tronqué
+static bool write_file_atomic(const char *filename, const char *data, size_t len) {
+    char tmp[PATH_MAX + 8];
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", filename);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        perror("mkstemp mapping");
+        return false;
+    }
+    fchmod(fd, 0644);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    if (done != len || fsync(fd) < 0) {
+        perror("write mapping");
+        close(fd);
+        unlink(tmp);
+        return false;
+    }
+    close(fd);
+    if (rename(tmp, filename) < 0) {
+        perror("rename mapping");
+        unlink(tmp);
+        return false;
+    }
+    // Rend le rename lui-même durable
+    char dir_path[PATH_MAX];
+    strncpy(dir_path, filename, sizeof(dir_path)-1);
+    dir_path[sizeof(dir_path)-1] = '\0';
+    int dfd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+    }
+    return true;
+}
+
+static char *read_mapping_source(const char *filename, size_t *size);
+
+// Seules les entrées utiles sont écrites : les boutons non mappés (mapped_button
+// -1, joystick 0, valeurs par défaut de load_mapping) ne figurent que dans
+// "available_buttons", qui liste les boutons présents pour l'interface web.
+// Le fichier n'est réécrit que si son contenu change.
 bool save_mapping(const char *filename, InputDevice *devices, int nb_joysticks, int global_axis, int global_button) {
     json_object *jobj = json_object_new_object();
     json_object_object_add(jobj, "global_axis_index", json_object_new_int(global_axis));
     json_object_object_add(jobj, "global_button_index", json_object_new_int(global_button));
+    json_object *jlayouts = json_object_new_array();
+    for (int j = 0; j < g_nb_virtual_joysticks; j++) {
+        json_object *jlayout = json_object_new_object();
+        json_object_object_add(jlayout, "axes", json_object_new_int(g_virtual_joysticks[j].nb_axes));
+        json_object_object_add(jlayout, "buttons", json_object_new_int(g_virtual_joysticks[j].nb_buttons));
+        if (g_virtual_joysticks[j].compact)
+            json_object_object_add(jlayout, "compact", json_object_new_boolean(1));
+        if (g_virtual_joysticks[j].axis_bits)
+            json_object_object_add(jlayout, "axis_bits", json_object_new_int(g_virtual_joysticks[j].axis_bits));
+        json_object_array_add(jlayouts, jlayout);
+    }
+    json_object_object_add(jobj, "virtual_joysticks", jlayouts);
     json_object *jdevices = json_object_new_array();
     for (int i = 0; i < nb_joysticks; i++) {
         json_object *jdev = json_object_new_object();
@@ -160,6 +437,19 @@ bool save_mapping(const char *filename, InputDevice *devices, int nb_joysticks,
             json_object_object_add(axobj, "code", json_object_new_int(code));
             json_object_object_add(axobj, "mapped_axis", json_object_new_int(devices[i].axis_mapping[code]));
             json_object_object_add(axobj, "dead_zone", json_object_new_int(devices[i].axis_dead_zone[code]));
+            json_object_object_add(axobj, "hysteresis", json_object_new_int(devices[i].axis_hysteresis[code]));
+            json_object_object_add(axobj, "quantization", json_object_new_int(devices[i].axis_quantization[code]));
+            const AxisCurve *curve = &devices[i].axis_curve[code];
+            if (curve->nb_points > 0) {
+                json_object *jcurve = json_object_new_array();
+                for (int p = 0; p < curve->nb_points; p++) {
+                    json_object *jpt = json_object_new_array();
+                    json_object_array_add(jpt, json_object_new_int(curve->x[p]));
+                    json_object_array_add(jpt, json_object_new_int(curve->y[p]));
+                    json_object_array_add(jcurve, jpt);
+                }
+                json_object_object_add(axobj, "curve", jcurve);
+            }
             json_object_object_add(axobj, "invert", json_object_new_boolean(devices[i].axis_invert[code] != 0));
             json_object_object_add(axobj, "virtual_joystick", json_object_new_int(devices[i].axis_virtual_joystick[code]));
             json_object_object_add(axobj, "virtual_axis", json_object_new_int(devices[i].axis_virtual_axis[code]));
@@ -167,10 +457,14 @@ bool save_mapping(const char *filename, InputDevice *devices, int nb_joysticks,
         }
         json_object_object_add(jdev, "axes", jaxes);
         
+        json_object *javailable = json_object_new_array();
         json_object *jbuttons = json_object_new_object();
         for (int code = 0; code <= KEY_MAX; code++) {
             if (!devices[i].has_button[code])
                 continue;
+            json_object_array_add(javailable, json_object_new_int(code));
+            if (devices[i].button_mapping[code] == -1 && devices[i].button_virtual_joystick[code] == 0)
+                continue;
             json_object *btnobj = json_object_new_object();
             json_object_object_add(btnobj, "mapped_button", json_object_new_int(devices[i].button_mapping[code]));
             json_object_object_add(btnobj, "virtual_joystick", json_object_new_int(devices[i].button_virtual_joystick[code]));
@@ -178,22 +472,116 @@ bool save_mapping(const char *filename, InputDevice *devices, int nb_joysticks,
             snprintf(code_str, sizeof(code_str), "%d", code);
             json_object_object_add(jbuttons, code_str, btnobj);
         }
+        json_object_object_add(jdev, "available_buttons", javailable);
         json_object_object_add(jdev, "buttons", jbuttons);
         
         json_object_array_add(jdevices, jdev);
     }
     json_object_object_add(jobj, "devices", jdevices);
-    int rc = json_object_to_file_ext(filename, jobj, JSON_C_TO_STRING_PRETTY);
+    size_t len = 0;
+    const char *text = json_object_to_json_string_length(jobj, JSON_C_TO_STRING_PRETTY, &len);
+    bool ok = text != NULL;
+    if (ok) {
+        size_t old_len = 0;
+        char *old_text = read_mapping_source(filename, &old_len);
+        bool unchanged = old_text && old_len == len && memcmp(old_text, text, len) == 0;
+        free(old_text);
+        if (!unchanged)
+            ok = write_file_atomic(filename, text, len);
+    }
     json_object_put(jobj);
-    return (rc == 0);
+    return ok;
 }
 
-bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks, int *global_axis, int *global_button) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return false;
-    fclose(f);
-    json_object *jobj = json_object_from_file(filename);
+// Lit tout le fichier de mapping (terminé par un octet nul) ; NULL en cas d'erreur
+static char *read_mapping_source(const char *filename, size_t *size) {
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    char *buf = malloc(st.st_size + 1);
+    if (!buf) {
+        close(fd);
+        return NULL;
+    }
+    size_t done = 0;
+    while (done < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + done, st.st_size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    buf[done] = '\0';
+    *size = done;
+    return buf;
+}
+
+// Disposition des joysticks virtuels ; *nb_layouts reste à 0 si elle est
+// absente ou invalide (disposition par défaut)
+static void parse_layouts_json(json_object *jobj, VirtualJoystickLayout *layouts, int *nb_layouts) {
+    *nb_layouts = 0;
+    json_object *jlayouts = NULL;
+    if (!json_object_object_get_ex(jobj, "virtual_joysticks", &jlayouts) ||
+        !json_object_is_type(jlayouts, json_type_array))
+        return;
+    int count = json_object_array_length(jlayouts);
+    if (count > MAX_VIRTUAL_JOYSTICKS)
+        count = MAX_VIRTUAL_JOYSTICKS + 1;      // rejeté par usb_joystick_layout_valid
+    for (int j = 0; j < count && j < MAX_VIRTUAL_JOYSTICKS; j++) {
+        json_object *jlayout = json_object_array_get_idx(jlayouts, j);
+        layouts[j].nb_axes = json_object_get_int(json_object_object_get(jlayout, "axes"));
+        layouts[j].nb_buttons = json_object_get_int(json_object_object_get(jlayout, "buttons"));
+        layouts[j].compact = json_object_get_boolean(json_object_object_get(jlayout, "compact"));
+        layouts[j].axis_bits = json_object_get_int(json_object_object_get(jlayout, "axis_bits"));
+    }
+    if (!usb_joystick_layout_valid(layouts, count)) {
+        printf("virtual_joysticks invalide (1 à %d joysticks, %d axes et %d boutons au plus, axis_bits 8, 10, 12 ou 16) : "
+               "disposition par défaut\n", MAX_VIRTUAL_JOYSTICKS, HID_MAX_AXES, MAX_BUTTONS);
+        return;
+    }
+    *nb_layouts = count;
+}
+
+// Courbe de réponse d'un axe : tableau de points [x, y] en unités HID. curve
+// reste vide (réponse linéaire) si elle est invalide.
+static bool load_axis_curve(json_object *jcurve, AxisCurve *curve) {
+    curve->nb_points = 0;
+    if (!json_object_is_type(jcurve, json_type_array))
+        return false;
+    int count = json_object_array_length(jcurve);
+    if (count > AXIS_CURVE_MAX_POINTS)
+        return false;
+    AxisCurve parsed = { .nb_points = count };
+    for (int p = 0; p < count; p++) {
+        json_object *jpt = json_object_array_get_idx(jcurve, p);
+        if (!json_object_is_type(jpt, json_type_array) || json_object_array_length(jpt) != 2)
+            return false;
+        int x = json_object_get_int(json_object_array_get_idx(jpt, 0));
+        int y = json_object_get_int(json_object_array_get_idx(jpt, 1));
+        if (x < -32768 || x > 32767 || y < -32768 || y > 32767)
+            return false;
+        parsed.x[p] = x;
+        parsed.y[p] = y;
+    }
+    if (!axis_curve_valid(&parsed))
+        return false;
+    *curve = parsed;
+    return true;
+}
+
+// Analyse du JSON (chemin lent, quand le cache binaire est absent ou périmé)
+static bool parse_mapping_json(const char *source, InputDevice **devices, int *nb_joysticks, int *global_axis, int *global_button,
+                               VirtualJoystickLayout *layouts, int *nb_layouts) {
+    json_object *jobj = json_tokener_parse(source);
     if (!jobj) return false;
+    parse_layouts_json(jobj, layouts, nb_layouts);
     json_object *jglobal_axis = NULL;
     json_object *jglobal_button = NULL;
     json_object_object_get_ex(jobj, "global_axis_index", &jglobal_axis);
@@ -212,24 +600,16 @@ bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks
         return false;
     }
     int count = json_object_array_length(jdevices);
-    *devices = calloc(count, sizeof(InputDevice));
+    *devices = calloc(count ? count : 1, sizeof(InputDevice));
+    if (!*devices) {
+        json_object_put(jobj);
+        return false;
+    }
     *nb_joysticks = count;
     for (int i = 0; i < count; i++) {
         json_object *jdev = json_object_array_get_idx(jdevices, i);
         InputDevice *idev = &(*devices)[i];
-        memset(idev, 0, sizeof(InputDevice));
-        for (int j = 0; j < ABS_CNT; j++) {
-            idev->axis_mapping[j] = -1;
-            idev->axis_dead_zone[j] = 0;
-            idev->axis_invert[j] = 0;
-            idev->axis_virtual_joystick[j] = 0;
-            idev->axis_virtual_axis[j] = -1;
-        }
-        for (int j = 0; j <= KEY_MAX; j++) {
-            idev->button_mapping[j] = -1;
-            idev->button_virtual_joystick[j] = 0;
-            idev->has_button[j] = 0;
-        }
+        mapping_cache_reset_device(idev);
         json_object *jpath = json_object_object_get(jdev, "path");
         if (jpath) {
             strncpy(idev->path, json_object_get_string(jpath), sizeof(idev->path)-1);
@@ -250,10 +630,9 @@ bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks
             for (int ax = 0; ax < nax; ax++) {
                 json_object *axobj = json_object_array_get_idx(jaxes, ax);
                 int code = json_object_get_int(json_object_object_get(axobj, "code"));
-                int mapped = json_object_get_int(json_object_object_get(axobj, "mapped_axis"));
-                if (code >= 0 && code < ABS_CNT) {
-                    idev->axis_mapping[code] = mapped;
-                }
+                if (code < 0 || code >= ABS_CNT)
+                    continue;
+                idev->axis_mapping[code] = json_object_get_int(json_object_object_get(axobj, "mapped_axis"));
                 json_object *jdz = json_object_object_get(axobj, "dead_zone");
                 if (jdz) {
                     int dz = json_object_get_int(jdz);
@@ -261,6 +640,24 @@ bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks
                     if (dz > 32767) dz = 32767;
                     idev->axis_dead_zone[code] = dz;
                 }
+                json_object *jhyst = json_object_object_get(axobj, "hysteresis");
+                if (jhyst) {
+                    int h = json_object_get_int(jhyst);
+                    if (h < 0) h = 0;
+                    if (h > 32767) h = 32767;
+                    idev->axis_hysteresis[code] = h;
+                }
+                json_object *jquant = json_object_object_get(axobj, "quantization");
+                if (jquant) {
+                    int q = json_object_get_int(jquant);
+                    if (q < 0) q = 0;
+                    if (q > 32767) q = 32767;
+                    idev->axis_quantization[code] = q;
+                }
+                json_object *jcurve = json_object_object_get(axobj, "curve");
+                if (jcurve && !load_axis_curve(jcurve, &idev->axis_curve[code]))
+                    printf("Courbe invalide (axe %d de %s) : %d points [x, y] au plus, x croissants. "
+                           "Réponse linéaire.\n", code, idev->name, AXIS_CURVE_MAX_POINTS);
                 json_object *jinvert = json_object_object_get(axobj, "invert");
                 if (jinvert) {
                     bool inv = json_object_get_boolean(jinvert);
@@ -282,27 +679,206 @@ bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks
         if (json_object_object_get_ex(jdev, "buttons", &jbuttons)) {
             json_object_object_foreach(jbuttons, key_str, jval) {
                 int code = atoi(key_str);
+                if (code < 0 || code > KEY_MAX)
+                    continue;
                 json_object *jmappedb, *jvirt;
-                if (json_object_object_get_ex(jval, "mapped_button", &jmappedb)) {
-                    int mappedb = json_object_get_int(jmappedb);
-                    if (code >= 0 && code <= KEY_MAX) {
-                        idev->button_mapping[code] = mappedb;
-                    }
-                }
-                if (json_object_object_get_ex(jval, "virtual_joystick", &jvirt)) {
+                if (json_object_object_get_ex(jval, "mapped_button", &jmappedb))
+                    idev->button_mapping[code] = json_object_get_int(jmappedb);
+                if (json_object_object_get_ex(jval, "virtual_joystick", &jvirt))
                     idev->button_virtual_joystick[code] = json_object_get_int(jvirt);
-                }
             }
         }
-        idev->fd = open(idev->path, O_RDONLY | O_NONBLOCK);
-        if (idev->fd < 0) {
-            perror("Erreur open device from mapping");
-        }
     }
     json_object_put(jobj);
     return true;
 }
 
+// Chargement complet : mapping des périphériques et disposition des joysticks virtuels
+static bool load_mapping_layout(const char *filename, InputDevice **devices, int *nb_joysticks, int *global_axis, int *global_button,
+                                VirtualJoystickLayout *layouts, int *nb_layouts) {
+    size_t size = 0;
+    char *source = read_mapping_source(filename, &size);
+    if (!source) return false;
+    uint64_t hash = mapping_cache_hash(source, size);
+    if (mapping_cache_load(filename, hash, size, devices, nb_joysticks, global_axis, global_button, layouts, nb_layouts)) {
+        free(source);
+        return true;
+    }
+    bool ok = parse_mapping_json(source, devices, nb_joysticks, global_axis, global_button, layouts, nb_layouts);
+    free(source);
+    if (ok)
+        mapping_cache_store(filename, hash, size, *devices, *nb_joysticks, *global_axis, *global_button, layouts, *nb_layouts);
+    return ok;
+}
+
+// Les périphériques renvoyés ne portent que le mapping sauvegardé (fd à -1) :
+// ils servent à la fusion avec les périphériques sondés. La disposition des
+// joysticks virtuels est ignorée (elle n'est lue qu'au démarrage).
+bool load_mapping(const char *filename, InputDevice **devices, int *nb_joysticks, int *global_axis, int *global_button) {
+    VirtualJoystickLayout layouts[MAX_VIRTUAL_JOYSTICKS];
+    int nb_layouts = 0;
+    return load_mapping_layout(filename, devices, nb_joysticks, global_axis, global_button, layouts, &nb_layouts);
+}
+
+// Reprend le mapping sauvegardé d'un périphérique (même identifiant USB)
+static void merge_saved_device(InputDevice *dst, const InputDevice *saved) {
+    memcpy(dst->axis_mapping, saved->axis_mapping, sizeof(saved->axis_mapping));
+    memcpy(dst->axis_dead_zone, saved->axis_dead_zone, sizeof(saved->axis_dead_zone));
+    memcpy(dst->axis_hysteresis, saved->axis_hysteresis, sizeof(saved->axis_hysteresis));
+    memcpy(dst->axis_quantization, saved->axis_quantization, sizeof(saved->axis_quantization));
+    memcpy(dst->axis_curve, saved->axis_curve, sizeof(saved->axis_curve));
+    memcpy(dst->axis_invert, saved->axis_invert, sizeof(saved->axis_invert));
+    memcpy(dst->axis_virtual_joystick, saved->axis_virtual_joystick, sizeof(saved->axis_virtual_joystick));
+    memcpy(dst->axis_virtual_axis, saved->axis_virtual_axis, sizeof(saved->axis_virtual_axis));
+    memcpy(dst->button_mapping, saved->button_mapping, sizeof(saved->button_mapping));
+    memcpy(dst->button_virtual_joystick, saved->button_virtual_joystick, sizeof(saved->button_virtual_joystick));
+    dst->num_axes = saved->num_axes;
+    dst->num_buttons = saved->num_buttons;
+}
+
+static bool same_device_id(const InputDevice *a, const InputDevice *b) {
+    return a->id.bustype == b->id.bustype && a->id.vendor == b->id.vendor &&
+           a->id.product == b->id.product && a->id.version == b->id.version;
+}
+
+int apply_mapping_file(const char *filename, InputDevice *devices, int nb_devices) {
+    InputDevice *saved = NULL;
+    int saved_count = 0;
+    int global_axis = 0, global_button = 0;
+    if (!load_mapping(filename, &saved, &saved_count, &global_axis, &global_button))
+        return -1;
+    int matched = 0;
+    for (int i = 0; i < nb_devices; i++) {
+        for (int j = 0; j < saved_count; j++) {
+            if (same_device_id(&devices[i], &saved[j])) {
+                merge_saved_device(&devices[i], &saved[j]);
+                matched++;
+                break;
+            }
+        }
+    }
+    free_input_devices(saved, saved_count);
+    return matched;
+}
+
+void free_input_devices(InputDevice *devices, int nb_devices) {
+    for (int i = 0; i < nb_devices; i++) {
+        if (devices[i].fd >= 0)
+            close(devices[i].fd);
+    }
+    free(devices);
+}
+
+// Nombre maximum de threads de sondage au démarrage
+#define PROBE_MAX_THREADS 4
+
+// Travail partagé par les threads de sondage : chacun prend le noeud suivant
+typedef struct {
+    const glob_t *paths;
+    InputDevice *devices;          // Une entrée par noeud
+    bool *ok;
+    const HidrawIndex *index;
+    _Atomic int next;
+} ProbeJob;
+
+static void *probe_worker(void *arg) {
+    ProbeJob *job = arg;
+    for (;;) {
+        int i = atomic_fetch_add(&job->next, 1);
+        if (i >= (int)job->paths->gl_pathc)
+            break;
+        job->ok[i] = probe_device_io(job->paths->gl_pathv[i], &job->devices[i], job->index) == 0;
+    }
+    return NULL;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Durées des phases du démarrage, affichées en fin d'initialisation
+typedef struct {
+    double load_ms;
+    double index_ms;
+    double probe_ms;
+    double merge_ms;
+    double save_ms;
+    int nb_nodes;
+    int nb_threads;
+} StartupTimings;
+
+// Sonde tous les noeuds /dev/input/event* : index hidraw construit une fois,
+// entrées/sorties réparties sur un petit pool de threads, puis numérotation
+// des axes dans l'ordre des noeuds (même résultat qu'un sondage séquentiel).
+// Retourne le nombre de périphériques retenus, -1 si aucun noeud n'existe.
+static int probe_all_devices(InputDevice **out, StartupTimings *timings) {
+    glob_t glob_result;
+    if (glob("/dev/input/event*", 0, NULL, &glob_result) != 0)
+        return -1;
+    int nb_nodes = glob_result.gl_pathc;
+    InputDevice *devices = malloc(nb_nodes * sizeof(InputDevice));
+    bool *ok = calloc(nb_nodes, sizeof(bool));
+    if (!devices || !ok) {
+        perror("malloc devices");
+        free(devices);
+        free(ok);
+        globfree(&glob_result);
+        exit(EXIT_FAILURE);
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    HidrawIndex index;
+    bool have_index = hidraw_index_build(&index) == 0;
+    timings->index_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ProbeJob job = { .paths = &glob_result, .devices = devices, .ok = ok,
+                     .index = have_index ? &index : NULL };
+    atomic_init(&job.next, 0);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int nb_threads = PROBE_MAX_THREADS;
+    if (cpus > 0 && cpus < nb_threads)
+        nb_threads = cpus;
+    if (nb_nodes < nb_threads)
+        nb_threads = nb_nodes;
+    pthread_t threads[PROBE_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < nb_threads; t++) {
+        if (pthread_create(&threads[started], NULL, probe_worker, &job) != 0)
+            break;
+        started++;
+    }
+    probe_worker(&job);
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    int count = 0;
+    for (int i = 0; i < nb_nodes; i++) {
+        if (!ok[i])
+            continue;
+        if (i != count)
+            memcpy(&devices[count], &devices[i], sizeof(InputDevice));
+        probe_device_finish(&devices[count]);
+        count++;
+    }
+    timings->probe_ms = elapsed_ms(&start);
+    timings->nb_nodes = nb_nodes;
+    timings->nb_threads = started + 1;
+    if (have_index)
+        hidraw_index_free(&index);
+    free(ok);
+    globfree(&glob_result);
+    *out = devices;
+    return count;
+}
+
+static void print_startup_timings(const StartupTimings *t) {
+    printf("Démarrage : mapping %.1f ms, index hidraw %.1f ms, sondage %.1f ms (%d noeuds, %d threads), "
+           "fusion %.1f ms, sauvegarde %.1f ms\n",
+           t->load_ms, t->index_ms, t->probe_ms, t->nb_nodes, t->nb_threads, t->merge_ms, t->save_ms);
+}
+
 void init_physical_devices_wrapper(InputDevice **final_devices, int *nb_final) {
     char exe_path[PATH_MAX];
     ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path)-1);
@@ -317,138 +893,40 @@ void init_physical_devices_wrapper(InputDevice **final_devices, int *nb_final) {
     strncpy(g_mapping_file, mapping_file, sizeof(g_mapping_file)-1);
     g_mapping_file[sizeof(g_mapping_file)-1] = '\0';
     
-    InputDevice *merged_devices = NULL;
-    int merged_count = 0;
+    StartupTimings timings;
+    memset(&timings, 0, sizeof(timings));
+    struct timespec start;
     if (access(mapping_file, F_OK) == 0) {
         printf("Fichier de mapping trouvé. Chargement depuis %s\n", mapping_file);
         InputDevice *saved_devices = NULL;
         int saved_count = 0;
-        if (!load_mapping(mapping_file, &saved_devices, &saved_count, &global_axis_index, &global_button_index)) {
+        VirtualJoystickLayout layouts[MAX_VIRTUAL_JOYSTICKS];
+        int nb_layouts = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!load_mapping_layout(mapping_file, &saved_devices, &saved_count, &global_axis_index, &global_button_index,
+                                 layouts, &nb_layouts)) {
             printf("Erreur lors du chargement du mapping. Nouveau mapping.\n");
+        } else if (nb_layouts > 0) {
+            memcpy(g_virtual_joysticks, layouts, nb_layouts * sizeof(layouts[0]));
+            g_nb_virtual_joysticks = nb_layouts;
         }
+        timings.load_ms = elapsed_ms(&start);
         InputDevice *detected_devices = NULL;
-        int detected_count = 0;
-        glob_t glob_result;
-        if (glob("/dev/input/event*", 0, NULL, &glob_result) != 0) {
+        int actual_count = probe_all_devices(&detected_devices, &timings);
+        if (actual_count < 0) {
             printf("Aucun périphérique evdev trouvé.\n");
+            free_input_devices(saved_devices, saved_count);
             return;
         }
-        detected_count = glob_result.gl_pathc;
-        detected_devices = malloc(detected_count * sizeof(InputDevice));
-        if (!detected_devices) {
-            perror("malloc detected_devices");
-            globfree(&glob_result);
-            exit(EXIT_FAILURE);
-        }
-        int actual_count = 0;
-        for (int i = 0; i < detected_count; i++) {
-            InputDevice *dev = &detected_devices[actual_count];
-            memset(dev, 0, sizeof(InputDevice));
-            strncpy(dev->path, glob_result.gl_pathv[i], sizeof(dev->path)-1);
-            dev->path[sizeof(dev->path)-1] = '\0';
-            dev->fd = open(dev->path, O_RDONLY | O_NONBLOCK);
-            if (dev->fd < 0) {
-                perror("Erreur open dev");
-                continue;
-            }
-            if (ioctl(dev->fd, EVIOCGNAME(sizeof(dev->name)), dev->name) < 0) {
-                perror("Erreur EVIOCGNAME");
-                strncpy(dev->name, "Unknown", sizeof(dev->name)-1);
-            }
-            if (ioctl(dev->fd, EVIOCGID, &dev->id) < 0) {
-                perror("Erreur EVIOCGID");
-                memset(&dev->id, 0, sizeof(dev->id));
-            }
-            if (strstr(dev->name, "vc4-hdmi")) {
-                close(dev->fd);
-                continue;
-            }
-            for (int j = 0; j < ABS_CNT; j++) {
-                dev->axis_mapping[j] = -1;
-                dev->axis_dead_zone[j] = 0;
-                dev->axis_invert[j] = 0;
-                dev->axis_virtual_joystick[j] = 0;
-                dev->axis_virtual_axis[j] = -1;
-            }
-            for (int j = 0; j <= KEY_MAX; j++) {
-                dev->button_mapping[j] = -1;
-                dev->button_virtual_joystick[j] = 0;
-                dev->has_button[j] = 0;
-            }
-            unsigned char abs_bitmask[(ABS_CNT/8)+1] = {0};
-            if (ioctl(dev->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bitmask)), abs_bitmask) < 0) {
-                perror("Erreur EVIOCGBIT(EV_ABS)");
-            } else {
-                for (int j = 0; j < ABS_CNT; j++) {
-                    if (abs_bitmask[j/8] & (1 << (j % 8))) {
-                        if (ioctl(dev->fd, EVIOCGABS(j), &dev->absinfo[j]) == 0) {
-                            dev->has_abs[j] = 1;
-                            dev->axis_mapping[j] = global_axis_index++;
-                            dev->num_axes++;
-                            if (dev->num_axes <= 8)
-                                dev->axis_virtual_axis[j] = dev->num_axes - 1;
-                            else
-                                dev->axis_virtual_axis[j] = (dev->num_axes - 1) % 8;
-                            dev->axis_virtual_joystick[j] = 0;
-                        }
-                    }
-                }
-            }
-            int taille_bitmask = (KEY_MAX + 7) / 8;
-            unsigned char key_bitmask[taille_bitmask];
-            memset(key_bitmask, 0, taille_bitmask);
-            if (ioctl(dev->fd, EVIOCGBIT(EV_KEY, taille_bitmask), key_bitmask) < 0) {
-                perror("Erreur EVIOCGBIT(EV_KEY)");
-            } else {
-                for (int j = 0; j <= KEY_MAX; j++) {
-                    if (key_bitmask[j / 8] & (1 << (j % 8))) {
-                        dev->has_button[j] = 1;  // Correction : pas "1_"
-                        dev->num_buttons++;
-                    }
-                }
-            }
-            {
-                char hidraw_path[PATH_MAX];
-                if (find_hidraw_for_device(dev, hidraw_path, sizeof(hidraw_path)) == 0) {
-                    int button_codes[MAX_BUTTONS];
-                    int num = parse_hidraw_buttons(hidraw_path, button_codes, MAX_BUTTONS);
-                    if (num > 0) {
-                        for (int b = 0; b < num; b++) {
-                            int ev_code = button_codes[b];
-                            if (ev_code <= KEY_MAX) {
-                                dev->has_button[ev_code] = 1;
-                            }
-                        }
-                    }
-                }
-            }
-            printf("Périphérique: %s (%s) => %d axes, %d boutons\n",
-                   dev->path, dev->name, dev->num_axes, dev->num_buttons);
-            actual_count++;
-        }
-        globfree(&glob_result);
-        merged_devices = malloc(actual_count * sizeof(InputDevice));
-        if (!merged_devices) {
-            perror("malloc merged_devices");
-            exit(EXIT_FAILURE);
-        }
-        merged_count = actual_count;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        // La fusion se fait en place : pas de copie des structures (plus de 10 Ko chacune)
+        InputDevice *merged_devices = detected_devices;
+        int merged_count = actual_count;
         for (int i = 0; i < actual_count; i++) {
             bool found = false;
             for (int j = 0; j < saved_count; j++) {
-                if (saved_devices && (saved_devices[j].id.bustype == detected_devices[i].id.bustype &&
-                    saved_devices[j].id.vendor == detected_devices[i].id.vendor &&
-                    saved_devices[j].id.product == detected_devices[i].id.product &&
-                    saved_devices[j].id.version == detected_devices[i].id.version)) {
-                    memcpy(detected_devices[i].axis_mapping, saved_devices[j].axis_mapping, sizeof(saved_devices[j].axis_mapping));
-                    memcpy(detected_devices[i].axis_dead_zone, saved_devices[j].axis_dead_zone, sizeof(saved_devices[j].axis_dead_zone));
-                    memcpy(detected_devices[i].axis_invert, saved_devices[j].axis_invert, sizeof(saved_devices[j].axis_invert));
-                    memcpy(detected_devices[i].axis_virtual_joystick, saved_devices[j].axis_virtual_joystick, sizeof(saved_devices[j].axis_virtual_joystick));
-                    memcpy(detected_devices[i].axis_virtual_axis, saved_devices[j].axis_virtual_axis, sizeof(saved_devices[j].axis_virtual_axis));
-                    memcpy(detected_devices[i].button_mapping, saved_devices[j].button_mapping, sizeof(saved_devices[j].button_mapping));
-                    memcpy(detected_devices[i].button_virtual_joystick, saved_devices[j].button_virtual_joystick, sizeof(saved_devices[j].button_virtual_joystick));
-                    detected_devices[i].num_axes = saved_devices[j].num_axes;
-                    detected_devices[i].num_buttons = saved_devices[j].num_buttons;
+                if (saved_devices && same_device_id(&saved_devices[j], &detected_devices[i])) {
+                    merge_saved_device(&detected_devices[i], &saved_devices[j]);
                     found = true;
                     break;
                 }
@@ -456,15 +934,11 @@ void init_physical_devices_wrapper(InputDevice **final_devices, int *nb_final) {
             if (!found) {
                 printf("Nouveau joystick détecté: %s\n", detected_devices[i].name);
             }
-            merged_devices[i] = detected_devices[i];
         }
         for (int j = 0; j < saved_count; j++) {
             bool still_present = false;
             for (int i = 0; i < merged_count; i++) {
-                if (saved_devices && (saved_devices[j].id.bustype == merged_devices[i].id.bustype &&
-                    saved_devices[j].id.vendor == merged_devices[i].id.vendor &&
-                    saved_devices[j].id.product == merged_devices[i].id.product &&
-                    saved_devices[j].id.version == merged_devices[i].id.version)) {
+                if (saved_devices && same_device_id(&saved_devices[j], &merged_devices[i])) {
                     still_present = true;
                     break;
                 }
@@ -473,99 +947,44 @@ void init_physical_devices_wrapper(InputDevice **final_devices, int *nb_final) {
                 printf("Joystick '%s' du mapping n'est plus détecté.\n", saved_devices[j].name);
             }
         }
-        free(saved_devices);
-        free(detected_devices);
+        free_input_devices(saved_devices, saved_count);
+        // Le sondage a numéroté tous les axes à la suite de l'index sauvegardé ;
+        // on repart du plus grand axe réellement mappé pour que le fichier reste
+        // identique d'un démarrage à l'autre
+        global_axis_index = 0;
+        for (int i = 0; i < merged_count; i++) {
+            for (int code = 0; code < ABS_CNT; code++) {
+                if (merged_devices[i].has_abs[code] && merged_devices[i].axis_mapping[code] >= global_axis_index)
+                    global_axis_index = merged_devices[i].axis_mapping[code] + 1;
+            }
+        }
+        timings.merge_ms = elapsed_ms(&start);
+        clock_gettime(CLOCK_MONOTONIC, &start);
         if (save_mapping(mapping_file, merged_devices, merged_count, global_axis_index, global_button_index))
-            printf("Mapping sauvegardé dans %s\n", mapping_file);
+            printf("Mapping à jour dans %s\n", mapping_file);
         else
             printf("Erreur lors de la sauvegarde du mapping\n");
+        timings.save_ms = elapsed_ms(&start);
+        print_startup_timings(&timings);
         *final_devices = merged_devices;
         *nb_final = merged_count;
         return;
     }
-    glob_t glob_result;
-    if (glob("/dev/input/event*", 0, NULL, &glob_result) != 0) {
+    InputDevice *devices = NULL;
+    int count = probe_all_devices(&devices, &timings);
+    if (count < 0) {
         printf("Aucun périphérique evdev trouvé.\n");
         return;
     }
-    int nb_devices = glob_result.gl_pathc;
-    InputDevice *devices = malloc(nb_devices * sizeof(InputDevice));
-    if (!devices) {
-        perror("malloc devices");
-        globfree(&glob_result);
-        return;
-    }
-    int count = 0;
-    for (int i = 0; i < nb_devices; i++) {
-        InputDevice *dev = &devices[count];
-        memset(dev, 0, sizeof(InputDevice));
-        strncpy(dev->path, glob_result.gl_pathv[i], sizeof(dev->path)-1);
-        dev->path[sizeof(dev->path)-1] = '\0';
-        dev->fd = open(dev->path, O_RDONLY | O_NONBLOCK);
-        if (dev->fd < 0) {
-            perror("Erreur open dev");
-            continue;
-        }
-        if (ioctl(dev->fd, EVIOCGNAME(sizeof(dev->name)), dev->name) < 0) {
-            perror("Erreur EVIOCGNAME");
-            strncpy(dev->name, "Unknown", sizeof(dev->name)-1);
-        }
-        if (ioctl(dev->fd, EVIOCGID, &dev->id) < 0) {
-            perror("Erreur EVIOCGID");
-            memset(&dev->id, 0, sizeof(dev->id));
-        }
-        if (strstr(dev->name, "vc4-hdmi")) {
-            close(dev->fd);
-            continue;
-        }
-        unsigned char abs_bitmask[(ABS_CNT/8)+1] = {0};
-        if (ioctl(dev->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bitmask)), abs_bitmask) < 0) {
-            perror("Erreur EVIOCGBIT(EV_ABS)");
-        } else {
-            for (int j = 0; j < ABS_CNT; j++) {
-                if (abs_bitmask[j/8] & (1 << (j % 8))) {
-                    if (ioctl(dev->fd, EVIOCGABS(j), &dev->absinfo[j]) == 0) {
-                        dev->has_abs[j] = 1;
-                        dev->axis_mapping[j] = global_axis_index++;
-                        dev->num_axes++;
-                        if (dev->num_axes <= 8)
-                            dev->axis_virtual_axis[j] = dev->num_axes - 1;
-                        else
-                            dev->axis_virtual_axis[j] = (dev->num_axes - 1) % 8;
-                        dev->axis_virtual_joystick[j] = 0;
-                    }
-                }
-            }
-        }
-        for (int j = 0; j <= KEY_MAX; j++) {
-            dev->button_mapping[j] = -1;
-            dev->button_virtual_joystick[j] = 0;
-            dev->has_button[j] = 0;
-        }
-        int taille_bitmask = (KEY_MAX + 7) / 8;
-        unsigned char key_bitmask[taille_bitmask];
-        memset(key_bitmask, 0, taille_bitmask);
-        if (ioctl(dev->fd, EVIOCGBIT(EV_KEY, taille_bitmask), key_bitmask) < 0) {
-            perror("Erreur EVIOCGBIT(EV_KEY)");
-        } else {
-            for (int j = 0; j <= KEY_MAX; j++) {
-                if (key_bitmask[j / 8] & (1 << (j % 8))) {
-                    dev->has_button[j] = 1;
-                    dev->num_buttons++;
-                }
-            }
-        }
-        printf("Périphérique: %s (%s) => %d axes, %d boutons\n",
-               dev->path, dev->name, dev->num_axes, dev->num_buttons);
-        count++;
-    }
-    globfree(&glob_result);
     *final_devices = devices;
     *nb_final = count;
     if (count > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
         if (save_mapping(mapping_file, devices, count, global_axis_index, global_button_index))
-            printf("Mapping sauvegardé dans %s\n", mapping_file);
+            printf("Mapping à jour dans %s\n", mapping_file);
         else
             printf("Erreur lors de la sauvegarde du mapping\n");
+        timings.save_ms = elapsed_ms(&start);
     }
+    print_startup_timings(&timings);
 }
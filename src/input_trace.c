@@ -0,0 +1,362 @@
+#include "input_trace.h"
+#include "latency_stats.h"
+#include "mapping_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Anneau d'octets entre le thread HID et le thread d'écriture (puissance de 2)
+#define TRACE_RING_SIZE (4u * 1024 * 1024)
+// Période de réveil du thread d'écriture
+#define TRACE_FLUSH_PERIOD_NS 20000000L
+// Lot d'événements convertis à la fois (pile du thread HID)
+#define TRACE_EVENT_CHUNK 64
+
+static uint8_t *trace_ring = NULL;
+static _Atomic uint32_t trace_head = 0;       // Ecrit par le thread HID
+static _Atomic uint32_t trace_tail = 0;       // Ecrit par le thread d'écriture
+static _Atomic uint64_t trace_dropped = 0;
+static _Atomic uint64_t trace_records = 0;
+static atomic_bool trace_on = false;
+static atomic_bool trace_stop_flag = false;
+static pthread_t trace_thread;
+static int trace_fd = -1;
+
+bool input_trace_active(void) {
+    return atomic_load_explicit(&trace_on, memory_order_relaxed);
+}
+
+// Copie len octets à la position pos de l'anneau, avec repli en fin de tampon
+static void ring_copy(uint32_t pos, const void *data, uint32_t len) {
+    uint32_t at = pos & (TRACE_RING_SIZE - 1);
+    uint32_t first = TRACE_RING_SIZE - at < len ? TRACE_RING_SIZE - at : len;
+    memcpy(trace_ring + at, data, first);
+    memcpy(trace_ring, (const uint8_t *)data + first, len - first);
+}
+
+// Réserve un enregistrement complet ; retourne sa position, ou false si
+// l'anneau est plein (enregistrement perdu)
+static bool ring_reserve(uint32_t len, uint32_t *pos) {
+    uint32_t head = atomic_load_explicit(&trace_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&trace_tail, memory_order_acquire);
+    if (TRACE_RING_SIZE - (head - tail) < len) {
+        atomic_fetch_add_explicit(&trace_dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    *pos = head;
+    return true;
+}
+
+static void ring_commit(uint32_t pos, uint32_t len) {
+    atomic_store_explicit(&trace_head, pos + len, memory_order_release);
+    atomic_fetch_add_explicit(&trace_records, 1, memory_order_relaxed);
+}
+
+static void write_all(const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(trace_fd, data, len);
+        if (n <= 0) {
+            perror("write(trace)");
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+static void flush_ring(void) {
+    uint32_t head = atomic_load_explicit(&trace_head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&trace_tail, memory_order_relaxed);
+    uint32_t len = head - tail;
+    if (!len)
+        return;
+    uint32_t at = tail & (TRACE_RING_SIZE - 1);
+    uint32_t first = TRACE_RING_SIZE - at < len ? TRACE_RING_SIZE - at : len;
+    write_all(trace_ring + at, first);
+    write_all(trace_ring, len - first);
+    atomic_store_explicit(&trace_tail, head, memory_order_release);
+}
+
+static void *trace_main(void *arg) {
+    (void)arg;
+    struct timespec period = { 0, TRACE_FLUSH_PERIOD_NS };
+    while (!atomic_load(&trace_stop_flag)) {
+        flush_ring();
+        nanosleep(&period, NULL);
+    }
+    flush_ring();
+    return NULL;
+}
+
+static void describe_reports(InputTraceHeader *hdr) {
+    hdr->nb_joysticks = usb_nb_joysticks;
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        InputTraceReport *tr = &hdr->reports[j];
+        const ReportLayout *rl = &usb_reports[j];
+        tr->nb_axes = usb_joysticks[j].nb_axes;
+        tr->nb_buttons = usb_joysticks[j].nb_buttons;
+        tr->compact = usb_joysticks[j].compact;
+        tr->axis_bits = usb_joysticks[j].axis_bits;
+        tr->report_axis_bits = rl->axis_bits;
+        tr->report_nb_axes = rl->nb_axes;
+        tr->report_nb_buttons = rl->nb_buttons;
+        memcpy(tr->axis_slots, rl->axis_slots, sizeof(tr->axis_slots));
+        memcpy(tr->button_slots, rl->button_slots, sizeof(tr->button_slots));
+    }
+}
+
+int input_trace_start(const char *path) {
+    if (input_trace_active())
+        return 0;
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0) {
+        perror("open trace");
+        return -1;
+    }
+    InputTraceHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = INPUT_TRACE_MAGIC;
+    hdr.version = INPUT_TRACE_VERSION;
+    hdr.start_ns = latency_now_ns();
+    describe_reports(&hdr);
+    write_all((const uint8_t *)&hdr, sizeof(hdr));
+    trace_ring = malloc(TRACE_RING_SIZE);
+    if (!trace_ring) {
+        perror("malloc trace ring");
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+    // Pages de l'anneau présentes avant le premier enregistrement
+    memset(trace_ring, 0, TRACE_RING_SIZE);
+    atomic_store(&trace_head, 0);
+    atomic_store(&trace_tail, 0);
+    atomic_store(&trace_dropped, 0);
+    atomic_store(&trace_records, 0);
+    atomic_store(&trace_stop_flag, false);
+    int rv = pthread_create(&trace_thread, NULL, trace_main, NULL);
+    if (rv != 0) {
+        fprintf(stderr, "pthread_create(trace): %s\n", strerror(rv));
+        free(trace_ring);
+        trace_ring = NULL;
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+    atomic_store(&trace_on, true);
+    return 0;
+}
+
+void input_trace_stop(void) {
+    if (!input_trace_active())
+        return;
+    atomic_store(&trace_on, false);
+    atomic_store(&trace_stop_flag, true);
+    pthread_join(trace_thread, NULL);
+    close(trace_fd);
+    trace_fd = -1;
+    free(trace_ring);
+    trace_ring = NULL;
+    printf("Trace evdev: %llu enregistrements, %llu perdus (anneau plein)\n",
+           (unsigned long long)atomic_load(&trace_records), (unsigned long long)atomic_load(&trace_dropped));
+}
+
+void input_trace_device(const InputDevice *dev) {
+    if (!input_trace_active())
+        return;
+    InputTraceDevice td;
+    memset(&td, 0, sizeof(td));
+    memcpy(td.name, dev->name, sizeof(td.name) - 1);
+    td.bustype = dev->id.bustype;
+    td.vendor = dev->id.vendor;
+    td.product = dev->id.product;
+    td.version = dev->id.version;
+    for (int code = 0; code < ABS_CNT; code++)
+        td.nb_axes += dev->has_abs[code] != 0;
+    for (int code = 0; code <= KEY_MAX; code++)
+        td.nb_buttons += dev->has_button[code] != 0;
+    uint32_t payload = sizeof(td) + td.nb_axes * sizeof(InputTraceAxis) + td.nb_buttons * sizeof(InputTraceButton);
+    InputTraceRecord rec = { .ts_ns = latency_now_ns(), .uid = dev->uid, .type = INPUT_TRACE_DEVICE,
+                             .length = payload };
+    uint32_t pos;
+    if (!ring_reserve(sizeof(rec) + payload, &pos))
+        return;
+    uint32_t at = pos;
+    ring_copy(at, &rec, sizeof(rec));
+    at += sizeof(rec);
+    ring_copy(at, &td, sizeof(td));
+    at += sizeof(td);
+    for (int code = 0; code < ABS_CNT; code++) {
+        if (!dev->has_abs[code])
+            continue;
+        const struct input_absinfo *info = &dev->absinfo[code];
+        InputTraceAxis ta = {
+            .code = code, .minimum = info->minimum, .maximum = info->maximum, .fuzz = info->fuzz,
+            .flat = info->flat, .resolution = info->resolution, .mapped = dev->axis_mapping[code],
+            .dead_zone = dev->axis_dead_zone[code], .hysteresis = dev->axis_hysteresis[code],
+            .quantization = dev->axis_quantization[code], .invert = dev->axis_invert[code],
+            .virtual_joystick = dev->axis_virtual_joystick[code], .virtual_axis = dev->axis_virtual_axis[code],
+            .curve = dev->axis_curve[code],
+        };
+        ring_copy(at, &ta, sizeof(ta));
+        at += sizeof(ta);
+    }
+    for (int code = 0; code <= KEY_MAX; code++) {
+        if (!dev->has_button[code])
+            continue;
+        InputTraceButton tb = { .code = code, .mapped = dev->button_mapping[code],
+                                .virtual_joystick = dev->button_virtual_joystick[code] };
+        ring_copy(at, &tb, sizeof(tb));
+        at += sizeof(tb);
+    }
+    ring_commit(pos, at - pos);
+}
+
+void input_trace_events(unsigned uid, const struct input_event *events, int count) {
+    if (!input_trace_active() || count <= 0)
+        return;
+    uint64_t now = latency_now_ns();
+    uint32_t payload = count * sizeof(InputTraceEvent);
+    InputTraceRecord rec = { .ts_ns = now, .uid = uid, .type = INPUT_TRACE_EVENTS, .length = payload };
+    uint32_t pos;
+    if (!ring_reserve(sizeof(rec) + payload, &pos))
+        return;
+    ring_copy(pos, &rec, sizeof(rec));
+    uint32_t at = pos + sizeof(rec);
+    InputTraceEvent chunk[TRACE_EVENT_CHUNK];
+    for (int i = 0; i < count; ) {
+        int n = 0;
+        for (; n < TRACE_EVENT_CHUNK && i < count; n++, i++) {
+            const struct input_event *ev = &events[i];
+            uint64_t ts = (uint64_t)ev->input_event_sec * 1000000000ULL + (uint64_t)ev->input_event_usec * 1000ULL;
+            uint64_t age = now > ts ? (now - ts) / 1000 : 0;
+            chunk[n].age_us = age > UINT32_MAX ? UINT32_MAX : (uint32_t)age;
+            chunk[n].type = ev->type;
+            chunk[n].code = ev->code;
+            chunk[n].value = ev->value;
+        }
+        ring_copy(at, chunk, n * sizeof(InputTraceEvent));
+        at += n * sizeof(InputTraceEvent);
+    }
+    ring_commit(pos, at - pos);
+}
+
+void input_trace_state(unsigned uid, int type, const InputTraceState *state) {
+    if (!input_trace_active())
+        return;
+    InputTraceRecord rec = { .ts_ns = latency_now_ns(), .uid = uid, .type = type, .length = sizeof(*state) };
+    uint32_t pos;
+    if (!ring_reserve(sizeof(rec) + sizeof(*state), &pos))
+        return;
+    ring_copy(pos, &rec, sizeof(rec));
+    ring_copy(pos + sizeof(rec), state, sizeof(*state));
+    ring_commit(pos, sizeof(rec) + sizeof(*state));
+}
+
+int input_trace_open(const char *path, InputTraceReader *reader) {
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(InputTraceHeader)) {
+        fprintf(stderr, "%s: trace trop courte\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap trace");
+        return -1;
+    }
+    const InputTraceHeader *hdr = map;
+    if (hdr->magic != INPUT_TRACE_MAGIC || hdr->version != INPUT_TRACE_VERSION ||
+        hdr->nb_joysticks < 1 || hdr->nb_joysticks > MAX_VIRTUAL_JOYSTICKS) {
+        fprintf(stderr, "%s: pas une trace evdev version %d\n", path, INPUT_TRACE_VERSION);
+        munmap(map, st.st_size);
+        return -1;
+    }
+    reader->base = map;
+    reader->len = st.st_size;
+    reader->off = sizeof(InputTraceHeader);
+    reader->header = hdr;
+    return 0;
+}
+
+bool input_trace_next(InputTraceReader *reader, const InputTraceRecord **rec, const void **payload) {
+    if (reader->len - reader->off < sizeof(InputTraceRecord))
+        return false;
+    const InputTraceRecord *r = (const InputTraceRecord *)(reader->base + reader->off);
+    if (reader->len - reader->off - sizeof(InputTraceRecord) < r->length)
+        return false;
+    *rec = r;
+    *payload = reader->base + reader->off + sizeof(InputTraceRecord);
+    reader->off += sizeof(InputTraceRecord) + r->length;
+    return true;
+}
+
+void input_trace_close(InputTraceReader *reader) {
+    if (reader->base)
+        munmap((void *)reader->base, reader->len);
+    memset(reader, 0, sizeof(*reader));
+}
+
+bool input_trace_decode_device(const InputTraceRecord *rec, const void *payload, InputDevice *dev) {
+    if (rec->type != INPUT_TRACE_DEVICE || rec->length < sizeof(InputTraceDevice))
+        return false;
+    const InputTraceDevice *td = payload;
+    if (td->nb_axes > ABS_CNT || td->nb_buttons > KEY_MAX + 1 ||
+        rec->length != sizeof(*td) + td->nb_axes * sizeof(InputTraceAxis) + td->nb_buttons * sizeof(InputTraceButton))
+        return false;
+    mapping_cache_reset_device(dev);
+    memcpy(dev->name, td->name, sizeof(dev->name) - 1);
+    snprintf(dev->path, sizeof(dev->path), "trace:%u", rec->uid);
+    dev->id.bustype = td->bustype;
+    dev->id.vendor = td->vendor;
+    dev->id.product = td->product;
+    dev->id.version = td->version;
+    dev->uid = rec->uid;
+    const InputTraceAxis *axes = (const InputTraceAxis *)(td + 1);
+    for (uint32_t a = 0; a < td->nb_axes; a++) {
+        int code = axes[a].code;
+        if (code < 0 || code >= ABS_CNT)
+            return false;
+        dev->has_abs[code] = 1;
+        dev->num_axes++;
+        dev->absinfo[code].minimum = axes[a].minimum;
+        dev->absinfo[code].maximum = axes[a].maximum;
+        dev->absinfo[code].fuzz = axes[a].fuzz;
+        dev->absinfo[code].flat = axes[a].flat;
+        dev->absinfo[code].resolution = axes[a].resolution;
+        dev->axis_mapping[code] = axes[a].mapped;
+        dev->axis_dead_zone[code] = axes[a].dead_zone;
+        dev->axis_hysteresis[code] = axes[a].hysteresis;
+        dev->axis_quantization[code] = axes[a].quantization;
+        dev->axis_invert[code] = axes[a].invert;
+        dev->axis_virtual_joystick[code] = axes[a].virtual_joystick;
+        dev->axis_virtual_axis[code] = axes[a].virtual_axis;
+        if (axis_curve_valid(&axes[a].curve))
+            dev->axis_curve[code] = axes[a].curve;
+    }
+    const InputTraceButton *buttons = (const InputTraceButton *)(axes + td->nb_axes);
+    for (uint32_t b = 0; b < td->nb_buttons; b++) {
+        int code = buttons[b].code;
+        if (code < 0 || code > KEY_MAX)
+            return false;
+        dev->has_button[code] = 1;
+        dev->num_buttons++;
+        dev->button_mapping[code] = buttons[b].mapped;
+        dev->button_virtual_joystick[code] = buttons[b].virtual_joystick;
+    }
+    return true;
+}
@@ -0,0 +1,132 @@
+#include "latency_stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+static LatencyHistogram histograms[LATENCY_MAX_ENDPOINTS][LAT_STAGE_COUNT];
+static volatile sig_atomic_t dump_requested = 0;
+
+static const char *stage_names[LAT_STAGE_COUNT] = {
+    "evdev->commit", "commit->ep_write", "evdev->ep_write"
+};
+
+uint64_t latency_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int bucket_index(uint64_t v) {
+    if (v < LAT_HIST_SUB_COUNT)
+        return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - LAT_HIST_SUB_BITS;
+    return (shift + 1) * LAT_HIST_SUB_COUNT + (int)((v >> shift) & (LAT_HIST_SUB_COUNT - 1));
+}
+
+// Borne supérieure (incluse) des valeurs d'un intervalle
+static uint64_t bucket_upper(int idx) {
+    if (idx < LAT_HIST_SUB_COUNT)
+        return (uint64_t)idx;
+    int shift = idx / LAT_HIST_SUB_COUNT - 1;
+    uint64_t sub = (uint64_t)(idx % LAT_HIST_SUB_COUNT) | LAT_HIST_SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+void latency_hist_record(LatencyHistogram *h, uint64_t ns) {
+    atomic_fetch_add_explicit(&h->counts[bucket_index(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+    if (ns > atomic_load_explicit(&h->max, memory_order_relaxed))
+        atomic_store_explicit(&h->max, ns, memory_order_relaxed);
+}
+
+uint64_t latency_hist_percentile(const LatencyHistogram *h, double percentile) {
+    uint64_t total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    if (total == 0)
+        return 0;
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)total);
+    if (target == 0)
+        target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LAT_HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t upper = bucket_upper(i);
+            uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+            return upper < max ? upper : max;
+        }
+    }
+    return atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+void latency_hist_reset(LatencyHistogram *h) {
+    for (int i = 0; i < LAT_HIST_BUCKETS; i++)
+        atomic_store_explicit(&h->counts[i], 0, memory_order_relaxed);
+    atomic_store_explicit(&h->total, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->max, 0, memory_order_relaxed);
+}
+
+void latency_stats_record(int endpoint, int stage, uint64_t ns) {
+    if (endpoint < 0 || endpoint >= LATENCY_MAX_ENDPOINTS || stage < 0 || stage >= LAT_STAGE_COUNT)
+        return;
+    latency_hist_record(&histograms[endpoint][stage], ns);
+}
+
+void latency_stats_reset(void) {
+    for (int e = 0; e < LATENCY_MAX_ENDPOINTS; e++)
+        for (int s = 0; s < LAT_STAGE_COUNT; s++)
+            latency_hist_reset(&histograms[e][s]);
+}
+
+size_t latency_stats_format(char *buf, size_t len) {
+    size_t pos = 0;
+    if (len == 0)
+        return 0;
+    buf[0] = '\0';
+    for (int e = 0; e < LATENCY_MAX_ENDPOINTS; e++) {
+        for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+            const LatencyHistogram *h = &histograms[e][s];
+            uint64_t total = atomic_load_explicit(&h->total, memory_order_relaxed);
+            if (total == 0)
+                continue;
+            int n = snprintf(buf + pos, len - pos,
+                             "latency ep%d %-17s n=%llu p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n",
+                             e, stage_names[s], (unsigned long long)total,
+                             latency_hist_percentile(h, 50.0) / 1000.0,
+                             latency_hist_percentile(h, 99.0) / 1000.0,
+                             latency_hist_percentile(h, 99.9) / 1000.0,
+                             atomic_load_explicit(&h->max, memory_order_relaxed) / 1000.0);
+            if (n < 0 || (size_t)n >= len - pos)
+                return len - 1;
+            pos += n;
+        }
+    }
+    if (pos == 0)
+        pos = snprintf(buf, len, "latency: aucun rapport mesuré\n");
+    return pos;
+}
+
+static void on_dump_signal(int signum) {
+    (void)signum;
+    dump_requested = 1;
+}
+
+void latency_stats_install_signal(int signum) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_dump_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(signum, &sa, NULL);
+}
+
+void latency_stats_poll_dump(void) {
+    if (!dump_requested)
+        return;
+    dump_requested = 0;
+    char buf[LATENCY_MAX_ENDPOINTS * LAT_STAGE_COUNT * 128];
+    latency_stats_format(buf, sizeof(buf));
+    fputs(buf, stdout);
+    fflush(stdout);
+}
@@ -0,0 +1,441 @@
+#include "log_ring.h"
+#include "usb_hid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <strings.h>
+#include <pthread.h>
+#include <time.h>
+
+// Période de réveil du thread de vidage
+#define LOG_DRAIN_PERIOD_NS 10000000L
+
+typedef union {
+    int64_t i;
+    uint64_t u;
+    double d;
+} LogArg;
+
+// Enregistrement binaire de taille fixe (le format pointe vers une chaîne statique)
+typedef struct {
+    uint64_t ts_ns;
+    const char *fmt;
+    uint8_t category;
+    uint8_t level;
+    uint8_t nb_args;
+    uint8_t str_len;
+    LogArg args[LOG_MAX_ARGS];
+    char str[LOG_STR_MAX];
+} LogRecord;
+
+// Limitation de débit par catégorie : fenêtre fixe d'une seconde (état propre au producteur)
+typedef struct {
+    uint64_t window_start;
+    uint32_t count;
+} LogRateWindow;
+
+typedef struct {
+    _Atomic uint32_t head;                    // Ecrit par le producteur
+    char pad0[64 - sizeof(uint32_t)];
+    _Atomic uint32_t tail;                    // Ecrit par le thread de vidage
+    char pad1[64 - sizeof(uint32_t)];
+    char name[16];
+    _Atomic uint64_t dropped;                 // Anneau plein
+    _Atomic uint64_t suppressed[LOG_CAT_COUNT]; // Limite de débit atteinte
+    uint64_t reported_dropped;                // Vu par le thread de vidage
+    uint64_t reported_suppressed[LOG_CAT_COUNT];
+    LogRateWindow rate[LOG_CAT_COUNT];
+    LogRecord rec[LOG_RING_SIZE];
+} LogRing;
+
+static const char *category_names[LOG_CAT_COUNT] = {
+    "general", "axis", "button", "device", "usb", "ep0"
+};
+
+static _Atomic int log_level = LOG_LEVEL_INFO;
+static _Atomic unsigned log_rate[LOG_CAT_COUNT] = {
+    [LOG_CAT_AXIS] = 100,
+    [LOG_CAT_BUTTON] = 100,
+};
+
+static LogRing *_Atomic rings[LOG_MAX_PRODUCERS];
+static atomic_bool ring_in_use[LOG_MAX_PRODUCERS];
+static __thread LogRing *tls_ring = NULL;
+
+static pthread_t drain_thread;
+static bool drain_running = false;
+static atomic_bool drain_stop = false;
+static void (*_Atomic periodic_hook)(void) = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void log_ring_set_level(int level) {
+    atomic_store_explicit(&log_level, level, memory_order_relaxed);
+}
+
+int log_ring_get_level(void) {
+    return atomic_load_explicit(&log_level, memory_order_relaxed);
+}
+
+void log_ring_set_rate(int category, unsigned per_second) {
+    if (category >= 0 && category < LOG_CAT_COUNT)
+        atomic_store_explicit(&log_rate[category], per_second, memory_order_relaxed);
+}
+
+int log_ring_apply_option(const char *opt) {
+    const char *eq = strchr(opt, '=');
+    if (!eq)
+        return -1;
+    size_t key_len = eq - opt;
+    const char *value = eq + 1;
+    if (key_len == 5 && strncmp(opt, "level", 5) == 0) {
+        if (strcasecmp(value, "error") == 0)
+            log_ring_set_level(LOG_LEVEL_ERROR);
+        else if (strcasecmp(value, "info") == 0)
+            log_ring_set_level(LOG_LEVEL_INFO);
+        else if (strcasecmp(value, "debug") == 0)
+            log_ring_set_level(LOG_LEVEL_DEBUG);
+        else
+            return -1;
+        return 0;
+    }
+    for (int c = 0; c < LOG_CAT_COUNT; c++) {
+        if (strlen(category_names[c]) == key_len && strncmp(opt, category_names[c], key_len) == 0) {
+            log_ring_set_rate(c, (unsigned)strtoul(value, NULL, 10));
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void log_ring_configure_from_env(void) {
+    const char *level = getenv("RAW_JOYSTICK_LOG_LEVEL");
+    if (level) {
+        char opt[64];
+        snprintf(opt, sizeof(opt), "level=%s", level);
+        if (log_ring_apply_option(opt) < 0)
+            fprintf(stderr, "RAW_JOYSTICK_LOG_LEVEL invalide: %s\n", level);
+    }
+    const char *rates = getenv("RAW_JOYSTICK_LOG_RATE");
+    if (rates) {
+        char *copy = strdup(rates);
+        if (!copy)
+            return;
+        char *save = NULL;
+        for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+            if (log_ring_apply_option(tok) < 0)
+                fprintf(stderr, "RAW_JOYSTICK_LOG_RATE: option invalide '%s'\n", tok);
+        }
+        free(copy);
+    }
+}
+
+int log_ring_register_thread(const char *name) {
+    if (tls_ring)
+        return 0;
+    for (int i = 0; i < LOG_MAX_PRODUCERS; i++) {
+        bool expected = false;
+        if (!atomic_compare_exchange_strong(&ring_in_use[i], &expected, true))
+            continue;
+        LogRing *ring = atomic_load(&rings[i]);
+        if (!ring) {
+            ring = calloc(1, sizeof(LogRing));
+            if (!ring) {
+                atomic_store(&ring_in_use[i], false);
+                return -1;
+            }
+            atomic_store(&rings[i], ring);
+        }
+        snprintf(ring->name, sizeof(ring->name), "%s", name);
+        tls_ring = ring;
+        return 0;
+    }
+    return -1;
+}
+
+void log_ring_release_thread(void) {
+    if (!tls_ring)
+        return;
+    // L'anneau reste alloué : le thread de vidage finira de le vider et un
+    // futur producteur pourra le réutiliser.
+    for (int i = 0; i < LOG_MAX_PRODUCERS; i++) {
+        if (atomic_load(&rings[i]) == tls_ring) {
+            atomic_store(&ring_in_use[i], false);
+            break;
+        }
+    }
+    tls_ring = NULL;
+}
+
+// Extraction des arguments selon le format (même parcours que format_record)
+static void capture_args(LogRecord *r, const char *fmt, va_list ap) {
+    r->nb_args = 0;
+    r->str_len = 0;
+    for (const char *p = fmt; (p = strchr(p, '%')); ) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        while (*p && strchr("-+ #0123456789.", *p))
+            p++;
+        int lng = 0;
+        if (*p == 'h') {
+            p++;
+            if (*p == 'h')
+                p++;
+        } else if (*p == 'l') {
+            lng = 1;
+            p++;
+            if (*p == 'l') {
+                lng = 2;
+                p++;
+            }
+        } else if (*p == 'z') {
+            lng = 3;
+            p++;
+        }
+        if (r->nb_args == LOG_MAX_ARGS)
+            return;
+        LogArg *a = &r->args[r->nb_args];
+        switch (*p) {
+            case 'd': case 'i':
+                a->i = lng == 0 ? va_arg(ap, int) : lng == 1 ? va_arg(ap, long)
+                     : lng == 2 ? va_arg(ap, long long) : (int64_t)va_arg(ap, size_t);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                a->u = lng == 0 ? va_arg(ap, unsigned) : lng == 1 ? va_arg(ap, unsigned long)
+                     : lng == 2 ? va_arg(ap, unsigned long long) : va_arg(ap, size_t);
+                break;
+            case 'c':
+                a->i = va_arg(ap, int);
+                break;
+            case 'p':
+                a->u = (uintptr_t)va_arg(ap, void *);
+                break;
+            case 'f': case 'g': case 'e': case 'F': case 'G': case 'E':
+                a->d = va_arg(ap, double);
+                break;
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                if (!s)
+                    s = "(null)";
+                size_t room = LOG_STR_MAX - r->str_len;
+                if (room > 0) {
+                    size_t n = strnlen(s, room - 1);
+                    memcpy(&r->str[r->str_len], s, n);
+                    r->str[r->str_len + n] = '\0';
+                    r->str_len += n + 1;
+                }
+                a->u = 0;
+                break;
+            }
+            default:
+                return;
+        }
+        r->nb_args++;
+        p++;
+    }
+}
+
+void log_msg(int category, int level, const char *fmt, ...) {
+    if (level > atomic_load_explicit(&log_level, memory_order_relaxed))
+        return;
+    LogRing *ring = tls_ring;
+    va_list ap;
+    if (!ring) {
+        va_start(ap, fmt);
+        vprintf(fmt, ap);
+        va_end(ap);
+        return;
+    }
+    uint64_t now = now_ns();
+    unsigned limit = atomic_load_explicit(&log_rate[category], memory_order_relaxed);
+    if (limit && level > LOG_LEVEL_ERROR) {
+        LogRateWindow *w = &ring->rate[category];
+        if (now - w->window_start >= 1000000000ULL) {
+            w->window_start = now;
+            w->count = 0;
+        }
+        if (w->count >= limit) {
+            atomic_fetch_add_explicit(&ring->suppressed[category], 1, memory_order_relaxed);
+            return;
+        }
+        w->count++;
+    }
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= LOG_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    LogRecord *r = &ring->rec[head & (LOG_RING_SIZE - 1)];
+    r->ts_ns = now;
+    r->fmt = fmt;
+    r->category = category;
+    r->level = level;
+    va_start(ap, fmt);
+    capture_args(r, fmt, ap);
+    va_end(ap);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Reconstruit le texte d'un enregistrement (exécuté par le thread de vidage)
+static void format_record(const LogRecord *r, char *out, size_t out_size) {
+    size_t len = 0;
+    int arg = 0;
+    size_t str_pos = 0;
+    const char *p = r->fmt;
+    out[0] = '\0';
+    while (*p && len + 1 < out_size) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            out[len] = '\0';
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            out[len] = '\0';
+            p += 2;
+            continue;
+        }
+        // Copie des drapeaux / largeur / précision, sans les modificateurs de longueur
+        char spec[32];
+        size_t sl = 0;
+        spec[sl++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && sl < sizeof(spec) - 4)
+            spec[sl++] = *p++;
+        while (*p == 'h' || *p == 'l' || *p == 'z')
+            p++;
+        char conv = *p;
+        if (!conv)
+            break;
+        p++;
+        if (arg >= r->nb_args) {
+            len += snprintf(out + len, out_size - len, "?");
+            if (len >= out_size)
+                len = out_size - 1;
+            continue;
+        }
+        const LogArg *a = &r->args[arg++];
+        int n = 0;
+        switch (conv) {
+            case 'd': case 'i':
+                spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = 'd'; spec[sl] = '\0';
+                n = snprintf(out + len, out_size - len, spec, (long long)a->i);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+                n = snprintf(out + len, out_size - len, spec, (unsigned long long)a->u);
+                break;
+            case 'c':
+                spec[sl++] = 'c'; spec[sl] = '\0';
+                n = snprintf(out + len, out_size - len, spec, (int)a->i);
+                break;
+            case 'p':
+                spec[sl++] = 'p'; spec[sl] = '\0';
+                n = snprintf(out + len, out_size - len, spec, (void *)(uintptr_t)a->u);
+                break;
+            case 'f': case 'g': case 'e': case 'F': case 'G': case 'E':
+                spec[sl++] = conv; spec[sl] = '\0';
+                n = snprintf(out + len, out_size - len, spec, a->d);
+                break;
+            case 's': {
+                const char *s = str_pos < r->str_len ? &r->str[str_pos] : "";
+                str_pos += strlen(s) + 1;
+                spec[sl++] = 's'; spec[sl] = '\0';
+                n = snprintf(out + len, out_size - len, spec, s);
+                break;
+            }
+            default:
+                break;
+        }
+        if (n > 0)
+            len += n;
+        if (len >= out_size)
+            len = out_size - 1;
+    }
+}
+
+// Vide tous les anneaux ; retourne le nombre d'enregistrements écrits
+static int drain_rings(void) {
+    int total = 0;
+    char line[512];
+    for (int i = 0; i < LOG_MAX_PRODUCERS; i++) {
+        LogRing *ring = atomic_load(&rings[i]);
+        if (!ring)
+            continue;
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while (tail != head) {
+            format_record(&ring->rec[tail & (LOG_RING_SIZE - 1)], line, sizeof(line));
+            fputs(line, stdout);
+            tail++;
+            total++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        uint64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        if (dropped != ring->reported_dropped) {
+            printf("log[%s]: %llu messages perdus (anneau plein)\n", ring->name,
+                   (unsigned long long)(dropped - ring->reported_dropped));
+            ring->reported_dropped = dropped;
+        }
+        for (int c = 0; c < LOG_CAT_COUNT; c++) {
+            uint64_t sup = atomic_load_explicit(&ring->suppressed[c], memory_order_relaxed);
+            if (sup != ring->reported_suppressed[c]) {
+                printf("log[%s]: %llu messages '%s' limités\n", ring->name,
+                       (unsigned long long)(sup - ring->reported_suppressed[c]), category_names[c]);
+                ring->reported_suppressed[c] = sup;
+            }
+        }
+    }
+    if (total)
+        fflush(stdout);
+    return total;
+}
+
+static void *drain_main(void *arg) {
+    (void)arg;
+    struct timespec period = { 0, LOG_DRAIN_PERIOD_NS };
+    while (!atomic_load(&drain_stop)) {
+        drain_rings();
+        void (*hook)(void) = atomic_load(&periodic_hook);
+        if (hook)
+            hook();
+        nanosleep(&period, NULL);
+    }
+    drain_rings();
+    return NULL;
+}
+
+void log_ring_set_periodic_hook(void (*hook)(void)) {
+    atomic_store(&periodic_hook, hook);
+}
+
+int log_ring_start(void) {
+    if (drain_running)
+        return 0;
+    atomic_store(&drain_stop, false);
+    int rv = pthread_create(&drain_thread, NULL, drain_main, NULL);
+    if (rv != 0) {
+        fprintf(stderr, "pthread_create(log): %s\n", strerror(rv));
+        return -1;
+    }
+    drain_running = true;
+    return 0;
+}
+
+void log_ring_stop(void) {
+    if (!drain_running)
+        return;
+    atomic_store(&drain_stop, true);
+    pthread_join(drain_thread, NULL);
+    drain_running = false;
+}
@@ -7,23 +7,149 @@
 #include "usb_raw.h"
 #include "usb_descriptors.h"
 #include "ep0.h"
+#include "usb_hid.h"
 #include "input_mapping.h"
+#include "runtime_mapping.h"
+#include "report_layout.h"
+#include "log_ring.h"
+#include "latency_stats.h"
+#include "output_sink.h"
+#include "control_socket.h"
+#include "hotplug.h"
+#include "rt_mode.h"
+#include "input_trace.h"
+#include <signal.h>
+#include <pthread.h>
 
 // Déclaration globale des périphériques utilisés par le mapping
 InputDevice *g_devices = NULL;
 int g_nb_joysticks = 0;
 
-// Variables globales pour les endpoints HID (utilisées par usb_hid.c et ep0.c)
-int ep_int_in0 = -1;
-int ep_int_in1 = -1;
+// Sans gadget USB (puits uinput ou capture) : pas d'hôte pour choisir une
+// configuration, les endpoints sont activés tout de suite et le démon
+// attend SIGINT/SIGTERM.
+static void run_without_gadget(OutputSink *sink) {
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        if (output_sink_enable_endpoint(sink, j, &usb_endpoints[j]) < 0) {
+            perror("enable_endpoint");
+            exit(EXIT_FAILURE);
+        }
+    }
+    output_sink_lifecycle(sink, SINK_EVENT_CONFIGURED);
+    if (hid_thread_start(sink, NULL) != 0)
+        exit(EXIT_FAILURE);
+    printf("Puits %s actif, Ctrl+C pour arrêter\n", sink->ops->name);
+    int sig;
+    sigwait(&stop_signals, &sig);
+    hid_thread_stop();
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s gadget|uinput|capture:FICHIER] [-r HZ] [-B US] [-E N] [-T N] [-P PRIO [-C CPU[,CPU]]] [-R FICHIER] [device] [driver]\n", prog);
+    fprintf(stderr, "  -r HZ  fréquence d'interrogation : 125, 250, 500, 1000 (défaut), 2000, 4000 ou 8000\n");
+    fprintf(stderr, "  -B US  attente active du thread HID pendant US microsecondes après chaque trame (0 : désactivée)\n");
+    fprintf(stderr, "  -E N   événements lus par manette à chaque passe, à tour de rôle (défaut %d, 0 : sans limite)\n",
+            HID_DEVICE_BUDGET_DEFAULT);
+    fprintf(stderr, "  -T N   N threads de lecture des périphériques et un thread d'agrégation (0 : thread HID unique)\n");
+    fprintf(stderr, "  -P PRIO  mode temps réel : threads HID et d'écriture en SCHED_FIFO PRIO, mémoire verrouillée\n");
+    fprintf(stderr, "  -C CPU[,CPU]  CPU du thread HID, puis des threads d'écriture (mode temps réel)\n");
+    fprintf(stderr, "  -R FICHIER  enregistre les événements evdev lus, rejouables par replay_trace\n");
+}
 
 int main(int argc, char **argv) {
     const char *device = "dummy_udc.0";
     const char *driver = "dummy_udc";
-    if (argc >= 2)
-        device = argv[1];
-    if (argc >= 3)
-        driver = argv[2];
+    const char *sink_spec = "gadget";
+    int poll_rate = USB_POLL_RATE_DEFAULT;
+    const char *rt_cpus = NULL;
+    unsigned busy_poll_us = 0;
+    const char *trace_path = NULL;
+    int nb_readers = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:B:E:T:P:C:R:")) != -1) {
+        switch (opt) {
+            case 's':
+                sink_spec = optarg;
+                break;
+            case 'r':
+                poll_rate = atoi(optarg);
+                break;
+            case 'B':
+                busy_poll_us = strtoul(optarg, NULL, 10);
+                if (hid_configure_busy_poll(busy_poll_us) < 0) {
+                    fprintf(stderr, "Fenêtre d'attente active invalide: %s us (100000 au plus)\n", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'E':
+                hid_configure_device_budget(strtoul(optarg, NULL, 10));
+                break;
+            case 'T':
+                nb_readers = atoi(optarg);
+                if (hid_configure_readers(nb_readers) < 0) {
+                    fprintf(stderr, "Nombre de lecteurs invalide: %s (%d au plus)\n", optarg, HID_MAX_READERS);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'P':
+                if (rt_mode_configure(atoi(optarg)) < 0) {
+                    fprintf(stderr, "Priorité SCHED_FIFO invalide: %s\n", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'C':
+                rt_cpus = optarg;
+                break;
+            case 'R':
+                trace_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (usb_configure_polling(USB_DEVICE_SPEED, poll_rate) < 0) {
+        fprintf(stderr, "Fréquence d'interrogation invalide: %d Hz\n", poll_rate);
+        usage(argv[0]);
+        return 1;
+    }
+    printf("Interrogation des endpoints: %d Hz (bInterval %d)\n", usb_poll_rate(), usb_endpoints[0].bInterval);
+    if (rt_cpus && (!rt_mode_enabled() || rt_mode_parse_cpus(rt_cpus) < 0)) {
+        fprintf(stderr, "Affinité invalide: %s (CPU[,CPU], avec -P)\n", rt_cpus);
+        usage(argv[0]);
+        return 1;
+    }
+    // En SCHED_FIFO, l'attente active prive de CPU les threads normaux du même
+    // coeur pendant toute la fenêtre, y compris ceux qui produisent les événements
+    if (busy_poll_us > 0 && rt_mode_enabled() && !rt_cpus)
+        fprintf(stderr, "Attention: attente active en temps réel sans -C, réserver un CPU au thread HID\n");
+    // La trace n'a qu'un producteur : le thread HID unique
+    if (trace_path && nb_readers > 0) {
+        fprintf(stderr, "-R et -T sont incompatibles\n");
+        usage(argv[0]);
+        return 1;
+    }
+    if (optind < argc)
+        device = argv[optind];
+    if (optind + 1 < argc)
+        driver = argv[optind + 1];
+    int use_gadget = strcmp(sink_spec, "gadget") == 0;
+    if (!use_gadget) {
+        // Bloqués avant la création des threads pour être reçus par sigwait
+        sigset_t stop_signals;
+        sigemptyset(&stop_signals);
+        sigaddset(&stop_signals, SIGINT);
+        sigaddset(&stop_signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    }
+    log_ring_configure_from_env();
     {
         char exe_path[PATH_MAX];
         ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path)-1);
@@ -36,26 +162,92 @@ int main(int argc, char **argv) {
         snprintf(g_mapping_file, sizeof(g_mapping_file), "%s/mapping/mapping.json", dir);
         printf("Chemin du mapping: %s\n", g_mapping_file);
     }
-    int fd = usb_raw_open();
-    usb_raw_init(fd, USB_SPEED_HIGH, driver, device);
-    usb_raw_run(fd);
+    int fd = -1;
+    if (use_gadget) {
+        fd = usb_raw_open();
+        usb_raw_init(fd, USB_DEVICE_SPEED, driver, device);
+        usb_raw_run(fd);
+    }
+    OutputSink *sink = output_sink_create(sink_spec, fd);
+    if (!sink) {
+        usage(argv[0]);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
     InputDevice *devices = NULL;
     int nb_joysticks = 0;
     init_physical_devices_wrapper(&devices, &nb_joysticks);
     printf("Total axes trouvés: %d\n", global_axis_index);
-    if (nb_joysticks == 0) {
-        printf("Aucun joystick/gamepad trouvé.\n");
-        free(devices);
-        close(fd);
-        return 1;
+    // Formats de rapport, descripteurs et endpoints générés avant l'énumération
+    // par l'hôte (ep0_loop) ; un joystick compact ne porte que les contrôles mappés
+    ReportLayout reports[MAX_VIRTUAL_JOYSTICKS];
+    for (int j = 0; j < g_nb_virtual_joysticks; j++) {
+        if (g_virtual_joysticks[j].compact)
+            report_layout_compile(&reports[j], j, &g_virtual_joysticks[j], devices, nb_joysticks);
+        else
+            report_layout_full(&reports[j], j, &g_virtual_joysticks[j]);
     }
+    usb_configure_joysticks(g_virtual_joysticks, reports, g_nb_virtual_joysticks);
+    for (int j = 0; j < usb_nb_joysticks; j++)
+        printf("Joystick virtuel %d: %d axes (%d bits), %d boutons, rapport de %d octets%s\n",
+               j, usb_reports[j].nb_axes, usb_reports[j].axis_bits, usb_reports[j].nb_buttons,
+               usb_reports[j].size, usb_joysticks[j].compact ? " (compact)" : "");
+    if (nb_joysticks == 0)
+        printf("Aucun joystick/gamepad trouvé, en attente de branchement.\n");
     g_devices = devices;
     g_nb_joysticks = nb_joysticks;
-    ep0_loop(fd);
-    for (int i = 0; i < nb_joysticks; i++) {
-        close(devices[i].fd);
+    RuntimeMapping *rt = runtime_mapping_build(devices, nb_joysticks);
+    if (!rt) {
+        free_input_devices(devices, nb_joysticks);
+        output_sink_destroy(sink);
+        if (fd >= 0)
+            close(fd);
+        return 1;
+    }
+    // SIGUSR1 : impression des histogrammes de latence par le thread de log
+    latency_stats_install_signal(SIGUSR1);
+    log_ring_set_periodic_hook(latency_stats_poll_dump);
+    // Formats de rapport fixés : l'en-tête de la trace peut être écrit
+    if (trace_path) {
+        if (input_trace_start(trace_path) < 0) {
+            runtime_mapping_free(rt);
+            free_input_devices(devices, nb_joysticks);
+            output_sink_destroy(sink);
+            if (fd >= 0)
+                close(fd);
+            return 1;
+        }
+        printf("Enregistrement des événements dans %s\n", trace_path);
     }
-    free(devices);
-    close(fd);
+    // Fin du démarrage : au-delà, les threads HID et d'écriture n'allouent plus
+    if (rt_mode_enabled()) {
+        rt_mode_lock_memory();
+        printf("Mode temps réel actif\n");
+    }
+    // Publication initiale ; les rechargements passent par la socket de contrôle
+    hid_mapping_swap(rt);
+    log_ring_start();
+    if (control_socket_start(NULL) < 0)
+        printf("Socket de contrôle indisponible : rechargement à chaud désactivé\n");
+    if (hotplug_start() < 0)
+        printf("Surveillance de %s indisponible : pas de hotplug\n", HOTPLUG_INPUT_DIR);
+    if (use_gadget) {
+        ep0_loop(fd, sink);
+        hid_thread_stop();
+    } else {
+        run_without_gadget(sink);
+    }
+    input_trace_stop();
+    hotplug_stop();
+    control_socket_stop();
+    output_sink_lifecycle(sink, SINK_EVENT_SHUTDOWN);
+    log_ring_stop();
+    output_sink_destroy(sink);
+    // Un rechargement a pu remplacer le mapping et la table des périphériques
+    runtime_mapping_free(hid_mapping_swap(NULL));
+    free_input_devices(g_devices, g_nb_joysticks);
+    if (fd >= 0)
+        close(fd);
     return 0;
 }
@@ -0,0 +1,248 @@
+#include "mapping_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+uint64_t mapping_cache_hash(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void mapping_cache_reset_device(InputDevice *dev) {
+    memset(dev, 0, sizeof(InputDevice));
+    dev->fd = -1;
+    for (int j = 0; j < ABS_CNT; j++) {
+        dev->axis_mapping[j] = -1;
+        dev->axis_virtual_axis[j] = -1;
+    }
+    for (int j = 0; j <= KEY_MAX; j++)
+        dev->button_mapping[j] = -1;
+}
+
+static bool axis_is_default(const InputDevice *dev, int code) {
+    return dev->axis_mapping[code] == -1 && dev->axis_dead_zone[code] == 0 && dev->axis_hysteresis[code] == 0 &&
+           dev->axis_quantization[code] == 0 && dev->axis_curve[code].nb_points == 0 && dev->axis_invert[code] == 0 &&
+           dev->axis_virtual_joystick[code] == 0 && dev->axis_virtual_axis[code] == -1;
+}
+
+static bool button_is_default(const InputDevice *dev, int code) {
+    return dev->button_mapping[code] == -1 && dev->button_virtual_joystick[code] == 0;
+}
+
+static void cache_path(const char *json_file, char *path, size_t len) {
+    snprintf(path, len, "%s%s", json_file, MAPPING_CACHE_SUFFIX);
+}
+
+// Vérifie l'en-tête et la cohérence des tailles avant toute lecture
+static bool cache_valid(const uint8_t *base, size_t len, uint64_t hash, size_t size) {
+    if (len < sizeof(MappingCacheHeader))
+        return false;
+    const MappingCacheHeader *hdr = (const MappingCacheHeader *)base;
+    if (hdr->magic != MAPPING_CACHE_MAGIC || hdr->version != MAPPING_CACHE_VERSION ||
+        hdr->total_size != len || hdr->source_hash != hash || hdr->source_size != size ||
+        hdr->nb_layouts > MAX_VIRTUAL_JOYSTICKS)
+        return false;
+    size_t off = sizeof(MappingCacheHeader);
+    for (uint32_t i = 0; i < hdr->nb_devices; i++) {
+        if (len - off < sizeof(MappingCacheDevice))
+            return false;
+        const MappingCacheDevice *cd = (const MappingCacheDevice *)(base + off);
+        if (cd->nb_axes > ABS_CNT || cd->nb_buttons > KEY_MAX + 1)
+            return false;
+        off += sizeof(MappingCacheDevice);
+        size_t body = cd->nb_axes * sizeof(MappingCacheAxis) + cd->nb_buttons * sizeof(MappingCacheButton);
+        if (len - off < body)
+            return false;
+        off += body;
+    }
+    return off == len;
+}
+
+bool mapping_cache_load(const char *json_file, uint64_t hash, size_t size,
+                        InputDevice **devices, int *nb_devices, int *global_axis, int *global_button,
+                        VirtualJoystickLayout *layouts, int *nb_layouts) {
+    char path[PATH_MAX];
+    cache_path(json_file, path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(MappingCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t len = st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    const uint8_t *base = map;
+    if (!cache_valid(base, len, hash, size)) {
+        munmap(map, len);
+        return false;
+    }
+    const MappingCacheHeader *hdr = (const MappingCacheHeader *)base;
+    InputDevice *out = malloc((hdr->nb_devices ? hdr->nb_devices : 1) * sizeof(InputDevice));
+    if (!out) {
+        munmap(map, len);
+        return false;
+    }
+    size_t off = sizeof(MappingCacheHeader);
+    for (uint32_t i = 0; i < hdr->nb_devices; i++) {
+        const MappingCacheDevice *cd = (const MappingCacheDevice *)(base + off);
+        InputDevice *idev = &out[i];
+        mapping_cache_reset_device(idev);
+        memcpy(idev->path, cd->path, sizeof(idev->path) - 1);
+        memcpy(idev->name, cd->name, sizeof(idev->name) - 1);
+        idev->id.bustype = cd->bustype;
+        idev->id.vendor = cd->vendor;
+        idev->id.product = cd->product;
+        idev->id.version = cd->version;
+        idev->num_axes = cd->num_axes;
+        idev->num_buttons = cd->num_buttons;
+        off += sizeof(MappingCacheDevice);
+        const MappingCacheAxis *axes = (const MappingCacheAxis *)(base + off);
+        for (uint32_t a = 0; a < cd->nb_axes; a++) {
+            int code = axes[a].code;
+            if (code < 0 || code >= ABS_CNT)
+                continue;
+            idev->axis_mapping[code] = axes[a].mapped;
+            idev->axis_dead_zone[code] = axes[a].dead_zone;
+            idev->axis_hysteresis[code] = axes[a].hysteresis;
+            idev->axis_quantization[code] = axes[a].quantization;
+            idev->axis_invert[code] = axes[a].invert;
+            idev->axis_virtual_joystick[code] = axes[a].virtual_joystick;
+            idev->axis_virtual_axis[code] = axes[a].virtual_axis;
+            if (axis_curve_valid(&axes[a].curve))
+                idev->axis_curve[code] = axes[a].curve;
+        }
+        off += cd->nb_axes * sizeof(MappingCacheAxis);
+        const MappingCacheButton *buttons = (const MappingCacheButton *)(base + off);
+        for (uint32_t b = 0; b < cd->nb_buttons; b++) {
+            int code = buttons[b].code;
+            if (code < 0 || code > KEY_MAX)
+                continue;
+            idev->button_mapping[code] = buttons[b].mapped;
+            idev->button_virtual_joystick[code] = buttons[b].virtual_joystick;
+        }
+        off += cd->nb_buttons * sizeof(MappingCacheButton);
+    }
+    *devices = out;
+    *nb_devices = hdr->nb_devices;
+    *global_axis = hdr->global_axis;
+    *global_button = hdr->global_button;
+    for (uint32_t j = 0; j < hdr->nb_layouts; j++) {
+        layouts[j].nb_axes = hdr->layouts[j].nb_axes;
+        layouts[j].nb_buttons = hdr->layouts[j].nb_buttons;
+        layouts[j].compact = hdr->layouts[j].compact;
+        layouts[j].axis_bits = hdr->layouts[j].axis_bits;
+    }
+    *nb_layouts = hdr->nb_layouts;
+    munmap(map, len);
+    return true;
+}
+
+void mapping_cache_store(const char *json_file, uint64_t hash, size_t size,
+                         const InputDevice *devices, int nb_devices, int global_axis, int global_button,
+                         const VirtualJoystickLayout *layouts, int nb_layouts) {
+    size_t len = sizeof(MappingCacheHeader);
+    for (int i = 0; i < nb_devices; i++) {
+        len += sizeof(MappingCacheDevice);
+        for (int code = 0; code < ABS_CNT; code++)
+            if (!axis_is_default(&devices[i], code))
+                len += sizeof(MappingCacheAxis);
+        for (int code = 0; code <= KEY_MAX; code++)
+            if (!button_is_default(&devices[i], code))
+                len += sizeof(MappingCacheButton);
+    }
+    uint8_t *buf = calloc(1, len);
+    if (!buf)
+        return;
+    MappingCacheHeader *hdr = (MappingCacheHeader *)buf;
+    hdr->magic = MAPPING_CACHE_MAGIC;
+    hdr->version = MAPPING_CACHE_VERSION;
+    hdr->source_hash = hash;
+    hdr->source_size = size;
+    hdr->total_size = len;
+    hdr->nb_devices = nb_devices;
+    hdr->global_axis = global_axis;
+    hdr->global_button = global_button;
+    hdr->nb_layouts = nb_layouts;
+    for (int j = 0; j < nb_layouts; j++) {
+        hdr->layouts[j].nb_axes = layouts[j].nb_axes;
+        hdr->layouts[j].nb_buttons = layouts[j].nb_buttons;
+        hdr->layouts[j].compact = layouts[j].compact;
+        hdr->layouts[j].axis_bits = layouts[j].axis_bits;
+    }
+    size_t off = sizeof(MappingCacheHeader);
+    for (int i = 0; i < nb_devices; i++) {
+        const InputDevice *idev = &devices[i];
+        MappingCacheDevice *cd = (MappingCacheDevice *)(buf + off);
+        memcpy(cd->path, idev->path, sizeof(cd->path) - 1);
+        memcpy(cd->name, idev->name, sizeof(cd->name) - 1);
+        cd->bustype = idev->id.bustype;
+        cd->vendor = idev->id.vendor;
+        cd->product = idev->id.product;
+        cd->version = idev->id.version;
+        cd->num_axes = idev->num_axes;
+        cd->num_buttons = idev->num_buttons;
+        off += sizeof(MappingCacheDevice);
+        MappingCacheAxis *axes = (MappingCacheAxis *)(buf + off);
+        for (int code = 0; code < ABS_CNT; code++) {
+            if (axis_is_default(idev, code))
+                continue;
+            MappingCacheAxis *ca = &axes[cd->nb_axes++];
+            ca->code = code;
+            ca->mapped = idev->axis_mapping[code];
+            ca->dead_zone = idev->axis_dead_zone[code];
+            ca->hysteresis = idev->axis_hysteresis[code];
+            ca->quantization = idev->axis_quantization[code];
+            ca->invert = idev->axis_invert[code];
+            ca->virtual_joystick = idev->axis_virtual_joystick[code];
+            ca->virtual_axis = idev->axis_virtual_axis[code];
+            ca->curve = idev->axis_curve[code];
+        }
+        off += cd->nb_axes * sizeof(MappingCacheAxis);
+        MappingCacheButton *buttons = (MappingCacheButton *)(buf + off);
+        for (int code = 0; code <= KEY_MAX; code++) {
+            if (button_is_default(idev, code))
+                continue;
+            MappingCacheButton *cb = &buttons[cd->nb_buttons++];
+            cb->code = code;
+            cb->mapped = idev->button_mapping[code];
+            cb->virtual_joystick = idev->button_virtual_joystick[code];
+        }
+        off += cd->nb_buttons * sizeof(MappingCacheButton);
+    }
+    // Nom temporaire unique : le démarrage, le hotplug et la socket de contrôle
+    // peuvent relire le mapping en même temps
+    char path[PATH_MAX], tmp[PATH_MAX + 8];
+    cache_path(json_file, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        free(buf);
+        return;
+    }
+    fchmod(fd, 0644);
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, buf + done, len - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    if (done != len || rename(tmp, path) < 0)
+        unlink(tmp);
+    free(buf);
+}
@@ -0,0 +1,20 @@
+#include "output_sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+OutputSink *output_sink_create(const char *spec, int gadget_fd) {
+    if (!spec || strcmp(spec, "gadget") == 0)
+        return sink_raw_gadget_create(gadget_fd);
+    if (strcmp(spec, "uinput") == 0)
+        return sink_uinput_create();
+    if (strncmp(spec, "capture:", 8) == 0 && spec[8] != '\0')
+        return sink_capture_create(spec + 8);
+    fprintf(stderr, "Puits de sortie inconnu: %s (gadget, uinput, capture:FICHIER)\n", spec);
+    return NULL;
+}
+
+void output_sink_destroy(OutputSink *sink) {
+    if (sink)
+        sink->ops->destroy(sink);
+}
@@ -0,0 +1,257 @@
+#include "report_layout.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Usages Generic Desktop des axes : X, Y, Z, Rx, Ry, Rz, Slider, Dial, puis
+// des Slider supplémentaires (hid-input les place sur les codes ABS_* libres)
+static uint8_t axis_usage(int slot) {
+    return slot < 8 ? 0x30 + slot : 0x36;
+}
+
+// Ecrit les bits de poids faible de value à partir du bit pos (ordre HID : petit-boutiste)
+static inline void put_bits(uint8_t *buf, int pos, uint32_t value, int bits) {
+    while (bits > 0) {
+        int shift = pos & 7;
+        int n = 8 - shift < bits ? 8 - shift : bits;
+        buf[pos >> 3] |= (value & ((1u << n) - 1)) << shift;
+        value >>= n;
+        pos += n;
+        bits -= n;
+    }
+}
+
+static inline uint32_t get_bits(const uint8_t *buf, int pos, int bits) {
+    uint32_t value = 0;
+    int done = 0;
+    while (done < bits) {
+        int shift = pos & 7;
+        int n = 8 - shift < bits - done ? 8 - shift : bits - done;
+        value |= (uint32_t)((buf[pos >> 3] >> shift) & ((1u << n) - 1)) << done;
+        pos += n;
+        done += n;
+    }
+    return value;
+}
+
+// Boutons du rapport à partir du bit pos, un par bouton virtuel présent
+static inline void pack_buttons(const ReportLayout *rl, uint8_t *report, int pos, const uint8_t *buttons) {
+    for (int i = 0; i < rl->nb_buttons; i++) {
+        int slot = rl->button_slots[i];
+        if (buttons[slot >> 3] & (1 << (slot & 7)))
+            report[(pos + i) >> 3] |= 1 << ((pos + i) & 7);
+    }
+}
+
+// Format complet en 16 bits : axes et boutons virtuels copiés tels quels
+static void pack_aligned(const ReportLayout *rl, uint8_t *report, const int16_t *axes, const uint8_t *buttons) {
+    report[0] = rl->report_id;
+    memcpy(&report[1], axes, rl->nb_axes * sizeof(int16_t));
+    memcpy(&report[1 + rl->nb_axes * sizeof(int16_t)], buttons, (rl->nb_buttons + 7) / 8);
+}
+
+// Axes 16 bits choisis, boutons épars
+static void pack_axes16(const ReportLayout *rl, uint8_t *report, const int16_t *axes, const uint8_t *buttons) {
+    memset(report, 0, rl->size);
+    report[0] = rl->report_id;
+    for (int i = 0; i < rl->nb_axes; i++)
+        memcpy(&report[1 + 2 * i], &axes[rl->axis_slots[i]], sizeof(int16_t));
+    pack_buttons(rl, report, 8 + 16 * rl->nb_axes, buttons);
+}
+
+// Cas général : axes réduits à axis_bits, boutons épars
+static void pack_bits(const ReportLayout *rl, uint8_t *report, const int16_t *axes, const uint8_t *buttons) {
+    memset(report, 0, rl->size);
+    report[0] = rl->report_id;
+    int shift = 16 - rl->axis_bits;
+    int pos = 8;
+    for (int i = 0; i < rl->nb_axes; i++, pos += rl->axis_bits)
+        put_bits(report, pos, (uint32_t)(axes[rl->axis_slots[i]] >> shift), rl->axis_bits);
+    pack_buttons(rl, report, pos, buttons);
+}
+
+// Index inverses, taille et choix de la routine d'assemblage
+static void finish_layout(ReportLayout *rl) {
+    memset(rl->axis_index, -1, sizeof(rl->axis_index));
+    memset(rl->button_index, -1, sizeof(rl->button_index));
+    bool axes_identity = true, buttons_identity = true;
+    for (int i = 0; i < rl->nb_axes; i++) {
+        rl->axis_index[rl->axis_slots[i]] = i;
+        axes_identity &= rl->axis_slots[i] == i;
+    }
+    for (int i = 0; i < rl->nb_buttons; i++) {
+        rl->button_index[rl->button_slots[i]] = i;
+        buttons_identity &= rl->button_slots[i] == i;
+    }
+    rl->size = 1 + (rl->nb_axes * rl->axis_bits + rl->nb_buttons + 7) / 8;
+    if (rl->axis_bits == 16 && axes_identity && buttons_identity)
+        rl->pack = pack_aligned;
+    else if (rl->axis_bits == 16)
+        rl->pack = pack_axes16;
+    else
+        rl->pack = pack_bits;
+}
+
+void report_layout_full(ReportLayout *rl, int joy, const VirtualJoystickLayout *vl) {
+    memset(rl, 0, sizeof(*rl));
+    rl->report_id = joy + 1;
+    rl->axis_bits = vl->axis_bits ? vl->axis_bits : 16;
+    rl->nb_axes = vl->nb_axes;
+    for (int i = 0; i < vl->nb_axes; i++)
+        rl->axis_slots[i] = i;
+    rl->nb_buttons = vl->nb_buttons;
+    for (int i = 0; i < vl->nb_buttons; i++)
+        rl->button_slots[i] = i;
+    finish_layout(rl);
+}
+
+int report_layout_custom(ReportLayout *rl, int joy, int axis_bits, const uint8_t *axis_slots, int nb_axes,
+                         const uint8_t *button_slots, int nb_buttons) {
+    if ((axis_bits != 8 && axis_bits != 10 && axis_bits != 12 && axis_bits != 16) ||
+        nb_axes < 0 || nb_axes > HID_MAX_AXES || nb_buttons < 0 || nb_buttons > MAX_BUTTONS)
+        return -1;
+    memset(rl, 0, sizeof(*rl));
+    rl->report_id = joy + 1;
+    rl->axis_bits = axis_bits;
+    for (int i = 0; i < nb_axes; i++) {
+        if (axis_slots[i] >= HID_MAX_AXES)
+            return -1;
+        rl->axis_slots[rl->nb_axes++] = axis_slots[i];
+    }
+    for (int i = 0; i < nb_buttons; i++) {
+        if (button_slots[i] >= MAX_BUTTONS)
+            return -1;
+        rl->button_slots[rl->nb_buttons++] = button_slots[i];
+    }
+    finish_layout(rl);
+    return 0;
+}
+
+// Largeur suffisante pour la plage d'un axe source, parmi 8, 10, 12 et 16 bits
+static int axis_bits_for(const struct input_absinfo *info) {
+    uint64_t range = (uint64_t)((int64_t)info->maximum - info->minimum);
+    int bits = 0;
+    while (bits < 16 && (range >> bits))
+        bits++;
+    if (bits <= 8)
+        return 8;
+    if (bits <= 10)
+        return 10;
+    if (bits <= 12)
+        return 12;
+    return 16;
+}
+
+void report_layout_compile(ReportLayout *rl, int joy, const VirtualJoystickLayout *vl,
+                           const InputDevice *devices, int nb_devices) {
+    bool used_axes[HID_MAX_AXES] = { false };
+    bool used_buttons[MAX_BUTTONS] = { false };
+    int bits = 8;
+    for (int i = 0; i < nb_devices; i++) {
+        const InputDevice *dev = &devices[i];
+        for (int code = 0; code < ABS_CNT; code++) {
+            int slot = dev->axis_virtual_axis[code];
+            if (!dev->has_abs[code] || dev->axis_virtual_joystick[code] != joy || slot < 0 || slot >= vl->nb_axes)
+                continue;
+            used_axes[slot] = true;
+            int b = axis_bits_for(&dev->absinfo[code]);
+            if (b > bits)
+                bits = b;
+        }
+        for (int code = 0; code <= KEY_MAX; code++) {
+            int slot = dev->button_mapping[code];
+            if (!dev->has_button[code] || dev->button_virtual_joystick[code] != joy || slot < 0 || slot >= vl->nb_buttons)
+                continue;
+            used_buttons[slot] = true;
+        }
+    }
+    memset(rl, 0, sizeof(*rl));
+    rl->report_id = joy + 1;
+    rl->axis_bits = vl->axis_bits ? vl->axis_bits : bits;
+    for (int i = 0; i < vl->nb_axes; i++) {
+        if (used_axes[i])
+            rl->axis_slots[rl->nb_axes++] = i;
+    }
+    for (int i = 0; i < vl->nb_buttons; i++) {
+        if (used_buttons[i])
+            rl->button_slots[rl->nb_buttons++] = i;
+    }
+    // Un rapport sans aucun contrôle ne serait pas exploitable par l'hôte
+    if (rl->nb_axes == 0 && rl->nb_buttons == 0) {
+        if (vl->nb_axes > 0)
+            rl->nb_axes = 1;
+        else
+            rl->nb_buttons = 1;
+    }
+    finish_layout(rl);
+}
+
+int report_layout_descriptor(const ReportLayout *rl, uint8_t *desc, int len) {
+    uint8_t d[HID_MAX_REPORT_DESC_SIZE];
+    int n = 0;
+    d[n++] = 0x05; d[n++] = 0x01;              // Usage Page (Generic Desktop)
+    d[n++] = 0x09; d[n++] = 0x04;              // Usage (Joystick)
+    d[n++] = 0xA1; d[n++] = 0x01;              // Collection (Application)
+    d[n++] = 0x85; d[n++] = rl->report_id;     // Report ID
+    if (rl->nb_axes > 0) {
+        int16_t lmin = -(1 << (rl->axis_bits - 1));
+        int16_t lmax = (1 << (rl->axis_bits - 1)) - 1;
+        d[n++] = 0x16; d[n++] = lmin & 0xFF; d[n++] = (lmin >> 8) & 0xFF;   // Logical Minimum
+        d[n++] = 0x26; d[n++] = lmax & 0xFF; d[n++] = (lmax >> 8) & 0xFF;   // Logical Maximum
+        d[n++] = 0x75; d[n++] = rl->axis_bits;                              // Report Size
+        d[n++] = 0x95; d[n++] = rl->nb_axes;                                // Report Count (axes)
+        for (int i = 0; i < rl->nb_axes; i++) {
+            d[n++] = 0x09; d[n++] = axis_usage(rl->axis_slots[i]);          // Usage (axe)
+        }
+        d[n++] = 0x81; d[n++] = 0x02;                                       // Input (Data,Var,Abs) [Axes]
+    }
+    if (rl->nb_buttons > 0) {
+        d[n++] = 0x05; d[n++] = 0x09;                  // Usage Page (Button)
+        // Une plage d'usages par suite de boutons virtuels consécutifs
+        for (int i = 0; i < rl->nb_buttons; ) {
+            int first = i;
+            while (i + 1 < rl->nb_buttons && rl->button_slots[i + 1] == rl->button_slots[i] + 1)
+                i++;
+            i++;
+            d[n++] = 0x19; d[n++] = rl->button_slots[first] + 1;    // Usage Minimum
+            d[n++] = 0x29; d[n++] = rl->button_slots[i - 1] + 1;    // Usage Maximum
+            if (first == 0) {
+                d[n++] = 0x15; d[n++] = 0x00;                       // Logical Minimum (0)
+                d[n++] = 0x25; d[n++] = 0x01;                       // Logical Maximum (1)
+                d[n++] = 0x75; d[n++] = 0x01;                       // Report Size (1)
+            }
+            d[n++] = 0x95; d[n++] = i - first;                      // Report Count
+            d[n++] = 0x81; d[n++] = 0x02;                           // Input (Data,Var,Abs) [Boutons]
+        }
+    }
+    int pad = (8 - (rl->nb_axes * rl->axis_bits + rl->nb_buttons) % 8) % 8;
+    if (pad) {
+        d[n++] = 0x75; d[n++] = 0x01;                  // Report Size (1)
+        d[n++] = 0x95; d[n++] = pad;                   // Report Count (bourrage)
+        d[n++] = 0x81; d[n++] = 0x03;                  // Input (Const,Var,Abs)
+    }
+    d[n++] = 0xC0;                             // End Collection
+    assert(n <= (int)sizeof(d));
+    if (n > len)
+        return -1;
+    memcpy(desc, d, n);
+    return n;
+}
+
+void report_layout_unpack(const ReportLayout *rl, const uint8_t *report, int16_t *axes, uint8_t *buttons) {
+    memset(axes, 0, HID_MAX_AXES * sizeof(int16_t));
+    memset(buttons, 0, MAX_BUTTONS / 8);
+    int shift = 16 - rl->axis_bits;
+    int pos = 8;
+    for (int i = 0; i < rl->nb_axes; i++, pos += rl->axis_bits) {
+        uint32_t raw = get_bits(report, pos, rl->axis_bits);
+        // Extension de signe puis retour sur 16 bits
+        int32_t value = (int32_t)(raw << (32 - rl->axis_bits)) >> (32 - rl->axis_bits);
+        axes[rl->axis_slots[i]] = (int16_t)(value * (1 << shift));
+    }
+    for (int i = 0; i < rl->nb_buttons; i++, pos++) {
+        int slot = rl->button_slots[i];
+        if (report[pos >> 3] & (1 << (pos & 7)))
+            buttons[slot >> 3] |= 1 << (slot & 7);
+    }
+}
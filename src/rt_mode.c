@@ -0,0 +1,130 @@
+#define _GNU_SOURCE
+#include "rt_mode.h"
+#include "log_ring.h"
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Réserve de tas préchargée : couvre les tables reconstruites à chaque
+// changement de mapping sans nouvelle faute de page
+#define RT_HEAP_RESERVE (8 * 1024 * 1024)
+// Pile touchée au démarrage de chaque thread temps réel
+#define RT_STACK_PREFAULT (64 * 1024)
+
+static bool rt_enabled = false;
+static int rt_priority = 0;
+static int rt_cpus[RT_ROLE_COUNT] = { RT_MODE_NO_CPU, RT_MODE_NO_CPU, RT_MODE_NO_CPU };
+static atomic_bool rt_warned = false;
+static __thread bool tls_pipeline = false;
+
+static const char *role_names[RT_ROLE_COUNT] = { "hid", "writer", "reader" };
+
+int rt_mode_configure(int priority) {
+    if (priority < sched_get_priority_min(SCHED_FIFO) || priority > sched_get_priority_max(SCHED_FIFO))
+        return -1;
+    rt_priority = priority;
+    rt_enabled = true;
+    return 0;
+}
+
+int rt_mode_parse_cpus(const char *spec) {
+    long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+    // Les lecteurs ne sont pas épinglés : ils doivent pouvoir s'étaler sur les coeurs
+    int cpus[RT_ROLE_READER];
+    int n = 0;
+    const char *p = spec;
+    for (;;) {
+        char *end;
+        long cpu = strtol(p, &end, 10);
+        if (n == RT_ROLE_READER || end == p || cpu < 0 || cpu >= ncpu || cpu >= CPU_SETSIZE)
+            return -1;
+        cpus[n++] = (int)cpu;
+        if (*end == '\0')
+            break;
+        if (*end != ',')
+            return -1;
+        p = end + 1;
+    }
+    rt_cpus[RT_ROLE_HID] = cpus[0];
+    rt_cpus[RT_ROLE_WRITER] = n > 1 ? cpus[1] : cpus[0];
+    return 0;
+}
+
+bool rt_mode_enabled(void) {
+    return rt_enabled;
+}
+
+bool rt_mode_is_pipeline_thread(void) {
+    return tls_pipeline;
+}
+
+void rt_mode_lock_memory(void) {
+    if (!rt_enabled)
+        return;
+    // Pas de restitution au système ni de mmap par allocation : une mémoire
+    // libérée reste dans le tas, déjà verrouillée
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    char *reserve = malloc(RT_HEAP_RESERVE);
+    if (reserve) {
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t off = 0; off < RT_HEAP_RESERVE; off += page)
+            reserve[off] = 0;
+        free(reserve);
+    }
+    int flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+    // Les piles des threads (8 Mo réservés chacune) ne sont verrouillées
+    // qu'au fil de leur utilisation
+    flags |= MCL_ONFAULT;
+#endif
+    if (mlockall(flags) < 0) {
+#ifdef MCL_ONFAULT
+        if (errno == EINVAL && mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+            return;
+#endif
+        perror("mlockall (mode temps réel)");
+    }
+}
+
+// Touche la pile pour que ses pages soient présentes avant la boucle
+static void __attribute__((noinline)) prefault_stack(void) {
+    volatile char stack[RT_STACK_PREFAULT];
+    memset((char *)stack, 0, sizeof(stack));
+}
+
+static void warn_once(const char *what, int err) {
+    if (atomic_exchange(&rt_warned, true))
+        return;
+    log_msg(LOG_CAT_GENERAL, LOG_LEVEL_ERROR, "Mode temps réel: %s impossible (%s), ordonnancement normal\n",
+            what, strerror(err));
+}
+
+void rt_mode_enter_thread(RtRole role) {
+    tls_pipeline = true;
+    if (!rt_enabled)
+        return;
+    int cpu = rt_cpus[role];
+    if (cpu != RT_MODE_NO_CPU) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int rv = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rv != 0)
+            warn_once("pthread_setaffinity_np", rv);
+    }
+    struct sched_param param = { .sched_priority = rt_priority };
+    int rv = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rv != 0)
+        warn_once("SCHED_FIFO", rv);
+    prefault_stack();
+    log_msg(LOG_CAT_GENERAL, LOG_LEVEL_DEBUG, "Thread %s: SCHED_FIFO %d, CPU %d\n",
+            role_names[role], rt_priority, cpu);
+}
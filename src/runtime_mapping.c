@@ -0,0 +1,114 @@
+#include "runtime_mapping.h"
+#include "usb_descriptors.h"    // Disposition des joysticks virtuels
+#include "log_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RuntimeMapping *runtime_mapping_build(InputDevice *devices, int nb_devices) {
+    // Premier passage : dimensionnement du bloc
+    size_t total_axes = 0, total_buttons = 0;
+    for (int i = 0; i < nb_devices; i++) {
+        for (int code = 0; code < ABS_CNT; code++)
+            if (devices[i].has_abs[code])
+                total_axes++;
+        for (int code = 0; code <= KEY_MAX; code++)
+            if (devices[i].has_button[code])
+                total_buttons++;
+    }
+    size_t size = sizeof(RuntimeMapping)
+                + nb_devices * sizeof(RtDevice)
+                + total_axes * sizeof(RtAxis)
+                + total_buttons * sizeof(RtButton);
+    char *block = calloc(1, size);
+    if (!block) {
+        perror("malloc runtime mapping");
+        return NULL;
+    }
+    RuntimeMapping *rt = (RuntimeMapping *)block;
+    rt->nb_devices = nb_devices;
+    rt->devices = (RtDevice *)(block + sizeof(RuntimeMapping));
+    RtAxis *axes = (RtAxis *)(rt->devices + nb_devices);
+    RtButton *buttons = (RtButton *)(axes + total_axes);
+
+    // Contrôles valides pour la disposition mais absents d'un rapport compact
+    int outside_report = 0;
+    // Tables d'axes : seules celles des axes nouveaux ou modifiés sont calculées
+    uint64_t built_before, reused_before;
+    axis_transform_table_counts(&built_before, &reused_before);
+    // Second passage : remplissage (les codes sont parcourus dans l'ordre croissant)
+    for (int i = 0; i < nb_devices; i++) {
+        InputDevice *idev = &devices[i];
+        RtDevice *rdev = &rt->devices[i];
+        rdev->fd = idev->fd;
+        rdev->uid = idev->uid;
+        rdev->cfg = idev;
+        rdev->axes = axes;
+        rdev->buttons = buttons;
+        memset(rdev->abs_index, -1, sizeof(rdev->abs_index));
+        for (int code = 0; code < ABS_CNT; code++) {
+            if (!idev->has_abs[code])
+                continue;
+            RtAxis *ax = &rdev->axes[rdev->nb_axes];
+            ax->code = code;
+            int joy = idev->axis_virtual_joystick[code];
+            int slot = idev->axis_virtual_axis[code];
+            if (joy >= 0 && joy < usb_nb_joysticks && slot >= 0 && slot < HID_MAX_AXES &&
+                usb_reports[joy].axis_index[slot] >= 0) {
+                ax->joy = joy;
+                ax->slot = slot;
+            } else {
+                ax->joy = -1;
+                if (joy >= 0 && joy < usb_nb_joysticks && slot >= 0 && slot < usb_joysticks[joy].nb_axes)
+                    outside_report++;
+            }
+            ax->hysteresis = idev->axis_hysteresis[code];
+            if (!axis_transform_compile(&ax->xform, &idev->absinfo[code], idev->axis_invert[code],
+                                        idev->axis_dead_zone[code], idev->axis_quantization[code],
+                                        &idev->axis_curve[code])) {
+                perror("malloc axis transform");
+                rt->nb_devices = i + 1;
+                runtime_mapping_free(rt);
+                return NULL;
+            }
+            rdev->abs_index[code] = rdev->nb_axes++;
+        }
+        for (int code = 0; code <= KEY_MAX; code++) {
+            if (!idev->has_button[code])
+                continue;
+            RtButton *btn = &rdev->buttons[rdev->nb_buttons++];
+            btn->code = code;
+            int mapped = idev->button_mapping[code];
+            int joy = idev->button_virtual_joystick[code];
+            if (joy >= 0 && joy < usb_nb_joysticks && mapped >= 0 && mapped < MAX_BUTTONS &&
+                usb_reports[joy].button_index[mapped] >= 0) {
+                btn->joy = joy;
+                btn->slot = mapped;
+            } else {
+                btn->joy = -1;
+                if (joy >= 0 && joy < usb_nb_joysticks && mapped >= 0 && mapped < usb_joysticks[joy].nb_buttons)
+                    outside_report++;
+            }
+        }
+        axes += rdev->nb_axes;
+        buttons += rdev->nb_buttons;
+    }
+    if (outside_report > 0)
+        log_msg(LOG_CAT_GENERAL, LOG_LEVEL_INFO,
+                "%d contrôles mappés hors des rapports compacts : ignorés jusqu'au redémarrage\n", outside_report);
+    uint64_t built, reused;
+    axis_transform_table_counts(&built, &reused);
+    if (built != built_before || reused != reused_before)
+        log_msg(LOG_CAT_AXIS, LOG_LEVEL_INFO, "Tables d'axes : %llu calculées, %llu réutilisées\n",
+                (unsigned long long)(built - built_before), (unsigned long long)(reused - reused_before));
+    return rt;
+}
+
+void runtime_mapping_free(RuntimeMapping *rt) {
+    if (!rt)
+        return;
+    for (int i = 0; i < rt->nb_devices; i++)
+        for (int a = 0; a < rt->devices[i].nb_axes; a++)
+            axis_transform_release(&rt->devices[i].axes[a].xform);
+    free(rt);
+}
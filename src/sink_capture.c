@@ -0,0 +1,100 @@
+#include "output_sink.h"
+#include "latency_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// Puits de capture : chaque rapport est ajouté, horodaté, à un fichier binaire
+// (voir SinkCaptureHeader / SinkCaptureRecord dans output_sink.h).
+typedef struct {
+    FILE *f;
+} CaptureSink;
+
+static int capture_append(CaptureSink *c, int joy, const uint8_t *data, size_t len, uint32_t event) {
+    SinkCaptureRecord rec;
+    rec.ts_ns = latency_now_ns();
+    rec.joy = (uint16_t)joy;
+    rec.length = (uint16_t)len;
+    rec.event = event;
+    // Un thread d'écriture par endpoint : en-tête et données d'un même
+    // enregistrement ne doivent pas être entrecoupés par un autre thread
+    int ret = (int)len;
+    flockfile(c->f);
+    if (fwrite(&rec, sizeof(rec), 1, c->f) != 1 || (len && fwrite(data, len, 1, c->f) != 1))
+        ret = -1;
+    funlockfile(c->f);
+    return ret;
+}
+
+static int capture_enable_endpoint(OutputSink *sink, int joy, struct usb_endpoint_descriptor *desc) {
+    (void)sink;
+    (void)joy;
+    (void)desc;
+    return 0;
+}
+
+static int capture_write_report(OutputSink *sink, int joy, const uint8_t *report, size_t len) {
+    CaptureSink *c = sink->priv;
+    if (len > UINT16_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    return capture_append(c, joy, report, len, 0);
+}
+
+static void capture_lifecycle(OutputSink *sink, int event) {
+    CaptureSink *c = sink->priv;
+    flockfile(c->f);
+    capture_append(c, 0, NULL, 0, (uint32_t)event);
+    fflush(c->f);
+    funlockfile(c->f);
+}
+
+static void capture_destroy(OutputSink *sink) {
+    CaptureSink *c = sink->priv;
+    if (c->f)
+        fclose(c->f);
+    free(c);
+    free(sink);
+}
+
+static const OutputSinkOps capture_ops = {
+    .name = "capture",
+    .enable_endpoint = capture_enable_endpoint,
+    .write_report = capture_write_report,
+    .lifecycle = capture_lifecycle,
+    .destroy = capture_destroy,
+};
+
+OutputSink *sink_capture_create(const char *path) {
+    OutputSink *sink = calloc(1, sizeof(OutputSink));
+    CaptureSink *c = calloc(1, sizeof(CaptureSink));
+    if (!sink || !c) {
+        perror("malloc capture sink");
+        free(sink);
+        free(c);
+        return NULL;
+    }
+    c->f = fopen(path, "wb");
+    if (!c->f) {
+        perror("fopen capture");
+        free(sink);
+        free(c);
+        return NULL;
+    }
+    SinkCaptureHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SINK_CAPTURE_MAGIC, sizeof(hdr.magic));
+    hdr.version = 1;
+    if (fwrite(&hdr, sizeof(hdr), 1, c->f) != 1) {
+        perror("fwrite capture header");
+        fclose(c->f);
+        free(sink);
+        free(c);
+        return NULL;
+    }
+    sink->ops = &capture_ops;
+    sink->priv = c;
+    return sink;
+}
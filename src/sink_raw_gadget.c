@@ -0,0 +1,89 @@
+#include "output_sink.h"
+#include "usb_raw.h"
+#include "usb_descriptors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+// Puits de production : endpoints interrupt du gadget /dev/raw-gadget
+typedef struct {
+    int fd;                                   // Descripteur du gadget
+    // Handles renvoyés par USB_RAW_IOCTL_EP_ENABLE (-1 : endpoint désactivé),
+    // écrits par le thread ep0 et lus par les threads d'écriture
+    _Atomic int ep[MAX_VIRTUAL_JOYSTICKS];
+    struct {
+        struct usb_raw_ep_io inner;
+        uint8_t data[256];
+    } io[MAX_VIRTUAL_JOYSTICKS];              // Un tampon par endpoint
+} RawGadgetSink;
+
+static int raw_gadget_enable_endpoint(OutputSink *sink, int joy, struct usb_endpoint_descriptor *desc) {
+    RawGadgetSink *g = sink->priv;
+    if (joy < 0 || joy >= MAX_VIRTUAL_JOYSTICKS) {
+        errno = EINVAL;
+        return -1;
+    }
+    atomic_store(&g->ep[joy], usb_raw_ep_enable(g->fd, desc));
+    return 0;
+}
+
+static int raw_gadget_write_report(OutputSink *sink, int joy, const uint8_t *report, size_t len) {
+    RawGadgetSink *g = sink->priv;
+    if (joy < 0 || joy >= MAX_VIRTUAL_JOYSTICKS || len > sizeof(g->io[joy].data)) {
+        errno = EINVAL;
+        return -1;
+    }
+    int ep = atomic_load(&g->ep[joy]);
+    if (ep < 0) {
+        // Reset ou déconnexion : comme le noyau, le thread d'écriture s'arrête
+        // et sera relancé au prochain SET_CONFIGURATION
+        errno = ESHUTDOWN;
+        return -1;
+    }
+    g->io[joy].inner.ep = ep;
+    memcpy(g->io[joy].data, report, len);
+    g->io[joy].inner.length = len;
+    return usb_raw_ep_write_may_fail(g->fd, (struct usb_raw_ep_io *)&g->io[joy]);
+}
+
+static void raw_gadget_lifecycle(OutputSink *sink, int event) {
+    RawGadgetSink *g = sink->priv;
+    if (event == SINK_EVENT_RESET || event == SINK_EVENT_DISCONNECT) {
+        // Les handles d'endpoint ne sont plus valides après un reset
+        for (int j = 0; j < MAX_VIRTUAL_JOYSTICKS; j++)
+            atomic_store(&g->ep[j], -1);
+    }
+}
+
+static void raw_gadget_destroy(OutputSink *sink) {
+    free(sink->priv);
+    free(sink);
+}
+
+static const OutputSinkOps raw_gadget_ops = {
+    .name = "gadget",
+    .host_paced = 1,
+    .enable_endpoint = raw_gadget_enable_endpoint,
+    .write_report = raw_gadget_write_report,
+    .lifecycle = raw_gadget_lifecycle,
+    .destroy = raw_gadget_destroy,
+};
+
+OutputSink *sink_raw_gadget_create(int gadget_fd) {
+    OutputSink *sink = calloc(1, sizeof(OutputSink));
+    RawGadgetSink *g = calloc(1, sizeof(RawGadgetSink));
+    if (!sink || !g) {
+        perror("malloc raw gadget sink");
+        free(sink);
+        free(g);
+        return NULL;
+    }
+    g->fd = gadget_fd;
+    for (int j = 0; j < MAX_VIRTUAL_JOYSTICKS; j++)
+        atomic_init(&g->ep[j], -1);
+    sink->ops = &raw_gadget_ops;
+    sink->priv = g;
+    return sink;
+}
@@ -0,0 +1,174 @@
+#include "output_sink.h"
+#include "usb_descriptors.h"
+#include "report_layout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+// Puits local : chaque joystick virtuel devient un périphérique uinput, en
+// décodant le rapport HID (format de usb_reports) et en n'émettant que les
+// changements.
+
+// Usages HID des axes (X, Y, Z, Rx, Ry, Rz, Slider, Dial) vus par hid-input,
+// puis les codes ABS_* suivants pour les axes supplémentaires
+static const int uinput_axis_codes[HID_MAX_AXES] = {
+    ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ, ABS_THROTTLE, ABS_RUDDER,
+    ABS_WHEEL, ABS_GAS, ABS_BRAKE, ABS_HAT0X, ABS_HAT0Y, ABS_HAT1X, ABS_HAT1Y, ABS_HAT2X
+};
+
+// Boutons : BTN_JOYSTICK..+15 puis BTN_TRIGGER_HAPPY1..40 (au-delà : ignorés)
+#define UINPUT_NUM_BUTTONS (16 + 40)
+
+static int uinput_button_code(int index) {
+    if (index < 16)
+        return BTN_JOYSTICK + index;
+    return BTN_TRIGGER_HAPPY1 + (index - 16);
+}
+
+typedef struct {
+    int fd[MAX_VIRTUAL_JOYSTICKS];
+    // Dernier état décodé, par axe et bouton virtuel
+    int16_t last_axes[MAX_VIRTUAL_JOYSTICKS][HID_MAX_AXES];
+    uint8_t last_buttons[MAX_VIRTUAL_JOYSTICKS][MAX_BUTTONS / 8];
+} UinputSink;
+
+static int uinput_create_device(int joy) {
+    const ReportLayout *rl = &usb_reports[joy];
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ioctl(fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    for (int i = 0; i < rl->nb_axes; i++) {
+        int code = uinput_axis_codes[rl->axis_slots[i]];
+        ioctl(fd, UI_SET_ABSBIT, code);
+        struct uinput_abs_setup abs;
+        memset(&abs, 0, sizeof(abs));
+        abs.code = code;
+        abs.absinfo.minimum = -32768;
+        abs.absinfo.maximum = 32767;
+        if (ioctl(fd, UI_ABS_SETUP, &abs) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    for (int i = 0; i < rl->nb_buttons; i++) {
+        if (rl->button_slots[i] < UINPUT_NUM_BUTTONS)
+            ioctl(fd, UI_SET_KEYBIT, uinput_button_code(rl->button_slots[i]));
+    }
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = USB_VENDOR;
+    setup.id.product = USB_PRODUCT;
+    setup.id.version = 1;
+    snprintf(setup.name, sizeof(setup.name), "Composite Joystick %d", joy);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int uinput_enable_endpoint(OutputSink *sink, int joy, struct usb_endpoint_descriptor *desc) {
+    UinputSink *u = sink->priv;
+    (void)desc;
+    if (joy < 0 || joy >= usb_nb_joysticks) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (u->fd[joy] >= 0)
+        return 0;
+    u->fd[joy] = uinput_create_device(joy);
+    if (u->fd[joy] < 0)
+        return -1;
+    memset(u->last_axes[joy], 0, sizeof(u->last_axes[joy]));
+    memset(u->last_buttons[joy], 0, sizeof(u->last_buttons[joy]));
+    return 0;
+}
+
+static int uinput_write_report(OutputSink *sink, int joy, const uint8_t *report, size_t len) {
+    UinputSink *u = sink->priv;
+    if (joy < 0 || joy >= usb_nb_joysticks || u->fd[joy] < 0 || len < (size_t)usb_reports[joy].size) {
+        errno = EINVAL;
+        return -1;
+    }
+    const ReportLayout *rl = &usb_reports[joy];
+    int16_t axes[HID_MAX_AXES];
+    uint8_t buttons[MAX_BUTTONS / 8];
+    report_layout_unpack(rl, report, axes, buttons);
+    struct input_event evs[HID_MAX_AXES + UINPUT_NUM_BUTTONS + 1];
+    int n = 0;
+    memset(evs, 0, sizeof(evs));
+    for (int i = 0; i < rl->nb_axes; i++) {
+        int a = rl->axis_slots[i];
+        if (axes[a] == u->last_axes[joy][a])
+            continue;
+        evs[n].type = EV_ABS;
+        evs[n].code = uinput_axis_codes[a];
+        evs[n].value = axes[a];
+        n++;
+    }
+    const uint8_t *prev_buttons = u->last_buttons[joy];
+    for (int i = 0; i < rl->nb_buttons; i++) {
+        int b = rl->button_slots[i];
+        uint8_t bit = 1 << (b % 8);
+        if (b >= UINPUT_NUM_BUTTONS || (buttons[b / 8] & bit) == (prev_buttons[b / 8] & bit))
+            continue;
+        evs[n].type = EV_KEY;
+        evs[n].code = uinput_button_code(b);
+        evs[n].value = (buttons[b / 8] & bit) ? 1 : 0;
+        n++;
+    }
+    memcpy(u->last_axes[joy], axes, sizeof(axes));
+    memcpy(u->last_buttons[joy], buttons, sizeof(buttons));
+    if (n == 0)
+        return (int)len;
+    evs[n].type = EV_SYN;
+    evs[n].code = SYN_REPORT;
+    n++;
+    if (write(u->fd[joy], evs, n * sizeof(struct input_event)) < 0)
+        return -1;
+    return (int)len;
+}
+
+static void uinput_destroy(OutputSink *sink) {
+    UinputSink *u = sink->priv;
+    for (int j = 0; j < MAX_VIRTUAL_JOYSTICKS; j++) {
+        if (u->fd[j] < 0)
+            continue;
+        ioctl(u->fd[j], UI_DEV_DESTROY);
+        close(u->fd[j]);
+    }
+    free(u);
+    free(sink);
+}
+
+static const OutputSinkOps uinput_ops = {
+    .name = "uinput",
+    .enable_endpoint = uinput_enable_endpoint,
+    .write_report = uinput_write_report,
+    .lifecycle = NULL,
+    .destroy = uinput_destroy,
+};
+
+OutputSink *sink_uinput_create(void) {
+    OutputSink *sink = calloc(1, sizeof(OutputSink));
+    UinputSink *u = calloc(1, sizeof(UinputSink));
+    if (!sink || !u) {
+        perror("malloc uinput sink");
+        free(sink);
+        free(u);
+        return NULL;
+    }
+    for (int j = 0; j < MAX_VIRTUAL_JOYSTICKS; j++)
+        u->fd[j] = -1;
+    sink->ops = &uinput_ops;
+    sink->priv = u;
+    return sink;
+}
@@ -1,144 +1,51 @@
 #include "usb_descriptors.h"
+#include "log_ring.h"
+#include "report_layout.h"
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 
-// Définition des rapports HID pour Joystick 0 et 1
-const unsigned char usb_hid_report0[] = {
-    0x05, 0x01,            // Usage Page (Generic Desktop)
-    0x09, 0x04,            // Usage (Joystick)
-    0xA1, 0x01,            // Collection (Application)
-    0x85, 0x01,            // Report ID (1)
-    0x16, 0x00, 0x80,       // Logical Minimum (-32768)
-    0x26, 0xFF, 0x7F,       // Logical Maximum (32767)
-    0x75, 0x10,            // Report Size (16)
-    0x95, 0x08,            // Report Count (8 axes)
-    0x09, 0x30,            // Usage (X)
-    0x09, 0x31,            // Usage (Y)
-    0x09, 0x32,            // Usage (Z)
-    0x09, 0x33,            // Usage (Rx)
-    0x09, 0x34,            // Usage (Ry)
-    0x09, 0x35,            // Usage (Rz)
-    0x09, 0x36,            // Usage (Slider)
-    0x09, 0x37,            // Usage (Dial)
-    0x81, 0x02,            // Input (Data,Var,Abs) [Axes]
-    0x05, 0x09,            // Usage Page (Button)
-    0x19, 0x01,            // Usage Minimum (Button 1)
-    0x29, 0x80,            // Usage Maximum (Button 128)
-    0x15, 0x00,            // Logical Minimum (0)
-    0x25, 0x01,            // Logical Maximum (1)
-    0x75, 0x01,            // Report Size (1)
-    0x95, 0x80,            // Report Count (128 boutons)
-    0x81, 0x02,            // Input (Data,Var,Abs) [Boutons]
-    0xC0                   // End Collection
-};
-
-const unsigned char usb_hid_report1[] = {
-    0x05, 0x01,            // Usage Page (Generic Desktop)
-    0x09, 0x04,            // Usage (Joystick)
-    0xA1, 0x01,            // Collection (Application)
-    0x85, 0x02,            // Report ID (2)
-    0x16, 0x00, 0x80,       // Logical Minimum (-32768)
-    0x26, 0xFF, 0x7F,       // Logical Maximum (32767)
-    0x75, 0x10,            // Report Size (16)
-    0x95, 0x08,            // Report Count (8 axes)
-    0x09, 0x30,            // Usage (X)
-    0x09, 0x31,            // Usage (Y)
-    0x09, 0x32,            // Usage (Z)
-    0x09, 0x33,            // Usage (Rx)
-    0x09, 0x34,            // Usage (Ry)
-    0x09, 0x35,            // Usage (Rz)
-    0x09, 0x36,            // Usage (Slider)
-    0x09, 0x37,            // Usage (Dial)
-    0x81, 0x02,            // Input (Data,Var,Abs) [Axes]
-    0x05, 0x09,            // Usage Page (Button)
-    0x19, 0x01,            // Usage Minimum (Button 1)
-    0x29, 0x80,            // Usage Maximum (Button 128)
-    0x15, 0x00,            // Logical Minimum (0)
-    0x25, 0x01,            // Logical Maximum (1)
-    0x75, 0x01,            // Report Size (1)
-    0x95, 0x80,            // Report Count (128 boutons)
-    0x81, 0x02,            // Input (Data,Var,Abs) [Boutons]
-    0xC0                   // End Collection
-};
-
-// Définition des tailles des rapports HID
-const unsigned int usb_hid_report0_size = sizeof(usb_hid_report0);
-const unsigned int usb_hid_report1_size = sizeof(usb_hid_report1);
-
-// Descripteur HID pour le Joystick 0
-struct hid_descriptor usb_hid0 = {
-    .bLength = 9,
-    .bDescriptorType = HID_DT_HID,
-    .bcdHID = __constant_cpu_to_le16(0x0110),
-    .bCountryCode = 0,
-    .bNumDescriptors = 1,
-    .desc = {
-        {
-            .bDescriptorType = HID_DT_REPORT,
-            .wDescriptorLength = __constant_cpu_to_le16(usb_hid_report0_size),
-        }
-    },
-};
+// Vitesse de fonctionnement et fréquence demandée (usb_configure_polling)
+static int usb_speed = USB_DEVICE_SPEED;
+static int usb_rate = USB_POLL_RATE_DEFAULT;
 
-// Descripteur HID pour le Joystick 1
-struct hid_descriptor usb_hid1 = {
-    .bLength = 9,
-    .bDescriptorType = HID_DT_HID,
-    .bcdHID = __constant_cpu_to_le16(0x0110),
-    .bCountryCode = 0,
-    .bNumDescriptors = 1,
-    .desc = {
-        {
-            .bDescriptorType = HID_DT_REPORT,
-            .wDescriptorLength = __constant_cpu_to_le16(usb_hid_report1_size),
-        }
-    },
-};
+// Fréquence réellement disponible à une vitesse donnée
+static int rate_at_speed(int speed) {
+    if (speed != USB_SPEED_HIGH && usb_rate > 1000)
+        return 1000;
+    return usb_rate;
+}
 
-// Descripteurs d'interface USB
-struct usb_interface_descriptor usb_interface0 = {
-    .bLength = USB_DT_INTERFACE_SIZE,
-    .bDescriptorType = USB_DT_INTERFACE,
-    .bInterfaceNumber = 0,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = 1,
-    .bInterfaceClass = USB_CLASS_HID,
-    .bInterfaceSubClass = 0,
-    .bInterfaceProtocol = 0,
-    .iInterface = STRING_ID_INTERFACE0,
-};
+// bInterval pour une vitesse : exposant de microtrames en high speed, trames en full speed
+static uint8_t interval_at_speed(int speed) {
+    int rate = rate_at_speed(speed);
+    if (speed == USB_SPEED_HIGH) {
+        uint8_t interval = 1;
+        while ((USB_POLL_RATE_MAX >> (interval - 1)) > rate)
+            interval++;
+        return interval;
+    }
+    return 1000 / rate;
+}
 
-struct usb_interface_descriptor usb_interface1 = {
-    .bLength = USB_DT_INTERFACE_SIZE,
-    .bDescriptorType = USB_DT_INTERFACE,
-    .bInterfaceNumber = 1,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = 1,
-    .bInterfaceClass = USB_CLASS_HID,
-    .bInterfaceSubClass = 0,
-    .bInterfaceProtocol = 0,
-    .iInterface = STRING_ID_INTERFACE1,
-};
+int usb_configure_polling(int speed, int hz) {
+    if (hz < USB_POLL_RATE_MIN || hz > USB_POLL_RATE_MAX || hz % USB_POLL_RATE_MIN != 0 ||
+        ((hz / USB_POLL_RATE_MIN) & (hz / USB_POLL_RATE_MIN - 1)) != 0)
+        return -1;
+    usb_speed = speed;
+    usb_rate = hz;
+    for (int j = 0; j < usb_nb_joysticks; j++)
+        usb_endpoints[j].bInterval = interval_at_speed(speed);
+    return 0;
+}
 
-// Descripteurs d'endpoint pour les deux interfaces
-struct usb_endpoint_descriptor usb_endpoint0 = {
-    .bLength = USB_DT_ENDPOINT_SIZE,
-    .bDescriptorType = USB_DT_ENDPOINT,
-    .bEndpointAddress = USB_DIR_IN | EP_NUM_INT_IN0,
-    .bmAttributes = USB_ENDPOINT_XFER_INT,
-    .wMaxPacketSize = __cpu_to_le16(33),
-    .bInterval = 1,
-};
+int usb_poll_rate(void) {
+    return rate_at_speed(usb_speed);
+}
 
-struct usb_endpoint_descriptor usb_endpoint1 = {
-    .bLength = USB_DT_ENDPOINT_SIZE,
-    .bDescriptorType = USB_DT_ENDPOINT,
-    .bEndpointAddress = USB_DIR_IN | EP_NUM_INT_IN1,
-    .bmAttributes = USB_ENDPOINT_XFER_INT,
-    .wMaxPacketSize = __cpu_to_le16(33),
-    .bInterval = 1,
-};
+uint64_t usb_poll_period_ns(void) {
+    return 1000000000ULL / rate_at_speed(usb_speed);
+}
 
 // Descripteur de périphérique USB
 struct usb_device_descriptor usb_device = {
@@ -176,66 +83,131 @@ struct usb_config_descriptor usb_config = {
     .bLength = USB_DT_CONFIG_SIZE,
     .bDescriptorType = USB_DT_CONFIG,
     .wTotalLength = 0, // Calculé dynamiquement
-    .bNumInterfaces = 2,
+    .bNumInterfaces = DEFAULT_VIRTUAL_JOYSTICKS,   // usb_configure_joysticks
     .bConfigurationValue = 1,
     .iConfiguration = STRING_ID_CONFIG,
     .bmAttributes = USB_CONFIG_ATT_ONE | USB_CONFIG_ATT_SELFPOWER,
     .bMaxPower = 0x32,
 };
 
+// Disposition courante et descripteurs générés (usb_configure_joysticks)
+int usb_nb_joysticks = 0;
+VirtualJoystickLayout usb_joysticks[MAX_VIRTUAL_JOYSTICKS];
+ReportLayout usb_reports[MAX_VIRTUAL_JOYSTICKS];
+unsigned char usb_hid_reports[MAX_VIRTUAL_JOYSTICKS][HID_MAX_REPORT_DESC_SIZE];
+unsigned int usb_hid_report_sizes[MAX_VIRTUAL_JOYSTICKS];
+struct hid_descriptor usb_hids[MAX_VIRTUAL_JOYSTICKS];
+struct usb_interface_descriptor usb_interfaces[MAX_VIRTUAL_JOYSTICKS];
+struct usb_endpoint_descriptor usb_endpoints[MAX_VIRTUAL_JOYSTICKS];
+
+int usb_joystick_layout_valid(const VirtualJoystickLayout *layouts, int count) {
+    if (count < 1 || count > MAX_VIRTUAL_JOYSTICKS)
+        return 0;
+    for (int j = 0; j < count; j++) {
+        if (layouts[j].nb_axes < 0 || layouts[j].nb_axes > HID_MAX_AXES ||
+            layouts[j].nb_buttons < 0 || layouts[j].nb_buttons > MAX_BUTTONS ||
+            layouts[j].nb_axes + layouts[j].nb_buttons == 0)
+            return 0;
+        int bits = layouts[j].axis_bits;
+        if (bits != 0 && bits != 8 && bits != 10 && bits != 12 && bits != 16)
+            return 0;
+    }
+    return 1;
+}
+
+int usb_configure_joysticks(const VirtualJoystickLayout *layouts, const ReportLayout *reports, int count) {
+    if (!usb_joystick_layout_valid(layouts, count))
+        return -1;
+    usb_nb_joysticks = count;
+    for (int j = 0; j < count; j++) {
+        usb_joysticks[j] = layouts[j];
+        usb_reports[j] = reports[j];
+        usb_hid_report_sizes[j] = report_layout_descriptor(&reports[j], usb_hid_reports[j], HID_MAX_REPORT_DESC_SIZE);
+        usb_hids[j] = (struct hid_descriptor) {
+            .bLength = 9,
+            .bDescriptorType = HID_DT_HID,
+            .bcdHID = __constant_cpu_to_le16(0x0110),
+            .bCountryCode = 0,
+            .bNumDescriptors = 1,
+            .desc = {
+                {
+                    .bDescriptorType = HID_DT_REPORT,
+                    .wDescriptorLength = __cpu_to_le16(usb_hid_report_sizes[j]),
+                }
+            },
+        };
+        usb_interfaces[j] = (struct usb_interface_descriptor) {
+            .bLength = USB_DT_INTERFACE_SIZE,
+            .bDescriptorType = USB_DT_INTERFACE,
+            .bInterfaceNumber = j,
+            .bAlternateSetting = 0,
+            .bNumEndpoints = 1,
+            .bInterfaceClass = USB_CLASS_HID,
+            .bInterfaceSubClass = 0,
+            .bInterfaceProtocol = 0,
+            .iInterface = STRING_ID_INTERFACE_BASE + j,
+        };
+        usb_endpoints[j] = (struct usb_endpoint_descriptor) {
+            .bLength = USB_DT_ENDPOINT_SIZE,
+            .bDescriptorType = USB_DT_ENDPOINT,
+            .bEndpointAddress = USB_DIR_IN | (EP_NUM_INT_IN0 + j),
+            .bmAttributes = USB_ENDPOINT_XFER_INT,
+            .wMaxPacketSize = __cpu_to_le16(reports[j].size),
+            .bInterval = interval_at_speed(usb_speed),
+        };
+    }
+    usb_config.bNumInterfaces = count;
+    return 0;
+}
+
+// Disposition par défaut, générée avant main (outils et banc qui ne lisent pas de mapping)
+__attribute__((constructor))
+static void usb_default_joysticks(void) {
+    VirtualJoystickLayout layouts[DEFAULT_VIRTUAL_JOYSTICKS];
+    ReportLayout reports[DEFAULT_VIRTUAL_JOYSTICKS];
+    for (int j = 0; j < DEFAULT_VIRTUAL_JOYSTICKS; j++) {
+        memset(&layouts[j], 0, sizeof(layouts[j]));
+        layouts[j].nb_axes = DEFAULT_JOYSTICK_AXES;
+        layouts[j].nb_buttons = DEFAULT_JOYSTICK_BUTTONS;
+        report_layout_full(&reports[j], j, &layouts[j]);
+    }
+    usb_configure_joysticks(layouts, reports, DEFAULT_VIRTUAL_JOYSTICKS);
+}
+
+// Ajoute un descripteur au bloc de configuration
+static void config_append(char **data, int *length, int *total_length, const void *desc, int size) {
+    assert(*length >= size);
+    memcpy(*data, desc, size);
+    *data += size;
+    *length -= size;
+    *total_length += size;
+}
+
 int build_config(char *data, int length, int other_speed) {
     struct usb_config_descriptor *config_desc = (struct usb_config_descriptor *)data;
     int total_length = 0;
-    
-    assert(length >= (int)sizeof(usb_config));
-    memcpy(data, &usb_config, sizeof(usb_config));
-    data += sizeof(usb_config);
-    length -= sizeof(usb_config);
-    total_length += sizeof(usb_config);
-    
-    // Interface 0 + HID + endpoint
-    assert(length >= (int)sizeof(usb_interface0));
-    memcpy(data, &usb_interface0, sizeof(usb_interface0));
-    data += sizeof(usb_interface0);
-    length -= sizeof(usb_interface0);
-    total_length += sizeof(usb_interface0);
-    
-    assert(length >= (int)sizeof(usb_hid0));
-    memcpy(data, &usb_hid0, sizeof(usb_hid0));
-    data += sizeof(usb_hid0);
-    length -= sizeof(usb_hid0);
-    total_length += sizeof(usb_hid0);
-    
-    assert(length >= (int)USB_DT_ENDPOINT_SIZE);
-    memcpy(data, &usb_endpoint0, USB_DT_ENDPOINT_SIZE);
-    data += USB_DT_ENDPOINT_SIZE;
-    length -= USB_DT_ENDPOINT_SIZE;
-    total_length += USB_DT_ENDPOINT_SIZE;
-    
-    // Interface 1 + HID + endpoint
-    assert(length >= (int)sizeof(usb_interface1));
-    memcpy(data, &usb_interface1, sizeof(usb_interface1));
-    data += sizeof(usb_interface1);
-    length -= sizeof(usb_interface1);
-    total_length += sizeof(usb_interface1);
-    
-    assert(length >= (int)sizeof(usb_hid1));
-    memcpy(data, &usb_hid1, sizeof(usb_hid1));
-    data += sizeof(usb_hid1);
-    length -= sizeof(usb_hid1);
-    total_length += sizeof(usb_hid1);
-    
-    assert(length >= (int)USB_DT_ENDPOINT_SIZE);
-    memcpy(data, &usb_endpoint1, USB_DT_ENDPOINT_SIZE);
-    data += USB_DT_ENDPOINT_SIZE;
-    length -= USB_DT_ENDPOINT_SIZE;
-    total_length += USB_DT_ENDPOINT_SIZE;
+    // Endpoints décrits à la vitesse demandée (fonctionnement ou autre vitesse)
+    int speed = usb_speed;
+    if (other_speed)
+        speed = usb_speed == USB_SPEED_HIGH ? USB_SPEED_FULL : USB_SPEED_HIGH;
+    uint8_t interval = interval_at_speed(speed);
+
+    config_append(&data, &length, &total_length, &usb_config, sizeof(usb_config));
+    // Pour chaque joystick : interface + HID + endpoint
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        struct usb_endpoint_descriptor ep = usb_endpoints[j];
+        ep.bInterval = interval;
+        config_append(&data, &length, &total_length, &usb_interfaces[j], sizeof(usb_interfaces[j]));
+        config_append(&data, &length, &total_length, &usb_hids[j], sizeof(usb_hids[j]));
+        config_append(&data, &length, &total_length, &ep, USB_DT_ENDPOINT_SIZE);
+    }
     
     config_desc->wTotalLength = __cpu_to_le16(total_length);
     
     if (other_speed)
         config_desc->bDescriptorType = USB_DT_OTHER_SPEED_CONFIG;
     
-    printf("Composite config wTotalLength: %d\n", total_length);
+    log_msg(LOG_CAT_EP0, LOG_LEVEL_INFO, "Composite config wTotalLength: %d, %d joysticks, %s speed, bInterval %d\n",
+            total_length, usb_nb_joysticks, speed == USB_SPEED_HIGH ? "high" : "full", interval);
     return total_length;
 }
@@ -1,174 +1,1581 @@
 #include "usb_hid.h"
-#include "input_mapping.h" // Pour la définition de InputDevice
+#include "runtime_mapping.h"
+#include "log_ring.h"
+#include "latency_stats.h"
+#include "report_layout.h"
+#include "rt_mode.h"
+#include "input_trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
 #include <linux/input.h>
 
-// Les endpoints interrupt (déclarés dans main.c)
-extern int ep_int_in0;
-extern int ep_int_in1;
+// Jetons epoll réservés aux eventfd d'arrêt et de réveil (les autres jetons
+// sont des index de périphérique dans le mapping courant)
+#define HID_STOP_TOKEN UINT32_MAX
+#define HID_WAKE_TOKEN (UINT32_MAX - 1)
+// Nombre maximum d'événements epoll traités par réveil
+#define HID_MAX_EPOLL_EVENTS 32
+// Nombre d'input_event lus par appel à read()
+#define HID_READ_BATCH 64
+// Nombre maximum d'événements en attente dans une trame (entre deux SYN_REPORT)
+#define HID_FRAME_MAX 64
+// Fenêtre d'attente active maximale
+#define HID_BUSY_POLL_MAX_US 100000
+// Modifications par delta de trame (une trame plus longue est découpée)
+#define HID_DELTA_MAX_OPS 64
+// Nombre de cellules de la file des lecteurs (puissance de 2)
+#define HID_DELTA_QUEUE_SIZE 1024
 
-extern bool keep_running;
+// Delta de trame d'un lecteur : modifications déjà traduites (valeur finale
+// d'un axe, état d'un bouton), appliquées telles quelles par l'agrégateur
+enum { HID_DELTA_AXIS = 0, HID_DELTA_BUTTON };
+
+typedef struct {
+    int16_t value;            // Valeur transformée de l'axe, 0/1 pour un bouton
+    uint8_t joy;
+    uint8_t kind;             // HID_DELTA_AXIS ou HID_DELTA_BUTTON
+    uint8_t slot;
+} HidDeltaOp;
+
+typedef struct {
+    uint64_t frame_ts;        // Horodatage evdev du SYN_REPORT
+    uint64_t commit_ts;       // Instant où le lecteur a traduit la trame
+    uint16_t nb_ops;
+    uint8_t reader;
+    bool continued;           // Trame découpée : la suite est dans un delta suivant
+    HidDeltaOp ops[HID_DELTA_MAX_OPS];
+} HidDelta;
+
+// Cellule de la file bornée multi-producteurs (Vyukov) : seq vaut la position
+// d'écriture attendue quand la cellule est libre, position + 1 une fois le
+// delta publié
+typedef struct {
+    _Atomic uint64_t seq;
+    HidDelta delta;
+} __attribute__((aligned(64))) HidDeltaCell;
+
+// Etat des rapports des joysticks virtuels (usb_nb_joysticks utilisés)
+typedef struct {
+    int16_t axes[MAX_VIRTUAL_JOYSTICKS][HID_MAX_AXES];
+    uint8_t buttons[MAX_VIRTUAL_JOYSTICKS][MAX_BUTTONS/8];
+    bool updated[MAX_VIRTUAL_JOYSTICKS];
+    // Instrumentation : plus ancienne trame evdev non encore envoyée, par joystick
+    uint64_t frame_ts[MAX_VIRTUAL_JOYSTICKS];  // horodatage evdev (CLOCK_MONOTONIC) du SYN_REPORT
+    uint64_t commit_ts[MAX_VIRTUAL_JOYSTICKS]; // instant où la trame a été appliquée
+    // Attente active : trames appliquées et mode de réveil qui les a lues
+    uint64_t frames;
+    bool busy_poll;                            // Latence de lecture mesurée (attente active configurée)
+    bool spinning;                             // Réveil courant issu de l'attente active
+    const InputTraceState *replay_state;       // Rejeu : état à appliquer au lieu de l'interroger
+    HidDelta *delta;                           // Lecteur : trames traduites en deltas, état non modifié
+    bool delta_pushed;                         // Deltas poussés depuis le dernier signal à l'agrégateur
+} HidReportState;
+
+// Trame evdev en cours d'accumulation pour un périphérique
+typedef struct {
+    struct input_event pending[HID_FRAME_MAX];
+    int nb_pending;
+    bool dropped;             // SYN_DROPPED reçu : événements ignorés jusqu'au SYN_REPORT
+    // Filtre anti-gigue, par code ABS_* : dernière valeur lue et dernière
+    // sortie retenue (valides si le bit du code est dans axis_seen). Il est
+    // propre au périphérique et survit donc aux remplacements du mapping.
+    uint64_t axis_seen;
+    int32_t axis_raw[ABS_CNT];
+    int16_t axis_out[ABS_CNT];
+    uint32_t frame_filtered;  // Evénements de la trame en cours écartés ou absorbés
+    uint32_t frame_changes;   // Evénements de la trame en cours qui modifient une sortie
+    // Cumul depuis le dernier relevé par drain_device
+    uint32_t hysteresis_events;
+    uint32_t absorbed_events;
+    uint32_t suppressed_frames;
+} HidDeviceFrame;
+
+// Compteurs partagés d'un périphérique (hid_device_stats), écrits par le seul
+// thread qui le lit. uid est publié en dernier : nom et compteurs sont prêts
+// quand il est non nul.
+typedef struct {
+    atomic_bool claimed;
+    _Atomic unsigned uid;
+    char name[48];
+    _Atomic uint64_t events;
+    _Atomic uint64_t reads;
+    _Atomic uint64_t budget_hits;
+    _Atomic uint64_t max_backlog_passes;
+    _Atomic uint64_t read_age_ns;
+    _Atomic uint64_t max_read_age_ns;
+    _Atomic uint64_t hysteresis_events;
+    _Atomic uint64_t absorbed_events;
+    _Atomic uint64_t suppressed_frames;
+} __attribute__((aligned(64))) HidDeviceCounters;
+
+// Périphérique enregistré dans l'epoll du thread HID (propre au thread : il
+// survit au mapping qui l'a décrit, pour pouvoir le comparer au suivant)
+typedef struct {
+    int fd;
+    unsigned uid;
+    bool registered;
+    bool pending;             // Données à lire : front epoll ou budget épuisé à la passe précédente
+    uint32_t revents;         // Evénements epoll reçus depuis la dernière passe
+    uint32_t backlog_passes;  // Passes consécutives terminées sur un budget épuisé
+    HidDeviceCounters *stats; // NULL si la table est pleine ou le périphérique retiré
+    HidDeviceFrame frame;
+} HidDeviceSlot;
+
+// Boîte aux lettres d'un endpoint : dernier rapport publié par le thread HID,
+// protégé par un compteur de séquence (seqlock à un seul écrivain). Le thread
+// d'écriture de l'endpoint n'envoie que l'état le plus récent : les états
+// intermédiaires sont remplacés, jamais mis en file, et un endpoint bloqué ne
+// retarde ni l'autre ni la lecture des périphériques.
+#define HID_MAILBOX_WORDS ((HID_MAX_REPORT_SIZE + 3) / 4)
+typedef struct {
+    _Atomic uint32_t seq;                       // Impair pendant une publication
+    _Atomic uint32_t words[HID_MAILBOX_WORDS];  // Rapport, copié mot à mot
+    _Atomic uint64_t frame_ts;                  // Horodatage evdev de la trame publiée
+    _Atomic uint64_t commit_ts;                 // Instant où elle a été appliquée
+    _Atomic bool stop;
+    int wake_fd;                                // eventfd : nouveau rapport publié
+    int joy;
+    int report_len;                             // Taille du rapport du joystick
+    uint64_t period_ns;                         // Intervalle d'interrogation de l'endpoint
+    OutputSink *sink;
+    pthread_t thread;
+} __attribute__((aligned(64))) HidMailbox;
+
+static HidMailbox hid_mailbox[MAX_VIRTUAL_JOYSTICKS];
+// Nombre de threads d'écriture démarrés par hid_writers_start
+static int hid_nb_writers = 0;
+
+// Thread HID courant (ou d'agrégation), eventfd d'arrêt commun et eventfd de
+// réveil de chaque thread de lecture (-1 si aucun thread actif)
+static pthread_t hid_thread;
+static bool hid_thread_active = false;
+static int hid_stop_fd = -1;
+static int hid_wake_fds[HID_MAX_READERS];
+static _Atomic int hid_nb_wake_fds = 0;
+
+// Lecteurs configurés, lecteurs démarrés et leur file vers l'agrégateur
+static int hid_readers_configured = 0;
+static int hid_nb_readers = 0;
+static pthread_t hid_readers[HID_MAX_READERS];
+static HidDeltaCell *hid_queue = NULL;
+static _Atomic uint64_t hid_queue_head __attribute__((aligned(64))) = 0; // Prochaine position d'écriture
+static uint64_t hid_queue_tail __attribute__((aligned(64))) = 0;         // Lue par l'agrégateur seul
+static int hid_queue_fd = -1;                                           // eventfd : deltas publiés
+static struct {
+    _Atomic uint64_t deltas;
+    _Atomic uint64_t ops;
+    _Atomic uint64_t queue_full;
+    _Atomic uint64_t max_backlog;
+} hid_reader_counters;
+
+// Mapping publié pour le thread HID. Il est relu à chaque réveil epoll et
+// peut donc être remplacé entre deux réveils sans arrêter le thread.
+static _Atomic(RuntimeMapping *) hid_mapping = NULL;
+// Etat de quiescence de chaque thread de lecture (thread HID unique : index
+// 0) : impair pendant le traitement d'un réveil. Un remplacement attend que
+// l'état de chacun change pour libérer l'ancien mapping.
+static struct {
+    _Atomic uint64_t state;
+} __attribute__((aligned(64))) hid_rcu[HID_MAX_READERS];
+// Dernier numéro de publication attribué (RuntimeMapping.generation)
+static _Atomic uint64_t hid_generation = 0;
+// Arrêt demandé : vérifié à chaque tour d'attente active, où l'eventfd
+// d'arrêt n'est pas surveillé
+static atomic_bool hid_stop_requested = false;
+
+// Fenêtre d'attente active après la dernière trame (0 : désactivée)
+static uint64_t hid_busy_poll_ns = 0;
+// Evénements lus par périphérique et par passe (0 : jusqu'à EAGAIN)
+static unsigned hid_device_budget = HID_DEVICE_BUDGET_DEFAULT;
+// Compteurs par périphérique depuis hid_thread_start
+static HidDeviceCounters hid_device_counters[HID_MAX_DEVICE_STATS];
+// Compteurs de l'attente active, écrits par le thread HID seul
+static struct {
+    _Atomic uint64_t blocking_waits;
+    _Atomic uint64_t spin_polls;
+    _Atomic uint64_t spin_ns;
+    _Atomic uint64_t spin_frames;
+    _Atomic uint64_t spin_latency_ns;
+    _Atomic uint64_t blocking_frames;
+    _Atomic uint64_t blocking_latency_ns;
+} hid_busy_stats;
+
+// Remise à zéro d'une entrée, rendue disponible en dernier
+static void hid_device_counters_clear(HidDeviceCounters *c) {
+    atomic_store(&c->uid, 0);
+    atomic_store(&c->events, 0);
+    atomic_store(&c->reads, 0);
+    atomic_store(&c->budget_hits, 0);
+    atomic_store(&c->max_backlog_passes, 0);
+    atomic_store(&c->read_age_ns, 0);
+    atomic_store(&c->max_read_age_ns, 0);
+    atomic_store(&c->hysteresis_events, 0);
+    atomic_store(&c->absorbed_events, 0);
+    atomic_store(&c->suppressed_frames, 0);
+    atomic_store(&c->claimed, false);
+}
+
+static void hid_device_counters_reset(void) {
+    for (int i = 0; i < HID_MAX_DEVICE_STATS; i++)
+        hid_device_counters_clear(&hid_device_counters[i]);
+}
+
+static void hid_busy_stats_reset(void) {
+    atomic_store(&hid_busy_stats.blocking_waits, 0);
+    atomic_store(&hid_busy_stats.spin_polls, 0);
+    atomic_store(&hid_busy_stats.spin_ns, 0);
+    atomic_store(&hid_busy_stats.spin_frames, 0);
+    atomic_store(&hid_busy_stats.spin_latency_ns, 0);
+    atomic_store(&hid_busy_stats.blocking_frames, 0);
+    atomic_store(&hid_busy_stats.blocking_latency_ns, 0);
+}
+
+// Publication par le thread HID (seul écrivain)
+static void mailbox_publish(HidMailbox *mb, const uint8_t *report, uint64_t frame_ts, uint64_t commit_ts) {
+    uint32_t words[HID_MAILBOX_WORDS] = {0};
+    memcpy(words, report, mb->report_len);
+    uint32_t seq = atomic_load_explicit(&mb->seq, memory_order_relaxed);
+    atomic_store_explicit(&mb->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int i = 0; i < HID_MAILBOX_WORDS; i++)
+        atomic_store_explicit(&mb->words[i], words[i], memory_order_relaxed);
+    atomic_store_explicit(&mb->frame_ts, frame_ts, memory_order_relaxed);
+    atomic_store_explicit(&mb->commit_ts, commit_ts, memory_order_relaxed);
+    atomic_store_explicit(&mb->seq, seq + 2, memory_order_release);
+    uint64_t one = 1;
+    if (write(mb->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        log_msg(LOG_CAT_USB, LOG_LEVEL_ERROR, "write(mailbox wake_fd): %s\n", strerror(errno));
+}
+
+// Lecture cohérente du dernier rapport ; retourne sa séquence (paire)
+static uint32_t mailbox_read(HidMailbox *mb, uint8_t *report, uint64_t *frame_ts, uint64_t *commit_ts) {
+    uint32_t words[HID_MAILBOX_WORDS];
+    for (;;) {
+        uint32_t seq = atomic_load_explicit(&mb->seq, memory_order_acquire);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        for (int i = 0; i < HID_MAILBOX_WORDS; i++)
+            words[i] = atomic_load_explicit(&mb->words[i], memory_order_relaxed);
+        *frame_ts = atomic_load_explicit(&mb->frame_ts, memory_order_relaxed);
+        *commit_ts = atomic_load_explicit(&mb->commit_ts, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&mb->seq, memory_order_relaxed) == seq) {
+            memcpy(report, words, mb->report_len);
+            return seq;
+        }
+    }
+}
+
+// Attend l'échéance absolue deadline_ns (CLOCK_MONOTONIC)
+static void sleep_until_ns(uint64_t deadline_ns) {
+    struct timespec ts = { .tv_sec = deadline_ns / 1000000000ULL, .tv_nsec = deadline_ns % 1000000000ULL };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+// Thread d'écriture d'un endpoint : attend une publication et envoie le
+// rapport le plus récent. Avec le gadget, l'écriture bloque jusqu'à
+// l'interrogation de l'hôte, qui impose donc le rythme ; les autres puits sont
+// cadencés ici à la fréquence configurée. Les mesures de latence de
+// l'endpoint sont faites ici.
+static void *hid_writer_loop(void *arg) {
+    HidMailbox *mb = arg;
+    int j = mb->joy;
+    char name[16];
+    snprintf(name, sizeof(name), "ep_in%d", j);
+    if (log_ring_register_thread(name) < 0)
+        fprintf(stderr, "%s thread: pas d'anneau de log disponible, écriture directe\n", name);
+    rt_mode_enter_thread(RT_ROLE_WRITER);
+    uint8_t report[HID_MAX_REPORT_SIZE];
+    uint32_t sent_seq = 0;
+    uint64_t sent = 0, superseded = 0;
+    bool host_paced = mb->sink->ops->host_paced;
+    uint64_t next_write = 0;     // Cadence locale : pas d'écriture avant cette échéance
+    uint64_t wait_total = 0;     // Attente cumulée de l'hôte (puits cadencé par l'hôte)
+    uint64_t late_polls = 0;     // Ecritures ayant attendu plus de deux intervalles
+    for (;;) {
+        uint64_t count;
+        if (read(mb->wake_fd, &count, sizeof(count)) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("read(mailbox wake_fd)");
+            break;
+        }
+        if (atomic_load(&mb->stop))
+            break;
+        // Les publications arrivées pendant l'attente sont fusionnées par la lecture
+        if (!host_paced && next_write > latency_now_ns())
+            sleep_until_ns(next_write);
+        uint64_t frame_ts, commit_ts;
+        uint32_t seq = mailbox_read(mb, report, &frame_ts, &commit_ts);
+        if (seq == sent_seq)
+            continue;
+        superseded += (seq - sent_seq) / 2 - 1;
+        sent_seq = seq;
+        uint64_t submitted = latency_now_ns();
+        next_write = submitted + mb->period_ns;
+        int rv = output_sink_write(mb->sink, j, report, mb->report_len);
+        if (rv < 0 && errno == ESHUTDOWN) {
+            log_msg(LOG_CAT_USB, LOG_LEVEL_INFO, "ep_int_in%d: device reset, ending writer thread\n", j);
+            break;
+        } else if (rv < 0) {
+            fprintf(stderr, "%s: write_report() joystick %d: %s\n", mb->sink->ops->name, j, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        sent++;
+        uint64_t written = latency_now_ns();
+        if (host_paced) {
+            wait_total += written - submitted;
+            if (written - submitted > 2 * mb->period_ns)
+                late_polls++;
+        }
+        // Une trame horodatée dans le futur (horloge non monotone) est ignorée
+        if (frame_ts <= commit_ts) {
+            latency_stats_record(j, LAT_STAGE_READ_TO_COMMIT, commit_ts - frame_ts);
+            latency_stats_record(j, LAT_STAGE_TOTAL, written - frame_ts);
+        }
+        latency_stats_record(j, LAT_STAGE_COMMIT_TO_WRITE, written - commit_ts);
+    }
+    log_msg(LOG_CAT_USB, LOG_LEVEL_INFO, "ep_int_in%d: %llu rapports envoyés, %llu remplacés avant envoi\n",
+            j, (unsigned long long)sent, (unsigned long long)superseded);
+    if (host_paced && sent > 0)
+        log_msg(LOG_CAT_USB, LOG_LEVEL_INFO,
+                "ep_int_in%d: attente moyenne de l'hôte %.1f us (intervalle %.1f us), %llu interrogations en retard\n",
+                j, wait_total / 1000.0 / sent, mb->period_ns / 1000.0, (unsigned long long)late_polls);
+    log_ring_release_thread();
+    return NULL;
+}
+
+static void hid_writers_stop(int started) {
+    for (int j = 0; j < started; j++) {
+        HidMailbox *mb = &hid_mailbox[j];
+        atomic_store(&mb->stop, true);
+        uint64_t one = 1;
+        if (write(mb->wake_fd, &one, sizeof(one)) < 0)
+            perror("write(mailbox wake_fd)");
+        pthread_join(mb->thread, NULL);
+    }
+    for (int j = 0; j < MAX_VIRTUAL_JOYSTICKS; j++) {
+        if (hid_mailbox[j].wake_fd >= 0)
+            close(hid_mailbox[j].wake_fd);
+        hid_mailbox[j].wake_fd = -1;
+    }
+    hid_nb_writers = 0;
+}
+
+// Démarre un thread d'écriture par endpoint ; retourne 0 ou -1 (aucun thread actif)
+static int hid_writers_start(OutputSink *sink) {
+    for (int j = 0; j < MAX_VIRTUAL_JOYSTICKS; j++)
+        hid_mailbox[j].wake_fd = -1;
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        HidMailbox *mb = &hid_mailbox[j];
+        atomic_store(&mb->seq, 0);
+        for (int i = 0; i < HID_MAILBOX_WORDS; i++)
+            atomic_store(&mb->words[i], 0);
+        atomic_store(&mb->stop, false);
+        mb->joy = j;
+        mb->report_len = usb_reports[j].size;
+        mb->sink = sink;
+        mb->period_ns = usb_poll_period_ns();
+        // Bloquant côté lecteur ; l'écriture ne bloque jamais (compteur 64 bits)
+        mb->wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (mb->wake_fd < 0) {
+            perror("eventfd mailbox");
+            hid_writers_stop(0);
+            return -1;
+        }
+    }
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        int rv = pthread_create(&hid_mailbox[j].thread, NULL, hid_writer_loop, &hid_mailbox[j]);
+        if (rv != 0) {
+            errno = rv;
+            perror("pthread_create writer");
+            hid_writers_stop(j);
+            return -1;
+        }
+    }
+    hid_nb_writers = usb_nb_joysticks;
+    return 0;
+}
+
+// Signale à l'agrégateur les deltas poussés depuis le dernier signal
+static void hid_delta_signal(HidReportState *st) {
+    if (!st->delta_pushed)
+        return;
+    st->delta_pushed = false;
+    uint64_t one = 1;
+    if (write(hid_queue_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        log_msg(LOG_CAT_GENERAL, LOG_LEVEL_ERROR, "write(queue_fd): %s\n", strerror(errno));
+}
+
+// Publie le delta du lecteur dans la file. File pleine : l'agrégateur est
+// réveillé et le lecteur lui cède le CPU jusqu'à ce qu'une cellule se libère
+// (le delta est abandonné si l'arrêt est demandé entre-temps).
+static void hid_delta_push(HidReportState *st, bool continued) {
+    HidDelta *d = st->delta;
+    d->continued = continued;
+    uint64_t pos = atomic_load_explicit(&hid_queue_head, memory_order_relaxed);
+    bool waited = false;
+    for (;;) {
+        HidDeltaCell *cell = &hid_queue[pos & (HID_DELTA_QUEUE_SIZE - 1)];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t dif = (int64_t)(seq - pos);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&hid_queue_head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                memcpy(&cell->delta, d, offsetof(HidDelta, ops) + d->nb_ops * sizeof(HidDeltaOp));
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                atomic_fetch_add_explicit(&hid_reader_counters.deltas, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&hid_reader_counters.ops, d->nb_ops, memory_order_relaxed);
+                st->delta_pushed = true;
+                break;
+            }
+        } else if (dif < 0) {
+            if (!waited) {
+                waited = true;
+                atomic_fetch_add_explicit(&hid_reader_counters.queue_full, 1, memory_order_relaxed);
+                hid_delta_signal(st);
+            }
+            if (atomic_load_explicit(&hid_stop_requested, memory_order_relaxed))
+                break;
+            sched_yield();
+            pos = atomic_load_explicit(&hid_queue_head, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&hid_queue_head, memory_order_relaxed);
+        }
+    }
+    d->nb_ops = 0;
+}
+
+static void hid_delta_add(HidReportState *st, int kind, int joy, int slot, int16_t value) {
+    HidDelta *d = st->delta;
+    if (d->nb_ops == HID_DELTA_MAX_OPS)
+        hid_delta_push(st, true);
+    d->ops[d->nb_ops++] = (HidDeltaOp){ .value = value, .joy = joy, .kind = kind, .slot = slot };
+}
+
+static void set_axis(HidReportState *st, int joy, int slot, int16_t value) {
+    if (st->axes[joy][slot] != value) {
+        st->axes[joy][slot] = value;
+        st->updated[joy] = true;
+    }
+}
+
+static void set_button(HidReportState *st, int joy, int slot, bool pressed) {
+    int byte_index = slot / 8;
+    int bit_index = slot % 8;
+    uint8_t old_value = st->buttons[joy][byte_index];
+    if (pressed)
+        st->buttons[joy][byte_index] |= (1 << bit_index);
+    else
+        st->buttons[joy][byte_index] &= ~(1 << bit_index);
+    if (st->buttons[joy][byte_index] != old_value)
+        st->updated[joy] = true;
+}
+
+// Applique une valeur d'axe à travers le filtre anti-gigue du périphérique.
+// Hystérésis : une sortie qui s'écarte de moins de ax->hysteresis de la
+// dernière retenue est ignorée, sauf aux extrémités et au centre, toujours
+// atteints exactement. Une lecture qui change sans changer la sortie
+// (quantification, zone morte) est comptée comme absorbée. force : état relu
+// (enregistrement, resynchronisation), appliqué sans hystérésis.
+static void apply_axis(HidReportState *st, HidDeviceFrame *frame, const RtAxis *ax, int value, bool force) {
+    int16_t out = axis_transform_apply(&ax->xform, value);
+    int code = ax->code;
+    uint64_t bit = 1ULL << code;
+    if (frame->axis_seen & bit) {
+        int16_t last = frame->axis_out[code];
+        if (out == last) {
+            if (value != frame->axis_raw[code]) {
+                frame->absorbed_events++;
+                frame->frame_filtered++;
+            }
+        } else if (!force && ax->hysteresis > 0 && out != 0 && out != 32767 && out != -32768 &&
+                   abs((int)out - last) < ax->hysteresis) {
+            frame->hysteresis_events++;
+            frame->frame_filtered++;
+            return;
+        } else {
+            frame->frame_changes++;
+        }
+    } else {
+        frame->axis_seen |= bit;
+        frame->frame_changes++;
+    }
+    frame->axis_raw[code] = value;
+    frame->axis_out[code] = out;
+    if (st->delta)
+        hid_delta_add(st, HID_DELTA_AXIS, ax->joy, ax->slot, out);
+    else
+        set_axis(st, ax->joy, ax->slot, out);
+}
+
+static void apply_button(HidReportState *st, const RtButton *btn, bool pressed) {
+    if (st->delta)
+        hid_delta_add(st, HID_DELTA_BUTTON, btn->joy, btn->slot, pressed);
+    else
+        set_button(st, btn->joy, btn->slot, pressed);
+}
+
+static void handle_input_event(HidReportState *st, const RtDevice *dev, HidDeviceFrame *frame,
+                               const struct input_event *ev) {
+    if (ev->type == EV_ABS && ev->code < ABS_CNT) {
+        int idx = dev->abs_index[ev->code];
+        if (idx < 0)
+            return;
+        const RtAxis *ax = &dev->axes[idx];
+        log_msg(LOG_CAT_AXIS, LOG_LEVEL_DEBUG, "Device %s, axe code=%d, val=%d, min=%d, max=%d\n",
+                dev->cfg->name, ev->code, ev->value, ax->xform.minimum, ax->xform.maximum);
+        if (ax->joy < 0)
+            return;
+        apply_axis(st, frame, ax, ev->value, false);
+    } else if (ev->type == EV_KEY && ev->code <= KEY_MAX && ev->value != 2) {
+        const RtButton *btn = runtime_mapping_find_button(dev, ev->code);
+        if (!btn && !dev->cfg->has_button[ev->code]) {
+            // Chemin lent : bouton absent des bitmaps evdev/hidraw
+            dev->cfg->has_button[ev->code] = 1;
+            log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO, "New button detected: code %d on device %s\n",
+                    ev->code, dev->cfg->name);
+        }
+        log_msg(LOG_CAT_BUTTON, LOG_LEVEL_INFO, "Device %s: button %d %s\n",
+                dev->cfg->name, ev->code, (ev->value ? "pressed" : "released"));
+        if (!btn || btn->joy < 0)
+            return;
+        frame->frame_changes++;
+        apply_button(st, btn, ev->value != 0);
+    }
+}
+
+// Horodatage evdev d'un événement (CLOCK_MONOTONIC)
+static uint64_t event_ts_ns(const struct input_event *ev) {
+    return (uint64_t)ev->input_event_sec * 1000000000ULL + (uint64_t)ev->input_event_usec * 1000ULL;
+}
+
+// Applique la trame en attente à l'état des rapports. syn est le SYN_REPORT
+// qui clôt la trame (NULL si la trame est appliquée de force).
+static void commit_frame(HidReportState *st, const RtDevice *dev, HidDeviceFrame *frame,
+                         const struct input_event *syn) {
+    for (int i = 0; i < frame->nb_pending; i++)
+        handle_input_event(st, dev, frame, &frame->pending[i]);
+    frame->nb_pending = 0;
+    // Trame dont tous les changements ont été écartés : rapport évité
+    if (frame->frame_filtered && !frame->frame_changes)
+        frame->suppressed_frames++;
+    frame->frame_filtered = 0;
+    frame->frame_changes = 0;
+    uint64_t now = 0;
+    if (syn) {
+        st->frames++;
+        if (st->busy_poll) {
+            // Latence de lecture : horodatage evdev -> trame appliquée, par mode de réveil
+            now = latency_now_ns();
+            uint64_t ts = event_ts_ns(syn);
+            uint64_t lat = now > ts ? now - ts : 0;
+            if (st->spinning) {
+                atomic_fetch_add_explicit(&hid_busy_stats.spin_frames, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&hid_busy_stats.spin_latency_ns, lat, memory_order_relaxed);
+            } else {
+                atomic_fetch_add_explicit(&hid_busy_stats.blocking_frames, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&hid_busy_stats.blocking_latency_ns, lat, memory_order_relaxed);
+            }
+        }
+    }
+    if (st->delta) {
+        // Lecteur : la trame part vers l'agrégateur, qui tient l'état des rapports
+        if (st->delta->nb_ops > 0) {
+            if (!now)
+                now = latency_now_ns();
+            st->delta->commit_ts = now;
+            st->delta->frame_ts = syn ? event_ts_ns(syn) : now;
+            hid_delta_push(st, false);
+        }
+        return;
+    }
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        if (!st->updated[j] || st->frame_ts[j] != 0)
+            continue;
+        if (!now)
+            now = latency_now_ns();
+        st->commit_ts[j] = now;
+        st->frame_ts[j] = syn ? event_ts_ns(syn) : now;
+    }
+}
+
+// Etat courant du périphérique (EVIOCGKEY, EVIOCGABS)
+static void read_device_state(const RtDevice *dev, InputTraceState *state) {
+    memset(state, 0, sizeof(*state));
+    state->keys_valid = dev->nb_buttons > 0 && ioctl(dev->fd, EVIOCGKEY(sizeof(state->keys)), state->keys) >= 0;
+    for (int i = 0; i < dev->nb_axes; i++) {
+        int code = dev->axes[i].code;
+        struct input_absinfo info;
+        if (dev->axes[i].joy >= 0 && ioctl(dev->fd, EVIOCGABS(code), &info) == 0) {
+            state->abs[code] = info.value;
+            state->abs_valid[code / 8] |= 1 << (code % 8);
+        }
+    }
+}
+
+// Recale l'état des rapports sur l'état courant du périphérique et l'applique
+// comme une seule trame, sans rejouer les événements perdus. Au rejeu, l'état
+// vient de la trace (st->replay_state). pressed_only : seuls les boutons
+// enfoncés sont appliqués (état initial d'un périphérique, qui ne doit pas
+// relâcher un bouton tenu sur un autre périphérique mappé au même endroit).
+static void resync_device(HidReportState *st, const RtDevice *dev, HidDeviceFrame *frame,
+                          const struct input_event *syn, bool pressed_only) {
+    frame->nb_pending = 0;
+    InputTraceState current;
+    const InputTraceState *state = st->replay_state;
+    if (!state) {
+        read_device_state(dev, &current);
+        input_trace_state(dev->uid, pressed_only ? INPUT_TRACE_SEED : INPUT_TRACE_RESYNC, &current);
+        state = &current;
+    }
+    if (state->keys_valid) {
+        for (int i = 0; i < dev->nb_buttons; i++) {
+            const RtButton *btn = &dev->buttons[i];
+            bool pressed = state->keys[btn->code / 8] & (1 << (btn->code % 8));
+            if (btn->joy >= 0 && (pressed || !pressed_only))
+                apply_button(st, btn, pressed);
+        }
+    }
+    for (int i = 0; i < dev->nb_axes; i++) {
+        const RtAxis *ax = &dev->axes[i];
+        if (ax->joy >= 0 && (state->abs_valid[ax->code / 8] & (1 << (ax->code % 8))))
+            apply_axis(st, frame, ax, state->abs[ax->code], true);
+    }
+    commit_frame(st, dev, frame, syn);
+}
+
+// Applique un lot d'événements lus. Les événements ne sont appliqués qu'au
+// SYN_REPORT, pour qu'un rapport USB ne contienne jamais une demi-trame.
+// Après un SYN_DROPPED (tampon noyau débordé), la trame en cours et les
+// événements jusqu'au SYN_REPORT suivant sont incomplets : ils sont ignorés et
+// le périphérique est recalé sur son état courant.
+static void process_batch(HidReportState *st, const RtDevice *dev, HidDeviceFrame *frame,
+                          const struct input_event *buf, int count) {
+    for (int i = 0; i < count; i++) {
+        const struct input_event *ev = &buf[i];
+        if (ev->type == EV_SYN) {
+            if (ev->code == SYN_DROPPED) {
+                frame->nb_pending = 0;
+                frame->dropped = true;
+            } else if (ev->code == SYN_REPORT && frame->dropped) {
+                frame->dropped = false;
+                log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO, "Device %s: SYN_DROPPED, state resynced\n",
+                        dev->cfg->name);
+                resync_device(st, dev, frame, ev, false);
+                // La suite du lot est antérieure à l'état relu : ignorée
+                return;
+            } else if (ev->code == SYN_REPORT) {
+                commit_frame(st, dev, frame, ev);
+            }
+            continue;
+        }
+        if (frame->dropped)
+            continue;
+        // Trame anormalement longue : on l'applique sans attendre le SYN_REPORT
+        if (frame->nb_pending == HID_FRAME_MAX)
+            commit_frame(st, dev, frame, NULL);
+        frame->pending[frame->nb_pending++] = *ev;
+    }
+}
+
+// Compteurs à un seul écrivain : pas d'opération atomique de lecture-modification
+static inline void counter_add(_Atomic uint64_t *c, uint64_t v) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static inline void counter_max(_Atomic uint64_t *c, uint64_t v) {
+    if (v > atomic_load_explicit(c, memory_order_relaxed))
+        atomic_store_explicit(c, v, memory_order_relaxed);
+}
+
+// Attribue une entrée de hid_device_counters à un périphérique nouvellement
+// enregistré (plusieurs lecteurs peuvent en enregistrer en même temps)
+static HidDeviceCounters *hid_device_counters_claim(const RtDevice *dev) {
+    for (int i = 0; i < HID_MAX_DEVICE_STATS; i++) {
+        HidDeviceCounters *c = &hid_device_counters[i];
+        if (atomic_load_explicit(&c->claimed, memory_order_relaxed) || atomic_exchange(&c->claimed, true))
+            continue;
+        snprintf(c->name, sizeof(c->name), "%.47s", dev->cfg->name);
+        atomic_store_explicit(&c->uid, dev->uid, memory_order_release);
+        return c;
+    }
+    return NULL;
+}
+
+// Résumé des compteurs d'un périphérique (retrait ou arrêt du thread)
+static void hid_device_counters_log(const HidDeviceCounters *c) {
+    uint64_t reads = atomic_load_explicit(&c->reads, memory_order_relaxed);
+    if (!reads)
+        return;
+    log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO,
+            "Device %s: %llu événements, budget épuisé %llu fois (%llu passes de suite au plus), "
+            "âge de lecture moyen %.1f us, max %.1f us\n",
+            c->name, (unsigned long long)atomic_load_explicit(&c->events, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&c->budget_hits, memory_order_relaxed),
+            (unsigned long long)atomic_load_explicit(&c->max_backlog_passes, memory_order_relaxed),
+            atomic_load_explicit(&c->read_age_ns, memory_order_relaxed) / 1000.0 / reads,
+            atomic_load_explicit(&c->max_read_age_ns, memory_order_relaxed) / 1000.0);
+    uint64_t suppressed = atomic_load_explicit(&c->suppressed_frames, memory_order_relaxed);
+    if (suppressed)
+        log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO,
+                "Device %s: %llu rapports évités (%llu valeurs sous l'hystérésis, %llu absorbées)\n",
+                c->name, (unsigned long long)suppressed,
+                (unsigned long long)atomic_load_explicit(&c->hysteresis_events, memory_order_relaxed),
+                (unsigned long long)atomic_load_explicit(&c->absorbed_events, memory_order_relaxed));
+}
+
+// Rend l'entrée d'un périphérique retiré, après son résumé : sans cela, les
+// branchements successifs épuisent la table
+static void hid_device_counters_release(HidDeviceCounters *c) {
+    hid_device_counters_log(c);
+    hid_device_counters_clear(c);
+}
+
+// Reporte les compteurs du filtre anti-gigue dans les compteurs partagés
+static void hid_frame_counters_flush(HidDeviceFrame *frame, HidDeviceCounters *c) {
+    if (frame->hysteresis_events) {
+        counter_add(&c->hysteresis_events, frame->hysteresis_events);
+        frame->hysteresis_events = 0;
+    }
+    if (frame->absorbed_events) {
+        counter_add(&c->absorbed_events, frame->absorbed_events);
+        frame->absorbed_events = 0;
+    }
+    if (frame->suppressed_frames) {
+        counter_add(&c->suppressed_frames, frame->suppressed_frames);
+        frame->suppressed_frames = 0;
+    }
+}
+
+enum { HID_DRAIN_EMPTY, HID_DRAIN_BUDGET, HID_DRAIN_GONE };
+
+// Lit un périphérique jusqu'à EAGAIN (obligatoire en mode edge-triggered) ou
+// jusqu'à son budget d'événements pour la passe, par lots de HID_READ_BATCH
+// événements enregistrés s'il y a une trace. Budget épuisé : le reste sera lu
+// à la passe suivante, après les autres périphériques en attente.
+static int drain_device(HidReportState *st, const RtDevice *dev, HidDeviceSlot *slot, struct input_event *buf) {
+    unsigned budget = hid_device_budget;
+    unsigned done = 0;
+    for (;;) {
+        unsigned want = HID_READ_BATCH;
+        if (budget) {
+            if (done >= budget)
+                return HID_DRAIN_BUDGET;
+            if (budget - done < want)
+                want = budget - done;
+        }
+        ssize_t bytes = read(dev->fd, buf, want * sizeof(struct input_event));
+        if (bytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return HID_DRAIN_EMPTY;
+            if (errno == EINTR)
+                continue;
+            if (errno == ENODEV)
+                return HID_DRAIN_GONE;
+            log_msg(LOG_CAT_DEVICE, LOG_LEVEL_ERROR, "read error in HID thread: %s\n", strerror(errno));
+            return HID_DRAIN_EMPTY;
+        }
+        int count = bytes / sizeof(struct input_event);
+        done += count;
+        if (slot->stats && count > 0) {
+            // Retard de lecture : âge du plus ancien événement du lot
+            uint64_t now = latency_now_ns();
+            uint64_t ts = event_ts_ns(&buf[0]);
+            uint64_t age = now > ts ? now - ts : 0;
+            counter_add(&slot->stats->events, count);
+            counter_add(&slot->stats->reads, 1);
+            counter_add(&slot->stats->read_age_ns, age);
+            counter_max(&slot->stats->max_read_age_ns, age);
+        }
+        input_trace_events(dev->uid, buf, count);
+        process_batch(st, dev, &slot->frame, buf, count);
+        if (slot->stats)
+            hid_frame_counters_flush(&slot->frame, slot->stats);
+        if ((unsigned)count < want)
+            return HID_DRAIN_EMPTY;
+    }
+}
+
+// Lit un périphérique en attente et le retire s'il a disparu
+static void hid_service_device(int epfd, HidReportState *st, const RtDevice *dev, HidDeviceSlot *slot,
+                               struct input_event *buf) {
+    int rv = drain_device(st, dev, slot, buf);
+    uint32_t revents = slot->revents;
+    slot->revents = 0;
+    slot->pending = rv == HID_DRAIN_BUDGET;
+    if (slot->pending) {
+        slot->backlog_passes++;
+        if (slot->stats) {
+            counter_add(&slot->stats->budget_hits, 1);
+            counter_max(&slot->stats->max_backlog_passes, slot->backlog_passes);
+        }
+    } else {
+        slot->backlog_passes = 0;
+    }
+    if (rv == HID_DRAIN_GONE || (revents & (EPOLLHUP | EPOLLERR))) {
+        log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO, "Device %s removed, unregistering from HID thread\n",
+                dev->cfg->name);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, dev->fd, NULL);
+        slot->registered = false;
+        slot->pending = false;
+        if (slot->stats) {
+            hid_device_counters_release(slot->stats);
+            slot->stats = NULL;
+        }
+    }
+}
+
+// Passe de service équitable : chaque périphérique en attente est lu dans la
+// limite de son budget, à tour de rôle, en commençant chaque passe par le
+// périphérique suivant. Un bouton sur un périphérique calme attend donc au
+// plus un budget par périphérique bavard. Retourne le nombre de
+// périphériques encore en retard.
+static int hid_service_pass(int epfd, HidReportState *st, const RuntimeMapping *rt, HidDeviceSlot *slots,
+                            int nb_slots, struct input_event *buf, int *first_slot) {
+    int backlogged = 0;
+    for (int k = 0; k < nb_slots; k++) {
+        int i = (*first_slot + k) % nb_slots;
+        if (!slots[i].registered || !slots[i].pending)
+            continue;
+        hid_service_device(epfd, st, &rt->devices[i], &slots[i], buf);
+        if (slots[i].pending)
+            backlogged++;
+    }
+    if (nb_slots > 0)
+        *first_slot = (*first_slot + 1) % nb_slots;
+    return backlogged;
+}
+
+// Un lecteur ne lit que ses périphériques, répartis par uid pour qu'un
+// périphérique reste au même lecteur d'un mapping à l'autre
+static bool hid_owns_device(const HidReportArgs *args, const RtDevice *dev) {
+    return args->reader < 0 || dev->uid % (unsigned)args->nb_readers == (unsigned)args->reader;
+}
+
+// Aligne l'epoll sur un nouveau mapping : les périphériques sont suivis par
+// uid, les trames en cours sont conservées, les disparus sont retirés avant
+// l'ajout des nouveaux (un fd fermé peut avoir été réattribué). Un nouveau
+// périphérique part de son état courant plutôt que de zéro.
+static HidDeviceSlot *hid_reconcile(int epfd, HidReportState *st, const RuntimeMapping *rt,
+                                    HidDeviceSlot *slots, int *nb_slots, const HidReportArgs *args) {
+    int nb = rt->nb_devices;
+    HidDeviceSlot *next = calloc(nb > 0 ? nb : 1, sizeof(HidDeviceSlot));
+    if (!next) {
+        perror("malloc HID slots");
+        return NULL;
+    }
+    bool *kept = calloc(*nb_slots > 0 ? *nb_slots : 1, sizeof(bool));
+    if (!kept) {
+        perror("malloc HID slots");
+        free(next);
+        return NULL;
+    }
+    int *source = malloc((nb > 0 ? nb : 1) * sizeof(int));
+    if (!source) {
+        perror("malloc HID slots");
+        free(kept);
+        free(next);
+        return NULL;
+    }
+    for (int i = 0; i < nb; i++) {
+        source[i] = -1;
+        for (int k = 0; k < *nb_slots; k++) {
+            if (!kept[k] && slots[k].uid == rt->devices[i].uid) {
+                kept[k] = true;
+                source[i] = k;
+                break;
+            }
+        }
+    }
+    for (int k = 0; k < *nb_slots; k++) {
+        if (kept[k])
+            continue;
+        if (slots[k].registered)
+            epoll_ctl(epfd, EPOLL_CTL_DEL, slots[k].fd, NULL);
+        if (slots[k].stats)
+            hid_device_counters_release(slots[k].stats);
+    }
+    struct epoll_event reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.events = EPOLLIN | EPOLLET;
+    for (int i = 0; i < nb; i++) {
+        const RtDevice *dev = &rt->devices[i];
+        reg.data.u32 = (uint32_t)i;
+        if (source[i] >= 0) {
+            next[i] = slots[source[i]];
+            if (next[i].registered && source[i] != i && epoll_ctl(epfd, EPOLL_CTL_MOD, dev->fd, &reg) < 0)
+                perror("epoll_ctl(MOD device)");
+            // Le mapping du périphérique a pu changer
+            if (next[i].registered)
+                input_trace_device(dev->cfg);
+            continue;
+        }
+        next[i].fd = dev->fd;
+        next[i].uid = dev->uid;
+        if (dev->fd < 0 || !hid_owns_device(args, dev))
+            continue;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, dev->fd, &reg) < 0) {
+            perror("epoll_ctl(device)");
+            continue;
+        }
+        next[i].registered = true;
+        next[i].stats = hid_device_counters_claim(dev);
+        input_trace_device(dev->cfg);
+        resync_device(st, dev, &next[i].frame, NULL, true);
+        log_msg(LOG_CAT_DEVICE, LOG_LEVEL_INFO, "Device %s registered in HID thread\n", dev->cfg->name);
+    }
+    free(source);
+    free(kept);
+    free(slots);
+    *nb_slots = nb;
+    return next;
+}
+
+// Assemble et publie le rapport de chaque joystick modifié
+static void hid_publish_reports(HidReportState *st, uint8_t *report) {
+    for (int j = 0; j < usb_nb_joysticks; j++) {
+        if (!st->updated[j])
+            continue;
+        st->updated[j] = false;
+        // Routine d'assemblage compilée pour le format du joystick
+        report_layout_pack(&usb_reports[j], report, st->axes[j], st->buttons[j]);
+        mailbox_publish(&hid_mailbox[j], report, st->frame_ts[j], st->commit_ts[j]);
+        st->frame_ts[j] = 0;
+    }
+}
 
 void *process_and_send_hid_reports(void *arg) {
     HidReportArgs *args = (HidReportArgs *)arg;
-    int fd = args->fd;
-    InputDevice *devices = (InputDevice *)args->devices;
-    int nb_joysticks = args->nb_joysticks;
-    
-    int16_t report0_axes[8] = {0};
-    uint8_t report0_buttons[128/8] = {0};
-    int16_t report1_axes[8] = {0};
-    uint8_t report1_buttons[128/8] = {0};
-    
-    // Structure pour les transferts interrupt
-    struct usb_raw_int_io {
-        struct usb_raw_ep_io inner;
-        char data[256];
-    } io0, io1;
-    
-    memset(&io0, 0, sizeof(io0));
-    io0.inner.ep = ep_int_in0;
-    io0.inner.flags = 0;
-    io0.inner.length = 33;
-    
-    memset(&io1, 0, sizeof(io1));
-    io1.inner.ep = ep_int_in1;
-    io1.inner.flags = 0;
-    io1.inner.length = 33;
-    
-    while (keep_running) {
-        fd_set read_set;
-        FD_ZERO(&read_set);
-        int max_fd = 0;
-        for (int i = 0; i < nb_joysticks; i++) {
-            FD_SET(devices[i].fd, &read_set);
-            if (devices[i].fd > max_fd)
-                max_fd = devices[i].fd;
-        }
-        int sel = select(max_fd + 1, &read_set, NULL, NULL, NULL);
-        if (sel < 0) {
-            perror("select error in HID thread");
-            break;
+
+    HidReportState st;
+    memset(&st, 0, sizeof(st));
+    // Lecteur : trames traduites en deltas pour le thread d'agrégation
+    HidDelta delta;
+    memset(&delta, 0, sizeof(delta));
+    delta.reader = args->reader;
+    if (args->reader >= 0)
+        st.delta = &delta;
+    _Atomic uint64_t *rcu_state = &hid_rcu[args->reader >= 0 ? args->reader : 0].state;
+
+    char name[20];
+    if (args->reader >= 0)
+        snprintf(name, sizeof(name), "hid_rd%d", args->reader);
+    else
+        snprintf(name, sizeof(name), "hid");
+    if (log_ring_register_thread(name) < 0)
+        fprintf(stderr, "%s thread: pas d'anneau de log disponible, écriture directe\n", name);
+    rt_mode_enter_thread(args->reader >= 0 ? RT_ROLE_READER : RT_ROLE_HID);
+
+    // Tampons préalloués : lot de lecture ; les trames en cours sont dans les slots
+    struct input_event *read_buf = malloc(HID_READ_BATCH * sizeof(struct input_event));
+    HidDeviceSlot *slots = NULL;
+    int nb_slots = 0;
+    uint64_t seen_generation = 0;
+    if (!read_buf) {
+        perror("malloc HID buffers");
+        free(args);
+        log_ring_release_thread();
+        return NULL;
+    }
+    // Pages du lot présentes avant la première lecture
+    memset(read_buf, 0, HID_READ_BATCH * sizeof(struct input_event));
+
+    uint8_t report[HID_MAX_REPORT_SIZE];
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1 in HID thread");
+        free(read_buf);
+        free(args);
+        log_ring_release_thread();
+        return NULL;
+    }
+    struct epoll_event reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.events = EPOLLIN;
+    reg.data.u32 = HID_STOP_TOKEN;
+    int rv_stop = epoll_ctl(epfd, EPOLL_CTL_ADD, args->stop_fd, &reg);
+    reg.data.u32 = HID_WAKE_TOKEN;
+    int rv_wake = epoll_ctl(epfd, EPOLL_CTL_ADD, args->wake_fd, &reg);
+    if (rv_stop < 0 || rv_wake < 0) {
+        perror("epoll_ctl(stop_fd/wake_fd)");
+        close(epfd);
+        free(read_buf);
+        free(args);
+        log_ring_release_thread();
+        return NULL;
+    }
+
+    bool running = true;
+    bool first = true;
+    st.busy_poll = hid_busy_poll_ns > 0;
+    uint64_t last_frame_ns = 0;    // Fin du dernier réveil ayant appliqué une trame
+    uint64_t spin_since = 0;       // Début de l'attente active en cours (0 : bloquante)
+    int backlogged = 0;            // Périphériques dont le budget s'est épuisé à la dernière passe
+    int first_slot = 0;            // Premier périphérique servi à la prochaine passe
+    while (running) {
+        struct epoll_event events[HID_MAX_EPOLL_EVENTS];
+        int n = 0;
+        // Attente active : dans la fenêtre qui suit une trame, les périphériques
+        // sont relus sans bloquer plutôt que d'attendre le réveil par epoll
+        uint64_t now = 0;
+        st.spinning = false;
+        if (st.busy_poll && last_frame_ns) {
+            now = latency_now_ns();
+            st.spinning = now - last_frame_ns < hid_busy_poll_ns;
         }
-        bool updated0 = false, updated1 = false;
-        for (int i = 0; i < nb_joysticks; i++) {
-            if (FD_ISSET(devices[i].fd, &read_set)) {
-                struct input_event ev;
-                ssize_t bytes = read(devices[i].fd, &ev, sizeof(ev));
-                if (bytes < 0) {
-                    perror("read error in HID thread");
-                    continue;
-                }
-                if (bytes == sizeof(ev)) {
-                    if (ev.type == EV_ABS && ev.code < ABS_CNT && devices[i].has_abs[ev.code]) {
-                        struct input_absinfo info = devices[i].absinfo[ev.code];
-                        int minv = info.minimum, maxv = info.maximum;
-                        int range = maxv - minv;
-                        int val = ev.value;
-                        int target_joy = devices[i].axis_virtual_joystick[ev.code];
-                        int target_axis = devices[i].axis_virtual_axis[ev.code];
-                        int16_t final_val = 0;
-                        printf("Device %s, axe code=%d, val=%d, min=%d, max=%d\n",
-                               devices[i].name, ev.code, val, minv, maxv);
-                        if (target_axis >= 0 && target_axis < 8 && (target_joy == 0 || target_joy == 1)) {
-                            if (range != 0) {
-                                if (val < minv) val = minv;
-                                if (val > maxv) val = maxv;
-                                int64_t tmp = (int64_t)(val - minv) * 65535 / range;
-                                int64_t signed_val = tmp - 32768;
-                                if (signed_val < -32768) signed_val = -32768;
-                                if (signed_val > 32767) signed_val = 32767;
-                                final_val = (int16_t)signed_val;
-                                if (devices[i].axis_invert[ev.code])
-                                    final_val = -final_val;
-                                if (devices[i].axis_dead_zone[ev.code] > 0 &&
-                                    final_val > -devices[i].axis_dead_zone[ev.code] &&
-                                    final_val < devices[i].axis_dead_zone[ev.code])
-                                    final_val = 0;
-                            }
-                            if (target_joy == 0) {
-                                if (report0_axes[target_axis] != final_val) {
-                                    report0_axes[target_axis] = final_val;
-                                    updated0 = true;
-                                }
-                            } else if (target_joy == 1) {
-                                if (report1_axes[target_axis] != final_val) {
-                                    report1_axes[target_axis] = final_val;
-                                    updated1 = true;
-                                }
-                            }
-                        }
-                    } else if (ev.type == EV_KEY && ev.code <= KEY_MAX && ev.value != 2) {
-                        if (!devices[i].has_button[ev.code]) {
-                            devices[i].has_button[ev.code] = 1;
-                            printf("New button detected: code %d on device %s\n", ev.code, devices[i].name);
-                        }
-                        printf("Device %s: button %d %s\n", devices[i].name, ev.code, (ev.value ? "pressed" : "released"));
-                        int code_phys = ev.code;
-                        int mapped_button = devices[i].button_mapping[code_phys];
-                        int target_joy = devices[i].button_virtual_joystick[code_phys];
-                        if (mapped_button < 0)
-                            continue;
-                        if (mapped_button >= 0 && mapped_button < MAX_BUTTONS) {
-                            int byte_index = mapped_button / 8;
-                            int bit_index = mapped_button % 8;
-                            if (target_joy == 0) {
-                                uint8_t old_value = report0_buttons[byte_index];
-                                if (ev.value)
-                                    report0_buttons[byte_index] |= (1 << bit_index);
-                                else
-                                    report0_buttons[byte_index] &= ~(1 << bit_index);
-                                if (report0_buttons[byte_index] != old_value)
-                                    updated0 = true;
-                            } else if (target_joy == 1) {
-                                uint8_t old_value = report1_buttons[byte_index];
-                                if (ev.value)
-                                    report1_buttons[byte_index] |= (1 << bit_index);
-                                else
-                                    report1_buttons[byte_index] &= ~(1 << bit_index);
-                                if (report1_buttons[byte_index] != old_value)
-                                    updated1 = true;
-                            }
-                        }
-                    }
-                }
+        if (st.spinning) {
+            if (!spin_since)
+                spin_since = now;
+            atomic_fetch_add_explicit(&hid_busy_stats.spin_polls, 1, memory_order_relaxed);
+            if (atomic_load_explicit(&hid_stop_requested, memory_order_relaxed)) {
+                atomic_fetch_add_explicit(&hid_busy_stats.spin_ns, now - spin_since, memory_order_relaxed);
+                break;
+            }
+        } else {
+            if (spin_since) {
+                atomic_fetch_add_explicit(&hid_busy_stats.spin_ns, now - spin_since, memory_order_relaxed);
+                spin_since = 0;
+            }
+            // Premier tour : enregistrement des périphériques avant toute attente.
+            // Périphériques en retard : collecte des nouveaux fronts sans attendre.
+            if (!first) {
+                n = epoll_wait(epfd, events, HID_MAX_EPOLL_EVENTS, backlogged ? 0 : -1);
+                if (!backlogged)
+                    atomic_fetch_add_explicit(&hid_busy_stats.blocking_waits, 1, memory_order_relaxed);
             }
         }
-        if (updated0) {
-            io0.inner.data[0] = 0x01; // Report ID 1
-            memcpy(&io0.inner.data[1], report0_axes, 8 * sizeof(int16_t));
-            memcpy(&io0.inner.data[1 + 8 * sizeof(int16_t)], report0_buttons, 128/8);
-            int rv = usb_raw_ep_write_may_fail(fd, (struct usb_raw_ep_io *)&io0);
-            if (rv < 0 && errno == ESHUTDOWN) {
-                printf("ep_int_in0: device reset, ending HID thread\n");
+        first = false;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait error in HID thread");
+            break;
+        }
+        // Section de lecture : le mapping reste valide jusqu'à la fin du réveil
+        atomic_fetch_add(rcu_state, 1);
+        const RuntimeMapping *rt = atomic_load(&hid_mapping);
+        if (rt->generation != seen_generation) {
+            HidDeviceSlot *next = hid_reconcile(epfd, &st, rt, slots, &nb_slots, args);
+            if (!next) {
+                atomic_fetch_add(rcu_state, 1);
                 break;
-            } else if (rv < 0) {
-                perror("usb_raw_ep_write_may_fail() joystick 0");
-                exit(EXIT_FAILURE);
             }
+            slots = next;
+            seen_generation = rt->generation;
+            // Les jetons de ce réveil peuvent désigner d'anciens index et, en mode
+            // edge-triggered, rien ne doit rester en attente : lecture de tous les
+            // périphériques (les nouveaux ont pu recevoir des événements avant l'ajout)
+            for (int i = 0; i < nb_slots; i++)
+                slots[i].pending = slots[i].registered;
         }
-        if (updated1) {
-            io1.inner.data[0] = 0x02; // Report ID 2
-            memcpy(&io1.inner.data[1], report1_axes, 8 * sizeof(int16_t));
-            memcpy(&io1.inner.data[1 + 8 * sizeof(int16_t)], report1_buttons, 128/8);
-            int rv = usb_raw_ep_write_may_fail(fd, (struct usb_raw_ep_io *)&io1);
-            if (rv < 0 && errno == ESHUTDOWN) {
-                printf("ep_int_in1: device reset, ending HID thread\n");
+        uint64_t frames = st.frames;
+        if (st.spinning) {
+            // Lectures non bloquantes : EAGAIN immédiat si rien n'est arrivé.
+            // Les fronts epoll laissés par ces lectures ne coûtent qu'une
+            // lecture vide au retour à l'attente bloquante.
+            for (int i = 0; i < nb_slots; i++)
+                slots[i].pending = slots[i].registered;
+        }
+        for (int k = 0; k < n; k++) {
+            uint32_t token = events[k].data.u32;
+            if (token == HID_STOP_TOKEN) {
+                running = false;
                 break;
-            } else if (rv < 0) {
-                perror("usb_raw_ep_write_may_fail() joystick 1");
-                exit(EXIT_FAILURE);
             }
+            if (token == HID_WAKE_TOKEN) {
+                uint64_t count;
+                if (read(args->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                    log_msg(LOG_CAT_GENERAL, LOG_LEVEL_ERROR, "read(wake_fd): %s\n", strerror(errno));
+                continue;
+            }
+            // Evénement en attente pour un index d'un mapping précédent
+            if (token >= (uint32_t)rt->nb_devices)
+                continue;
+            slots[token].pending = slots[token].registered;
+            slots[token].revents |= events[k].events;
+        }
+        if (!running) {
+            atomic_fetch_add(rcu_state, 1);
+            break;
         }
-        usleep(1000);
+        backlogged = hid_service_pass(epfd, &st, rt, slots, nb_slots, read_buf, &first_slot);
+        // Un signal par réveil, quel que soit le nombre de trames du lecteur
+        if (st.delta)
+            hid_delta_signal(&st);
+        else
+            hid_publish_reports(&st, report);
+        atomic_fetch_add(rcu_state, 1);
+        if (st.busy_poll && st.frames != frames)
+            last_frame_ns = latency_now_ns();
     }
+    // Compteurs communs aux lecteurs : un seul résumé
+    if (st.busy_poll && args->reader <= 0) {
+        HidBusyPollStats bs;
+        hid_busy_poll_stats(&bs);
+        log_msg(LOG_CAT_GENERAL, LOG_LEVEL_INFO,
+                "HID: attente active %.1f ms en %llu tours, %llu réveils epoll ; latence de lecture moyenne "
+                "%.1f us en attente active (%llu trames), %.1f us après réveil (%llu trames)\n",
+                bs.spin_ns / 1e6, (unsigned long long)bs.spin_polls, (unsigned long long)bs.blocking_waits,
+                bs.spin_frames ? bs.spin_latency_ns / 1000.0 / bs.spin_frames : 0.0, (unsigned long long)bs.spin_frames,
+                bs.blocking_frames ? bs.blocking_latency_ns / 1000.0 / bs.blocking_frames : 0.0,
+                (unsigned long long)bs.blocking_frames);
+    }
+    for (int i = 0; i < nb_slots; i++) {
+        if (slots[i].stats)
+            hid_device_counters_log(slots[i].stats);
+    }
+    close(epfd);
+    free(slots);
+    free(read_buf);
     free(args);
+    log_ring_release_thread();
     return NULL;
 }
+
+// Applique les deltas publiés par les lecteurs, dans l'ordre de la file.
+// Retourne false tant qu'une trame découpée n'est pas complète : un rapport ne
+// doit jamais en contenir une moitié.
+static bool hid_aggregate(HidReportState *st, bool *open) {
+    uint64_t backlog = atomic_load_explicit(&hid_queue_head, memory_order_relaxed) - hid_queue_tail;
+    if (backlog > atomic_load_explicit(&hid_reader_counters.max_backlog, memory_order_relaxed))
+        atomic_store_explicit(&hid_reader_counters.max_backlog, backlog, memory_order_relaxed);
+    for (;;) {
+        HidDeltaCell *cell = &hid_queue[hid_queue_tail & (HID_DELTA_QUEUE_SIZE - 1)];
+        if (atomic_load_explicit(&cell->seq, memory_order_acquire) != hid_queue_tail + 1)
+            break;
+        const HidDelta *d = &cell->delta;
+        for (int i = 0; i < d->nb_ops; i++) {
+            const HidDeltaOp *op = &d->ops[i];
+            if (op->kind == HID_DELTA_AXIS)
+                set_axis(st, op->joy, op->slot, op->value);
+            else
+                set_button(st, op->joy, op->slot, op->value != 0);
+        }
+        open[d->reader] = d->continued;
+        if (!d->continued) {
+            for (int j = 0; j < usb_nb_joysticks; j++) {
+                if (!st->updated[j] || st->frame_ts[j] != 0)
+                    continue;
+                st->commit_ts[j] = d->commit_ts;
+                st->frame_ts[j] = d->frame_ts;
+            }
+        }
+        atomic_store_explicit(&cell->seq, hid_queue_tail + HID_DELTA_QUEUE_SIZE, memory_order_release);
+        hid_queue_tail++;
+    }
+    for (int r = 0; r < hid_nb_readers; r++) {
+        if (open[r])
+            return false;
+    }
+    return true;
+}
+
+// Thread d'agrégation (avec des lecteurs) : seul propriétaire de l'état des
+// rapports, il applique les deltas et publie dans les boîtes aux lettres
+static void *hid_aggregator_loop(void *arg) {
+    HidReportArgs *args = arg;
+    HidReportState st;
+    memset(&st, 0, sizeof(st));
+    bool open[HID_MAX_READERS] = { false };
+    uint8_t report[HID_MAX_REPORT_SIZE];
+    if (log_ring_register_thread("hid") < 0)
+        fprintf(stderr, "HID thread: pas d'anneau de log disponible, écriture directe\n");
+    rt_mode_enter_thread(RT_ROLE_HID);
+    struct pollfd fds[2] = {
+        { .fd = args->stop_fd, .events = POLLIN },
+        { .fd = hid_queue_fd, .events = POLLIN },
+    };
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            log_msg(LOG_CAT_GENERAL, LOG_LEVEL_ERROR, "poll error in HID aggregator: %s\n", strerror(errno));
+            break;
+        }
+        if (fds[0].revents)
+            break;
+        // Remise à zéro avant la lecture de la file : un delta publié ensuite
+        // réveillera le tour suivant
+        uint64_t count;
+        if (read(hid_queue_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            log_msg(LOG_CAT_GENERAL, LOG_LEVEL_ERROR, "read(queue_fd): %s\n", strerror(errno));
+        if (hid_aggregate(&st, open))
+            hid_publish_reports(&st, report);
+    }
+    HidReaderStats rs;
+    hid_reader_stats(&rs);
+    log_msg(LOG_CAT_GENERAL, LOG_LEVEL_INFO,
+            "HID: %d lecteurs, %llu deltas (%llu modifications), file pleine %llu fois, %llu en attente au plus\n",
+            rs.nb_readers, (unsigned long long)rs.deltas, (unsigned long long)rs.ops,
+            (unsigned long long)rs.queue_full, (unsigned long long)rs.max_backlog);
+    free(args);
+    log_ring_release_thread();
+    return NULL;
+}
+
+// Ferme les eventfd et libère la file de hid_thread_start
+static void hid_release_fds(void) {
+    if (hid_stop_fd >= 0)
+        close(hid_stop_fd);
+    hid_stop_fd = -1;
+    for (int r = 0; r < HID_MAX_READERS; r++) {
+        if (hid_wake_fds[r] >= 0)
+            close(hid_wake_fds[r]);
+        hid_wake_fds[r] = -1;
+    }
+    if (hid_queue_fd >= 0)
+        close(hid_queue_fd);
+    hid_queue_fd = -1;
+    free(hid_queue);
+    hid_queue = NULL;
+}
+
+// Crée l'eventfd d'arrêt, un eventfd de réveil par thread de lecture et, avec
+// des lecteurs, la file et son eventfd
+static int hid_create_fds(int nb_loops, bool readers) {
+    for (int r = 0; r < HID_MAX_READERS; r++)
+        hid_wake_fds[r] = -1;
+    hid_stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (hid_stop_fd < 0) {
+        perror("eventfd");
+        hid_release_fds();
+        return -1;
+    }
+    for (int r = 0; r < nb_loops; r++) {
+        hid_wake_fds[r] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (hid_wake_fds[r] < 0) {
+            perror("eventfd");
+            hid_release_fds();
+            return -1;
+        }
+    }
+    if (!readers)
+        return 0;
+    hid_queue_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (hid_queue_fd < 0) {
+        perror("eventfd queue");
+        hid_release_fds();
+        return -1;
+    }
+    if (posix_memalign((void **)&hid_queue, 64, HID_DELTA_QUEUE_SIZE * sizeof(HidDeltaCell)) != 0) {
+        hid_queue = NULL;
+        perror("malloc HID queue");
+        hid_release_fds();
+        return -1;
+    }
+    // Pages de la file présentes avant le démarrage des lecteurs
+    memset(hid_queue, 0, HID_DELTA_QUEUE_SIZE * sizeof(HidDeltaCell));
+    for (uint64_t i = 0; i < HID_DELTA_QUEUE_SIZE; i++)
+        atomic_store(&hid_queue[i].seq, i);
+    atomic_store(&hid_queue_head, 0);
+    hid_queue_tail = 0;
+    return 0;
+}
+
+static HidReportArgs *hid_args_new(OutputSink *sink, RuntimeMapping *rt, int reader, int wake_fd) {
+    HidReportArgs *args = malloc(sizeof(HidReportArgs));
+    if (!args) {
+        perror("malloc");
+        return NULL;
+    }
+    args->sink = sink;
+    args->rt = rt;
+    args->stop_fd = hid_stop_fd;
+    args->wake_fd = wake_fd;
+    args->reader = reader;
+    args->nb_readers = hid_nb_readers;
+    return args;
+}
+
+// Arrête le thread HID (ou d'agrégation) s'il est démarré et les lecteurs démarrés
+static void hid_join_threads(bool main_thread, int nb_readers) {
+    atomic_store(&hid_stop_requested, true);
+    uint64_t one = 1;
+    if (write(hid_stop_fd, &one, sizeof(one)) < 0)
+        perror("write(stop_fd)");
+    for (int r = 0; r < nb_readers; r++)
+        pthread_join(hid_readers[r], NULL);
+    if (main_thread)
+        pthread_join(hid_thread, NULL);
+    atomic_store(&hid_stop_requested, false);
+}
+
+int hid_thread_start(OutputSink *sink, RuntimeMapping *rt) {
+    hid_thread_stop();
+    int nb_readers = hid_readers_configured;
+    int nb_loops = nb_readers > 0 ? nb_readers : 1;
+    if (hid_create_fds(nb_loops, nb_readers > 0) < 0)
+        return -1;
+    if (rt) {
+        rt->generation = atomic_fetch_add(&hid_generation, 1) + 1;
+        atomic_store(&hid_mapping, rt);
+    }
+    if (!atomic_load(&hid_mapping)) {
+        fprintf(stderr, "hid_thread_start: aucun mapping publié\n");
+        hid_release_fds();
+        return -1;
+    }
+    hid_busy_stats_reset();
+    hid_device_counters_reset();
+    atomic_store(&hid_reader_counters.deltas, 0);
+    atomic_store(&hid_reader_counters.ops, 0);
+    atomic_store(&hid_reader_counters.queue_full, 0);
+    atomic_store(&hid_reader_counters.max_backlog, 0);
+    hid_nb_readers = nb_readers;
+    if (hid_writers_start(sink) < 0) {
+        hid_release_fds();
+        return -1;
+    }
+    // Thread unique, ou agrégateur puis lecteurs
+    HidReportArgs *args = hid_args_new(sink, rt, -1, nb_readers > 0 ? -1 : hid_wake_fds[0]);
+    int rv = args ? pthread_create(&hid_thread, NULL, nb_readers > 0 ? hid_aggregator_loop : process_and_send_hid_reports,
+                                   args)
+                  : ENOMEM;
+    if (rv != 0) {
+        errno = rv;
+        perror("pthread_create");
+        free(args);
+        hid_writers_stop(hid_nb_writers);
+        hid_release_fds();
+        return -1;
+    }
+    for (int r = 0; r < nb_readers; r++) {
+        args = hid_args_new(sink, rt, r, hid_wake_fds[r]);
+        rv = args ? pthread_create(&hid_readers[r], NULL, process_and_send_hid_reports, args) : ENOMEM;
+        if (rv != 0) {
+            errno = rv;
+            perror("pthread_create reader");
+            free(args);
+            hid_join_threads(true, r);
+            hid_writers_stop(hid_nb_writers);
+            hid_release_fds();
+            return -1;
+        }
+    }
+    atomic_store(&hid_nb_wake_fds, nb_loops);
+    hid_thread_active = true;
+    return 0;
+}
+
+int hid_configure_busy_poll(unsigned window_us) {
+    if (window_us > HID_BUSY_POLL_MAX_US)
+        return -1;
+    hid_busy_poll_ns = (uint64_t)window_us * 1000;
+    return 0;
+}
+
+void hid_busy_poll_stats(HidBusyPollStats *out) {
+    out->window_ns = hid_busy_poll_ns;
+    out->blocking_waits = atomic_load_explicit(&hid_busy_stats.blocking_waits, memory_order_relaxed);
+    out->spin_polls = atomic_load_explicit(&hid_busy_stats.spin_polls, memory_order_relaxed);
+    out->spin_ns = atomic_load_explicit(&hid_busy_stats.spin_ns, memory_order_relaxed);
+    out->spin_frames = atomic_load_explicit(&hid_busy_stats.spin_frames, memory_order_relaxed);
+    out->spin_latency_ns = atomic_load_explicit(&hid_busy_stats.spin_latency_ns, memory_order_relaxed);
+    out->blocking_frames = atomic_load_explicit(&hid_busy_stats.blocking_frames, memory_order_relaxed);
+    out->blocking_latency_ns = atomic_load_explicit(&hid_busy_stats.blocking_latency_ns, memory_order_relaxed);
+}
+
+void hid_configure_device_budget(unsigned events) {
+    hid_device_budget = events;
+}
+
+int hid_device_stats(HidDeviceStats *out, int max) {
+    int n = 0;
+    for (int i = 0; i < HID_MAX_DEVICE_STATS && n < max; i++) {
+        HidDeviceCounters *c = &hid_device_counters[i];
+        unsigned uid = atomic_load_explicit(&c->uid, memory_order_acquire);
+        if (!uid)
+            continue;
+        HidDeviceStats *s = &out[n++];
+        s->uid = uid;
+        snprintf(s->name, sizeof(s->name), "%s", c->name);
+        s->events = atomic_load_explicit(&c->events, memory_order_relaxed);
+        s->reads = atomic_load_explicit(&c->reads, memory_order_relaxed);
+        s->budget_hits = atomic_load_explicit(&c->budget_hits, memory_order_relaxed);
+        s->max_backlog_passes = atomic_load_explicit(&c->max_backlog_passes, memory_order_relaxed);
+        s->read_age_ns = atomic_load_explicit(&c->read_age_ns, memory_order_relaxed);
+        s->max_read_age_ns = atomic_load_explicit(&c->max_read_age_ns, memory_order_relaxed);
+        s->hysteresis_events = atomic_load_explicit(&c->hysteresis_events, memory_order_relaxed);
+        s->absorbed_events = atomic_load_explicit(&c->absorbed_events, memory_order_relaxed);
+        s->suppressed_frames = atomic_load_explicit(&c->suppressed_frames, memory_order_relaxed);
+    }
+    return n;
+}
+
+int hid_configure_readers(int nb_readers) {
+    if (nb_readers < 0 || nb_readers > HID_MAX_READERS)
+        return -1;
+    hid_readers_configured = nb_readers;
+    return 0;
+}
+
+void hid_reader_stats(HidReaderStats *out) {
+    out->nb_readers = hid_nb_readers;
+    out->deltas = atomic_load_explicit(&hid_reader_counters.deltas, memory_order_relaxed);
+    out->ops = atomic_load_explicit(&hid_reader_counters.ops, memory_order_relaxed);
+    out->queue_full = atomic_load_explicit(&hid_reader_counters.queue_full, memory_order_relaxed);
+    out->max_backlog = atomic_load_explicit(&hid_reader_counters.max_backlog, memory_order_relaxed);
+}
+
+void hid_thread_stop(void) {
+    if (!hid_thread_active)
+        return;
+    hid_join_threads(true, hid_nb_readers);
+    // Après les threads de lecture : plus aucune publication dans les boîtes aux lettres
+    hid_writers_stop(hid_nb_writers);
+    atomic_store(&hid_nb_wake_fds, 0);
+    hid_release_fds();
+    hid_thread_active = false;
+}
+
+int hid_thread_cpu_clock(clockid_t *clock) {
+    if (!hid_thread_active)
+        return -1;
+    return pthread_getcpuclockid(hid_thread, clock) == 0 ? 0 : -1;
+}
+
+int hid_reader_cpu_clocks(clockid_t *clocks, int max) {
+    if (!hid_thread_active)
+        return 0;
+    int n = 0;
+    for (int r = 0; r < hid_nb_readers && n < max; r++) {
+        if (pthread_getcpuclockid(hid_readers[r], &clocks[n]) == 0)
+            n++;
+    }
+    return n;
+}
+
+RuntimeMapping *hid_mapping_current(void) {
+    return atomic_load(&hid_mapping);
+}
+
+RuntimeMapping *hid_mapping_swap(RuntimeMapping *next) {
+    if (next)
+        next->generation = atomic_fetch_add(&hid_generation, 1) + 1;
+    RuntimeMapping *old = atomic_exchange(&hid_mapping, next);
+    // Période de grâce : un thread de lecture dans un réveil peut encore
+    // utiliser l'ancien mapping ; son réveil suivant relira le nouveau.
+    for (int r = 0; r < HID_MAX_READERS; r++) {
+        uint64_t state = atomic_load(&hid_rcu[r].state);
+        if (state & 1) {
+            while (atomic_load(&hid_rcu[r].state) == state)
+                sched_yield();
+        }
+    }
+    // Réveille les threads pour qu'ils enregistrent sans attendre les nouveaux périphériques
+    int nb_wake = atomic_load(&hid_nb_wake_fds);
+    uint64_t one = 1;
+    for (int r = 0; next && r < nb_wake; r++) {
+        if (write(hid_wake_fds[r], &one, sizeof(one)) < 0 && errno != EAGAIN)
+            perror("write(wake_fd)");
+    }
+    return old;
+}
+
+// Trame en cours d'un périphérique du moteur, suivie par uid comme dans le
+// thread HID pour survivre aux changements de mapping
+typedef struct {
+    unsigned uid;
+    HidDeviceFrame frame;
+} HidEngineFrame;
+
+struct HidEngine {
+    HidReportState st;
+    const RuntimeMapping *rt;
+    HidEngineFrame *frames;
+    int nb_frames;
+};
+
+HidEngine *hid_engine_create(void) {
+    HidEngine *e = calloc(1, sizeof(HidEngine));
+    if (!e)
+        perror("malloc HID engine");
+    return e;
+}
+
+void hid_engine_free(HidEngine *e) {
+    if (!e)
+        return;
+    free(e->frames);
+    free(e);
+}
+
+void hid_engine_set_mapping(HidEngine *e, const RuntimeMapping *rt) {
+    e->rt = rt;
+}
+
+static const RtDevice *engine_device(HidEngine *e, unsigned uid, HidDeviceFrame **frame) {
+    const RtDevice *dev = NULL;
+    for (int i = 0; e->rt && i < e->rt->nb_devices && !dev; i++) {
+        if (e->rt->devices[i].uid == uid)
+            dev = &e->rt->devices[i];
+    }
+    if (!dev)
+        return NULL;
+    for (int i = 0; i < e->nb_frames; i++) {
+        if (e->frames[i].uid == uid) {
+            *frame = &e->frames[i].frame;
+            return dev;
+        }
+    }
+    HidEngineFrame *frames = realloc(e->frames, (e->nb_frames + 1) * sizeof(HidEngineFrame));
+    if (!frames) {
+        perror("malloc HID engine");
+        return NULL;
+    }
+    e->frames = frames;
+    memset(&frames[e->nb_frames], 0, sizeof(HidEngineFrame));
+    frames[e->nb_frames].uid = uid;
+    *frame = &frames[e->nb_frames++].frame;
+    return dev;
+}
+
+void hid_engine_seed(HidEngine *e, unsigned uid, const InputTraceState *state) {
+    HidDeviceFrame *frame;
+    const RtDevice *dev = engine_device(e, uid, &frame);
+    if (!dev)
+        return;
+    e->st.replay_state = state;
+    resync_device(&e->st, dev, frame, NULL, true);
+    e->st.replay_state = NULL;
+}
+
+void hid_engine_feed(HidEngine *e, unsigned uid, const struct input_event *events, int count,
+                     const InputTraceState *resync) {
+    HidDeviceFrame *frame;
+    const RtDevice *dev = engine_device(e, uid, &frame);
+    if (!dev)
+        return;
+    // Sans état enregistré (enregistrement perdu), un recalage n'applique rien
+    static const InputTraceState no_state;
+    e->st.replay_state = resync ? resync : &no_state;
+    process_batch(&e->st, dev, frame, events, count);
+    e->st.replay_state = NULL;
+}
+
+int hid_engine_take_report(HidEngine *e, int joy, uint8_t *report) {
+    if (joy < 0 || joy >= usb_nb_joysticks || !e->st.updated[joy])
+        return 0;
+    e->st.updated[joy] = false;
+    e->st.frame_ts[joy] = 0;
+    report_layout_pack(&usb_reports[joy], report, e->st.axes[joy], e->st.buttons[joy]);
+    return usb_reports[joy].size;
+}